@@ -0,0 +1,368 @@
+/*=============================================================================
+ |   Title:  chatbench.c
+ |
+ |       Author:  Grace Miller
+ |     Language:  C
+ |   To Compile:  Run the Makefile in the client folder (make chatbench)
+ |
+ |        Class:  CS 63 Programming Parallel Systems
+ |     Due Date:  10/17/2026
+ |
+ +-----------------------------------------------------------------------------
+ |
+ |  Description:  a load generator that drives a running server over the real
+ |              wire protocol.  It opens many simulated clients from one
+ |              epoll loop, names them, has them /join, then has some of them
+ |              send chat lines at a fixed total rate.  Every line carries the
+ |              time it was sent, so each copy the server fans out tells how
+ |              long it took to arrive.  Latencies are only meaningful when
+ |              the benchmark runs on the same host as the server, or on hosts
+ |              whose clocks are synchronised
+ |
+ |        Input:  ./chatbench [-c CONNS] [-s SENDERS] [-r RATE] [-d SECONDS]
+ |                           [-l BYTES] [-m ROOM] [IP_ADDRESS] [PORT_NUM]
+ |              CONNS- simulated clients to open, defaults to 100
+ |              SENDERS- how many of them send lines, defaults to 10
+ |              RATE- lines per second sent by all senders together,
+ |                    defaults to 1000
+ |              SECONDS- how long to send for, defaults to 10
+ |              BYTES- length of each chat line, 48 to 1911 (the
+ |                    server's line limit), defaults to 64
+ |              ROOM- the room to join, the default room if not given
+ |
+ |       Output:  connect time percentiles, lines sent, messages and bytes
+ |              delivered per second, and fan-out latency percentiles
+ |
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+#include "histogram.h"
+
+#define NAMELENGTH 100
+#define BUFFERSIZE 2048
+#define MAXEVENTS 256
+/* bytes pulled off a socket per recv() call */
+#define READSIZE 16384
+/* bytes a simulated client may have waiting to be sent, a sender whose
+buffer is full skips its turn */
+#define OUTSIZE 8192
+/* seconds allowed for every client to connect and join */
+#define JOINSECS 30
+/* seconds to keep reading after the last line is sent */
+#define DRAINSECS 2
+
+#define CONNECTING 0
+#define JOINING 1
+#define READY 2
+#define CLOSED 3
+
+/* one simulated client */
+typedef struct BenchConn{
+  int sock;
+  int state;
+  /* when connect() was called, in microseconds */
+  double started;
+  proto_decoder_t decoder;
+  char out[OUTSIZE];
+  size_t outlen;
+} BenchConn;
+
+Histogram latency;
+Histogram connect_time;
+/* clients that joined, and clients that gave up before joining */
+int joined = 0;
+int failed = 0;
+int measuring = 0;
+unsigned long delivered = 0;
+unsigned long delivered_bytes = 0;
+unsigned long stalls = 0;
+
+/* stop driving a client */
+void close_conn(BenchConn *c){
+  if(c->state != CLOSED){
+    if(c->state != READY){
+      failed++;
+    }
+    c->state = CLOSED;
+    close(c->sock);
+  }
+}
+
+/* write as much of a client's waiting output as the socket takes */
+void flush_conn(BenchConn *c){
+  ssize_t n;
+
+  while(c->outlen > 0 && c->state != CLOSED){
+    n = send(c->sock, c->out, c->outlen, 0);
+    if(n > 0){
+      memmove(c->out, c->out + n, c->outlen - n);
+      c->outlen -= n;
+    }else if(n < 0 && errno == EINTR){
+      continue;
+    }else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+      return;
+    }else{
+      close_conn(c);
+    }
+  }
+}
+
+/* frame a message into a client's output, 0 if it fit, -1 if not */
+int queue_frame(BenchConn *c, int opcode, const char *payload, size_t len){
+  if(c->outlen + PROTO_HDRLEN + len > OUTSIZE){
+    return -1;
+  }
+  c->outlen += proto_pack(c->out + c->outlen, OUTSIZE - c->outlen, opcode, 0,
+                          payload, len);
+  return 0;
+}
+
+/* decoder callback, notices joins and times the lines fanned out to us */
+int handle_frame(proto_frame_t *frame, void *arg){
+  BenchConn *c = (BenchConn *)arg;
+  char *stamp;
+
+  /* keepalives are answered so idle clients are not reaped mid-run */
+  if(frame->opcode == OP_PING){
+    queue_frame(c, OP_PONG, NULL, 0);
+    return 0;
+  }
+  if(frame->opcode != OP_TEXT){
+    return 0;
+  }
+  if(c->state == JOINING){
+    if(strncmp(frame->payload, "SERVER: successfully joined", 27) == 0){
+      c->state = READY;
+      joined++;
+    }else if(strncmp(frame->payload, "SERVER ERROR", 12) == 0){
+      printf("client on socket %d: %s", c->sock, frame->payload);
+    }
+    return 0;
+  }
+  if(measuring && (stamp = strstr(frame->payload, ": @")) != NULL){
+    hist_add(&latency, now_us() - strtod(stamp + 3, NULL));
+    delivered++;
+    delivered_bytes += PROTO_HDRLEN + frame->length;
+  }
+  return 0;
+}
+
+/* the socket finished connecting, name the client and join */
+void connected(BenchConn *c, const char *room){
+  char line[BUFFERSIZE];
+  int err = 0;
+  socklen_t len = sizeof(err);
+
+  if(getsockopt(c->sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0){
+    close_conn(c);
+    return;
+  }
+  hist_add(&connect_time, now_us() - c->started);
+  c->state = JOINING;
+  sprintf(line, "b%d_%d", (int)getpid(), c->sock);
+  queue_frame(c, OP_HELLO, line, strlen(line));
+  sprintf(line, "/join %s\n", room);
+  queue_frame(c, OP_CHAT, line, strlen(line));
+  flush_conn(c);
+}
+
+/* read everything the socket has */
+void read_conn(BenchConn *c){
+  char buf[READSIZE];
+  ssize_t n;
+
+  while(c->state != CLOSED){
+    n = recv(c->sock, buf, sizeof(buf), 0);
+    if(n > 0){
+      if(proto_decode(&c->decoder, buf, n, handle_frame, c) != 0){
+        close_conn(c);
+      }
+    }else if(n < 0 && errno == EINTR){
+      continue;
+    }else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+      /* sends any pongs the frames asked for */
+      flush_conn(c);
+      return;
+    }else{
+      close_conn(c);
+    }
+  }
+}
+
+/* wait up to timeout milliseconds and handle whatever happened */
+void poll_conns(int epollfd, int timeout, const char *room){
+  struct epoll_event events[MAXEVENTS];
+  BenchConn *c;
+  int i, n;
+
+  n = epoll_wait(epollfd, events, MAXEVENTS, timeout);
+  for(i = 0; i < n; i++){
+    c = (BenchConn *)events[i].data.ptr;
+    if(c->state == CONNECTING && (events[i].events & (EPOLLOUT | EPOLLERR))){
+      connected(c, room);
+    }
+    if(c->state != CONNECTING && (events[i].events & EPOLLOUT)){
+      flush_conn(c);
+    }
+    if(c->state != CONNECTING && c->state != CLOSED &&
+       (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))){
+      read_conn(c);
+    }
+  }
+}
+
+/* raise the soft open file limit so thousands of clients fit */
+void raise_file_limit(void){
+  struct rlimit rl;
+
+  if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max){
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+int main(int argc, char* argv[]){
+  int nconns = 100, nsenders = 10, seconds = 10, linelen = 64;
+  double rate = 1000;
+  const char *room = "";
+  struct sockaddr_in servaddr;
+  struct epoll_event ev;
+  BenchConn *conns, *c;
+  char line[BUFFERSIZE];
+  int epollfd, opt, i, next = 0, tries;
+  unsigned long sent = 0, due;
+  double start, elapsed, deadline;
+
+  while((opt = getopt(argc, argv, "c:s:r:d:l:m:")) != -1){
+    switch(opt){
+      case 'c': nconns = atoi(optarg); break;
+      case 's': nsenders = atoi(optarg); break;
+      case 'r': rate = atof(optarg); break;
+      case 'd': seconds = atoi(optarg); break;
+      case 'l': linelen = atoi(optarg); break;
+      case 'm': room = optarg; break;
+      default:
+        printf("usage: ./chatbench [-c CONNS] [-s SENDERS] [-r RATE] "
+               "[-d SECONDS] [-l BYTES] [-m ROOM] IP_ADDRESS PORT_NUM\n");
+        return(1);
+    }
+  }
+  if(argc - optind != 2){
+    printf("incorrect number of arguments.\n");
+    return(1);
+  }
+  if(nconns < 1 || nsenders < 1 || nsenders > nconns || rate <= 0 ||
+     linelen < 48 || linelen > PROTO_MAXLINE){
+    printf("need 1 <= SENDERS <= CONNS, RATE > 0 and 48 <= BYTES <= %d\n",
+           PROTO_MAXLINE);
+    return(1);
+  }
+
+  memset(&servaddr, 0, sizeof(servaddr));
+  servaddr.sin_family = AF_INET;
+  servaddr.sin_addr.s_addr = inet_addr(argv[optind]);
+  servaddr.sin_port = htons(atoi(argv[optind + 1]));
+
+  raise_file_limit();
+  conns = (BenchConn *)calloc(nconns, sizeof(BenchConn));
+  if(!conns || (epollfd = epoll_create1(0)) < 0){
+    perror("could not set up the benchmark");
+    return(1);
+  }
+
+  /* every client connects at once, like a reconnect storm */
+  for(i = 0; i < nconns; i++){
+    c = &conns[i];
+    proto_decoder_init(&c->decoder, PROTO_MAXPAYLOAD);
+    c->state = CONNECTING;
+    c->sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(c->sock < 0){
+      perror("socket failed");
+      c->state = CLOSED;
+      failed++;
+      continue;
+    }
+    c->started = now_us();
+    if(connect(c->sock, (struct sockaddr *)&servaddr, sizeof(servaddr)) < 0 &&
+       errno != EINPROGRESS){
+      close_conn(c);
+      continue;
+    }
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    epoll_ctl(epollfd, EPOLL_CTL_ADD, c->sock, &ev);
+  }
+
+  deadline = now_us() + JOINSECS * 1e6;
+  while(joined + failed < nconns && now_us() < deadline){
+    poll_conns(epollfd, 10, room);
+  }
+  printf("clients %d joined %d failed %d\n", nconns, joined, failed);
+  hist_print("connect_us", &connect_time);
+
+  /* senders take turns so the total rate is spread evenly between them */
+  measuring = 1;
+  start = now_us();
+  while((elapsed = now_us() - start) < seconds * 1e6){
+    due = (unsigned long)(rate * elapsed / 1e6);
+    for(tries = 0; sent < due && tries < nsenders; next = (next + 1) % nsenders){
+      c = &conns[next];
+      if(c->state != READY){
+        tries++;
+        continue;
+      }
+      sprintf(line, "@%.0f %lu ", now_us(), sent);
+      memset(line + strlen(line), 'x', linelen - 1 - strlen(line));
+      line[linelen - 1] = '\n';
+      if(queue_frame(c, OP_CHAT, line, linelen) < 0){
+        stalls++;
+        tries++;
+        continue;
+      }
+      flush_conn(c);
+      sent++;
+      tries = 0;
+    }
+    poll_conns(epollfd, 1, room);
+  }
+  elapsed = now_us() - start;
+  deadline = now_us() + DRAINSECS * 1e6;
+  while(now_us() < deadline){
+    poll_conns(epollfd, 10, room);
+  }
+
+  printf("sent %lu lines in %.2f s (%.0f lines/sec, %lu sender stalls)\n",
+         sent, elapsed / 1e6, sent / (elapsed / 1e6), stalls);
+  printf("delivered %lu messages (%.0f msgs/sec, %.0f bytes/sec)\n",
+         delivered, delivered / (elapsed / 1e6),
+         delivered_bytes / (elapsed / 1e6));
+  hist_print("fanout_latency_us", &latency);
+
+  for(i = 0; i < nconns; i++){
+    close_conn(&conns[i]);
+    proto_decoder_free(&conns[i].decoder);
+  }
+  free(conns);
+  /* lines went out with someone to hear them and nothing came back, the
+  server refused them, so there is nothing to report */
+  if(sent > 0 && joined > 1 && delivered == 0){
+    fprintf(stderr, "no messages were delivered, the server refused every "
+            "line (too long, or over its rate limit?)\n");
+    return(1);
+  }
+  return(0);
+}
@@ -16,147 +16,452 @@
  |            the server by logging into it and then cat’ing the
  |            file /etc/network/interfaces
  |
- |        Input:  ./client [SCREEN_NAME] [IP_ADDRESS] [PORT_NUM]
+ |              one thread waits with poll() on both the user's input and
+ |              the server's socket, lines typed are framed and written as
+ |              the socket takes them, and frames from the server are put
+ |              back together however the stream splits them
+ |
+ |              given a script the client runs as a bot: it sends the
+ |              script's lines at a fixed rate, optionally over and over,
+ |              and can stamp its chat lines with the time they were sent
+ |              and time the stamped lines other bots send it, so single
+ |              client processes can drive latency measurements and soak
+ |              tests
+ |
+ |        Input:  ./client [-f SCRIPT] [-r RATE] [-l LOOPS] [-w SECONDS] [-t]
+ |                         [SCREEN_NAME] [IP_ADDRESS] [PORT_NUM]
  |              SCREEN_NAME- name to be presented to other users next to your messages
  |              IP_ADDRESS- the ip address of the server
  |              PORT_NUM- the port number the server is running on
+ |              SCRIPT- a file of lines to send instead of what is typed,
+ |                      - for standard input
+ |              RATE- lines per second to send, as fast as the server
+ |                    takes them if not given
+ |              LOOPS- times to send the script, 0 for ever, a script
+ |                     read from a pipe is only sent once
+ |              SECONDS- how long to wait for replies once the lines run
+ |                       out, until the server closes if not given
+ |              -t- stamp chat lines and report the latency of stamped
+ |                  lines received
  |
  |              once running the client takes these commands:
  |                 /ping – queries the server to determine if it is up and prints the result
- |                  /join – joins the chat room, messages not displayed otherwise
- |                  /leave – leaves the chat room
- |                  /who – obtains the current list of ID’s in the chat room.
+ |                  /join [room] – joins a chat room, the default one if not given
+ |                  /leave [room] – leaves a chat room, the one being typed into by default
+ |                  /who [page] – obtains a page of the list of ID’s in the chat room
+ |                  /rooms – lists every room and how many users are in it
+ |                  /stats – the server's live counters
+ |                  /history [n] – the last n lines said in the chat room
+ |                  /msg user text – sends a line to one user only
  |
  |              otherwise, the server sends the user's message to all other clients
  |
- |       Output:  messages from other users, or messages from the server
+ |       Output:  messages from other users, or messages from the server,
+ |              and in scripted mode the lines sent and the latencies seen
  |
  *===========================================================================*/
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
-#include <strings.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <pthread.h>
 #include <signal.h>
-#include <stdbool.h>
 #include <unistd.h>
 
+#include "protocol.h"
+#include "histogram.h"
 
 #define NAMELENGTH 100
 #define BUFFERSIZE 2048
+/* bytes pulled off the socket per recv() call */
+#define READSIZE 16384
+/* framed lines waiting for the socket, input is not read while it is full */
+#define OUTSIZE 65536
 
-volatile sig_atomic_t print_flag = false;
-int m_recieved = 0;
-int num_tries = 1;
+/* everything the event loop keeps about the session */
+typedef struct Client{
+  int sockfd;
+  proto_decoder_t decoder;
+  /* framed lines not yet taken by the socket */
+  char out[OUTSIZE];
+  size_t outlen;
+  /* where lines come from and the bytes read that are not yet sent */
+  int infd;
+  char in[BUFFERSIZE];
+  size_t inlen;
+  int input_done;
+  /* times the script has still to be read, 0 for ever */
+  int loops;
+} Client;
+
+/* the scripted mode's settings and what it measured */
+double rate = 0;
+int stamping = 0;
+unsigned long lines_sent = 0;
+Histogram latency;
+volatile sig_atomic_t stop_requested = 0;
 
+/*
+ * Function:  request_stop()
+ * --------------------
+ *  SIGINT and SIGTERM handler, asks the event loop to print what it
+ *  measured and exit
+ *
+ * paramaters:
+ *  int sig: the signal number
+ *
+ *  returns: NULL
+ */
+void request_stop(int sig){
+  stop_requested = 1;
+}
 
-/* message passed to server with the user name inside */
-typedef struct Message {
-   char buffer[BUFFERSIZE];
-   char user_id[NAMELENGTH];
-} Message;
+/*
+ * Function:  queue_frame()
+ * --------------------
+ *  frames a payload into the bytes waiting for the socket
+ *
+ * paramaters:
+ *  Client *c: the session
+ *  int opcode: the frame's opcode
+ *  const char *payload: the bytes to send
+ *  size_t length: the number of bytes to send
+ *
+ *  returns: 0 if successful, -1 if there is no room for it yet
+ */
+int queue_frame(Client *c, int opcode, const char *payload, size_t length){
+  size_t len;
 
-/* structure to pass all server params to threads */
-typedef struct ServerParams{
-  struct sockaddr_in servaddr;
-  socklen_t serverlength;
-  char *name;
-  int sockfd;
-} ServerParams;
+  len = proto_pack(c->out + c->outlen, OUTSIZE - c->outlen, opcode, 0,
+                   payload, length);
+  if(len == 0){
+    return -1;
+  }
+  c->outlen += len;
+  return 0;
+}
 
 /*
- * Function:  receive_message()
+ * Function:  flush_output()
  * --------------------
- *  a function to run on a seperate thread than the send message for the client
- *  to recieve messages from the server as well as other users
+ *  writes as much of the waiting frames as the socket will take
  *
  * paramaters:
- *  void *i_params: a ServerParams structure
+ *  Client *c: the session
  *
- *  returns: 0 when the thread is closed
+ *  returns: 0 if successful, -1 if the connection failed
  */
-void *receive_message(void *i_params){
-  ServerParams *params = (ServerParams*)i_params;
-  char recvline[BUFFERSIZE];
-
-  /* print the server's reply */
-  while(1){
-    memset(&recvline[0], 0, sizeof(recvline));
-    m_recieved = recv(params->sockfd, recvline, BUFFERSIZE, 0);
-    if (m_recieved < 0){
-      perror("ERROR in recvfrom");
+int flush_output(Client *c){
+  ssize_t n;
+
+  while(c->outlen > 0){
+    n = send(c->sockfd, c->out, c->outlen, MSG_NOSIGNAL);
+    if(n > 0){
+      memmove(c->out, c->out + n, c->outlen - n);
+      c->outlen -= n;
+    }else if(n < 0 && errno == EINTR){
+      continue;
+    }else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
       return 0;
+    }else{
+      perror("ERROR in send");
+      return -1;
     }
-    printf("%s", recvline);
-
   }
   return 0;
 }
 
-
 /*
- * Function:  send_message()
+ * Function:  print_frame()
  * --------------------
- *  a function to run on a seperate thread than the receive message for the client
- *  to send messages from the client to the server and other users
+ *  called by the frame decoder for every whole frame from the server, prints
+ *  the text the server sent and users joining and leaving the user's rooms,
+ *  and times a line carrying a stamp, a keepalive ping is answered
  *
  * paramaters:
- *  void *i_params: a ServerParams structure
+ *  proto_frame_t *frame: the decoded frame
+ *  void *arg: the session
  *
- *  returns: 0 when the thread is closed
+ *  returns: 0 to keep decoding
  */
-void *send_message(void *i_params){
-  Message *message;
-  char *sendline = malloc(sizeof(char));
-  int n;
-  ServerParams *params = (ServerParams*)i_params;
+int print_frame(proto_frame_t *frame, void *arg){
+  char *stamp;
 
+  /* the answer goes out with the next flush */
+  if(frame->opcode == OP_PING){
+    queue_frame((Client *)arg, OP_PONG, NULL, 0);
+    return 0;
+  }
+  /* the payload is the room's name, NUL, the user's name */
+  if(frame->opcode == OP_JOINED || frame->opcode == OP_LEFT){
+    if(strlen(frame->payload) >= frame->length){
+      return 0;
+    }
+    printf("* %s %s %s\n", frame->payload + strlen(frame->payload) + 1,
+           frame->opcode == OP_JOINED ? "joined" : "left", frame->payload);
+    fflush(stdout);
+    return 0;
+  }
+  if(frame->opcode != OP_TEXT){
+    return 0;
+  }
+  if(stamping && (stamp = strstr(frame->payload, ": @")) != NULL){
+    hist_add(&latency, now_us() - strtod(stamp + 3, NULL));
+  }
+  fwrite(frame->payload, 1, frame->length, stdout);
+  fflush(stdout);
+  return 0;
+}
+
+/*
+ * Function:  read_server()
+ * --------------------
+ *  reads everything the socket has and feeds it to the frame decoder, a
+ *  read may hold part of a frame or several
+ *
+ * paramaters:
+ *  Client *c: the session
+ *
+ *  returns: 0 if the connection is still open, -1 if it is closed
+ */
+int read_server(Client *c){
+  char buf[READSIZE];
+  ssize_t n;
 
-  message  = (Message *)malloc(sizeof(Message));
   while(1){
-    while (fgets(sendline, BUFFERSIZE, stdin) != NULL) {
+    n = recv(c->sockfd, buf, sizeof(buf), 0);
+    if(n > 0){
+      if(proto_decode(&c->decoder, buf, n, print_frame, c) != 0){
+        printf("malformed frame from the server\n");
+        return -1;
+      }
+    }else if(n == 0){
+      printf("server closed the connection\n");
+      return -1;
+    }else if(errno == EINTR){
+      continue;
+    }else if(errno == EAGAIN || errno == EWOULDBLOCK){
+      return 0;
+    }else{
+      perror("ERROR in recv");
+      return -1;
+    }
+  }
+}
 
-      strcpy(message->user_id, params->name);
-      strcpy(message->buffer, sendline);
-      n = send(params->sockfd, (struct Message *)message, sizeof(Message), 0);
+/*
+ * Function:  read_input()
+ * --------------------
+ *  reads more of the user's input or the script, at the end of a script
+ *  that is to be sent again it starts over
+ *
+ * paramaters:
+ *  Client *c: the session
+ *
+ *  returns: NULL
+ */
+void read_input(Client *c){
+  ssize_t n;
+
+  n = read(c->infd, c->in + c->inlen, sizeof(c->in) - c->inlen);
+  if(n > 0){
+    c->inlen += n;
+  }else if(n == 0){
+    if(c->loops != 1 && lseek(c->infd, 0, SEEK_SET) == 0){
+      if(c->loops > 1){
+        c->loops--;
+      }
+      return;
+    }
+    c->input_done = 1;
+  }else if(errno != EINTR && errno != EAGAIN){
+    perror("ERROR reading input");
+    c->input_done = 1;
+  }
+}
 
-      if (n < 0) {
-          perror("ERROR in sendto");
-        	return 0;
+/*
+ * Function:  send_line()
+ * --------------------
+ *  takes the next whole line of input and queues it for the server, a
+ *  line longer than the server takes, stamp included, goes out in pieces
+ *  it does take, and a last line without a newline goes out once the input
+ *  ends
+ *
+ * paramaters:
+ *  Client *c: the session
+ *
+ *  returns: 1 if a line was queued, 0 if there is no whole line or no room
+ */
+int send_line(Client *c){
+  char line[BUFFERSIZE + 32];
+  char *end = memchr(c->in, '\n', c->inlen);
+  size_t len, take;
+
+  if(end){
+    take = end - c->in + 1;
+  }else if(c->inlen == sizeof(c->in) || (c->input_done && c->inlen > 0)){
+    take = c->inlen;
+  }else{
+    return 0;
+  }
+  len = 0;
+  /* commands are left alone, the server would not know them stamped */
+  if(stamping && c->in[0] != '/'){
+    len = sprintf(line, "@%.0f ", now_us());
+  }
+  if(take > PROTO_MAXLINE - len){
+    take = PROTO_MAXLINE - len;
+  }
+  memcpy(line + len, c->in, take);
+  len += take;
+  if(OUTSIZE - c->outlen < PROTO_HDRLEN + len ||
+     queue_frame(c, OP_CHAT, line, len) < 0){
+    return 0;
+  }
+  memmove(c->in, c->in + take, c->inlen - take);
+  c->inlen -= take;
+  lines_sent++;
+  return 1;
+}
+
+/*
+ * Function:  run_client()
+ * --------------------
+ *  the event loop, waits with poll() for the socket and the input and
+ *  sends lines as they are due, until the server closes the connection,
+ *  or the input has run out and linger_us has passed
+ *
+ * paramaters:
+ *  Client *c: the session
+ *  double linger_us: how long to wait for replies once the input runs out,
+ *        negative to wait until the server closes
+ *
+ *  returns: NULL
+ */
+void run_client(Client *c, double linger_us){
+  struct pollfd fds[2];
+  double now, next_due = now_us(), finish = 0;
+  int timeout;
+
+  while(!stop_requested){
+    now = now_us();
+    /* send every line that is due, at most one per interval when paced */
+    while(!c->input_done || c->inlen > 0){
+      if(rate > 0 && next_due > now){
+        break;
+      }
+      if(!send_line(c)){
+        break;
+      }
+      if(rate > 0){
+        next_due += 1e6 / rate;
+        /* a script that stalled does not make up for it with a burst */
+        if(next_due < now){
+          next_due = now;
+        }
       }
     }
+    if(flush_output(c) < 0){
+      return;
+    }
+    if(c->input_done && c->inlen == 0 && c->outlen == 0){
+      if(linger_us >= 0 && finish == 0){
+        finish = now + linger_us;
+      }
+      if(finish > 0 && now >= finish){
+        return;
+      }
+    }
+
+    timeout = -1;
+    if(finish > 0){
+      timeout = (int)((finish - now) / 1000) + 1;
+    }else if(rate > 0 && next_due > now && (c->inlen > 0 || !c->input_done)){
+      timeout = (int)((next_due - now) / 1000) + 1;
+    }
+    fds[0].fd = c->sockfd;
+    fds[0].events = POLLIN | (c->outlen > 0 ? POLLOUT : 0);
+    /* input is only read while there is no whole line waiting to go out */
+    fds[1].fd = -1;
+    fds[1].events = POLLIN;
+    if(!c->input_done && c->inlen < sizeof(c->in) &&
+       !memchr(c->in, '\n', c->inlen)){
+      fds[1].fd = c->infd;
+    }
+    if(poll(fds, 2, timeout) < 0){
+      if(errno == EINTR){
+        continue;
+      }
+      perror("poll failed");
+      return;
+    }
+    if(fds[0].revents & (POLLIN | POLLHUP | POLLERR)){
+      if(read_server(c) < 0){
+        return;
+      }
+    }
+    if(fds[1].fd >= 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))){
+      read_input(c);
+    }
   }
-  return 0;
 }
 
 
 
 int main(int argc, char* argv[]){
-  char *name = malloc(sizeof(char));
+  char *name;
   char *host_id;
-  /*char sendline[800]; */
-  int port_num, sockfd, err;
+  const char *script = NULL;
+  int port_num, sockfd, opt;
+  double linger_us = -1;
   socklen_t serverlength;
   struct sockaddr_in servaddr;
-  /* threads */
-  pthread_t send_thread;
-  pthread_t recv_thread;
-
-
-  ServerParams *sparams;
+  struct sigaction sa;
+  Client *c;
 
-  if(argc != 4){
+  c = (Client *)calloc(1, sizeof(Client));
+  if(!c){
+    perror("out of memory");
+    return(1);
+  }
+  c->loops = 1;
+  while((opt = getopt(argc, argv, "f:r:l:w:t")) != -1){
+    switch(opt){
+      case 'f': script = optarg; break;
+      case 'r': rate = atof(optarg); break;
+      case 'l': c->loops = atoi(optarg); break;
+      case 'w': linger_us = atof(optarg) * 1e6; break;
+      case 't': stamping = 1; break;
+      default:
+        printf("usage: ./client [-f SCRIPT] [-r RATE] [-l LOOPS] "
+               "[-w SECONDS] [-t] SCREEN_NAME IP_ADDRESS PORT_NUM\n");
+        return(1);
+    }
+  }
+  if(argc - optind != 3){
     printf("incorrect number of arguments.");
     return(0);
   }
-  name = argv[1];
-  host_id = argv[2];
-  port_num = atoi(argv[3]);
+  name = argv[optind];
+  host_id = argv[optind + 1];
+  port_num = atoi(argv[optind + 2]);
+
+  c->infd = STDIN_FILENO;
+  if(script && strcmp(script, "-") != 0 &&
+     (c->infd = open(script, O_RDONLY)) < 0){
+    perror("cannot open the script");
+    return(1);
+  }
 
   /* create the socket */
   if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
@@ -178,34 +483,37 @@ int main(int argc, char* argv[]){
           perror("Problem in connecting to the server");
           exit(3);
   }
+  /* from here on nothing waits on the socket but poll() */
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+  c->sockfd = sockfd;
+  proto_decoder_init(&c->decoder, PROTO_MAXPAYLOAD);
+
+  /* introduce ourselves, the server remembers the name for this connection */
+  if (strlen(name) == 0 || strlen(name) >= NAMELENGTH ||
+      queue_frame(c, OP_HELLO, name, strlen(name)) < 0) {
+          printf("invalid screen name\n");
+          exit(3);
+  }
 
-  printf("Please enter your fist message: ");
-
-  sparams = malloc(sizeof(ServerParams));
-  sparams->name = name;
-  sparams->servaddr = servaddr;
-  sparams->serverlength = serverlength;
-  sparams->sockfd = sockfd;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = request_stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
 
-  /* create the thread to send messages from */
-  err = pthread_create(&send_thread, NULL, send_message, sparams);
-  if (err != 0){
-      printf("\ncan't create thread");
-      return(1);
+  if(!script){
+    printf("Please enter your fist message: ");
+    fflush(stdout);
   }
+  run_client(c, linger_us);
 
-  /* create the thread to receive messages from */
-  err = pthread_create(&recv_thread, NULL, receive_message, sparams);
-  if (err != 0){
-      printf("\ncan't create thread");
-      return(1);
+  if(script || stamping){
+    printf("sent %lu lines\n", lines_sent);
   }
-
-  pthread_join(send_thread, NULL);
-  pthread_join(recv_thread, NULL);
-
+  if(stamping){
+    hist_print("latency_us", &latency);
+  }
+  close(sockfd);
+  proto_decoder_free(&c->decoder);
+  free(c);
   return 0;
-
-
-
 }
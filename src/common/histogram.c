@@ -0,0 +1,87 @@
+/*=============================================================================
+|   Title: histogram.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile in the client folder
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the latency histogram, see histogram.h
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+#include "histogram.h"
+
+/* microseconds on the monotonic clock */
+double now_us(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* the bucket a value falls in */
+static int hist_bucket(unsigned long v){
+  int msb = 0;
+
+  if(v < SUBBUCKETS){
+    return (int)v;
+  }
+  while((v >> msb) > 1){
+    msb++;
+  }
+  return (msb - 3) * SUBBUCKETS + (int)((v >> (msb - 4)) & (SUBBUCKETS - 1));
+}
+
+/* the smallest value in a bucket */
+static unsigned long hist_value(int bucket){
+  if(bucket < SUBBUCKETS){
+    return bucket;
+  }
+  return (unsigned long)(SUBBUCKETS + bucket % SUBBUCKETS) <<
+         (bucket / SUBBUCKETS - 1);
+}
+
+/* count one value */
+void hist_add(Histogram *h, double v){
+  unsigned long u = v < 0 ? 0 : (unsigned long)v;
+
+  h->counts[hist_bucket(u)]++;
+  h->total++;
+  if(u > h->max){
+    h->max = u;
+  }
+}
+
+/* the value below which a fraction p of the counted values fall */
+unsigned long hist_percentile(Histogram *h, double p){
+  unsigned long target = (unsigned long)(p * h->total + 0.5), seen = 0;
+  int i;
+
+  if(target == 0){
+    target = 1;
+  }
+  for(i = 0; i < HISTBUCKETS; i++){
+    seen += h->counts[i];
+    if(seen >= target){
+      return hist_value(i);
+    }
+  }
+  return h->max;
+}
+
+/* print a histogram's percentiles on one line */
+void hist_print(const char *label, Histogram *h){
+  printf("%-18s n=%lu p50=%lu p99=%lu p99.9=%lu max=%lu\n", label, h->total,
+         hist_percentile(h, 0.50), hist_percentile(h, 0.99),
+         hist_percentile(h, 0.999), h->max);
+}
@@ -0,0 +1,82 @@
+/*=============================================================================
+|   Title: histogram.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile in the client folder
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  a log-linear histogram of microsecond values, as used by
+|  the benchmark and the client's scripted mode to report latencies, each
+|  power of two is split into 16 buckets so percentiles are within about 6%
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* histogram.h -- public interface to the latency histogram module
+*/
+
+/* the histogram keeps 4 bits of precision in each power of two */
+#define SUBBUCKETS 16
+#define HISTBUCKETS (64 * SUBBUCKETS)
+
+/* a log-linear histogram of microsecond values */
+typedef struct Histogram{
+  unsigned long counts[HISTBUCKETS];
+  unsigned long total;
+  unsigned long max;
+} Histogram;
+
+/*
+* Function:  now_us()
+* --------------------
+* reads the monotonic clock, which every process on a host shares, so a
+* time stamped by one process can be compared with another's
+*
+*  returns: double, the time in microseconds
+*/
+double now_us(void);
+
+/*
+* Function:  hist_add()
+* --------------------
+* counts one value
+*
+* paramaters:
+*  Histogram *h: the histogram
+*  double v: the value, negative values count as 0
+*
+*  returns: NULL
+*/
+void hist_add(Histogram *h, double v);
+
+/*
+* Function:  hist_percentile()
+* --------------------
+* finds the value below which a fraction of the counted values fall
+*
+* paramaters:
+*  Histogram *h: the histogram
+*  double p: the fraction, 0.99 for the 99th percentile
+*
+*  returns: unsigned long, the smallest value of the bucket it falls in
+*/
+unsigned long hist_percentile(Histogram *h, double p);
+
+/*
+* Function:  hist_print()
+* --------------------
+* prints a histogram's count, percentiles and maximum on one line
+*
+* paramaters:
+*  const char *label: printed first
+*  Histogram *h: the histogram
+*
+*  returns: NULL
+*/
+void hist_print(const char *label, Histogram *h);
@@ -0,0 +1,139 @@
+/*=============================================================================
+|   Title: protocol.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile in the client or server folder
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the framed wire protocol, see protocol.h for the
+|  layout of a frame
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "protocol.h"
+
+/* pack a frame header, multi-byte fields are big endian */
+size_t proto_pack_header(unsigned char *hdr, int opcode, int flags, size_t length){
+  hdr[0] = PROTO_VERSION;
+  hdr[1] = (unsigned char)opcode;
+  hdr[2] = (unsigned char)((flags >> 8) & 0xff);
+  hdr[3] = (unsigned char)(flags & 0xff);
+  hdr[4] = (unsigned char)((length >> 24) & 0xff);
+  hdr[5] = (unsigned char)((length >> 16) & 0xff);
+  hdr[6] = (unsigned char)((length >> 8) & 0xff);
+  hdr[7] = (unsigned char)(length & 0xff);
+  return PROTO_HDRLEN;
+}
+
+/* pack a whole frame into buf */
+size_t proto_pack(char *buf, size_t bufsize, int opcode, int flags,
+                  const char *payload, size_t length){
+  if(length > PROTO_MAXPAYLOAD || bufsize < PROTO_HDRLEN + length){
+    return 0;
+  }
+  proto_pack_header((unsigned char *)buf, opcode, flags, length);
+  memcpy(buf + PROTO_HDRLEN, payload, length);
+  return PROTO_HDRLEN + length;
+}
+
+/* prepare a decoder for a new stream */
+void proto_decoder_init(proto_decoder_t *d, size_t maxlen){
+  memset(d, 0, sizeof(proto_decoder_t));
+  d->maxlen = maxlen > PROTO_MAXPAYLOAD ? PROTO_MAXPAYLOAD : maxlen;
+}
+
+/* free the decoder's payload buffer */
+void proto_decoder_free(proto_decoder_t *d){
+  free(d->frame.payload);
+  d->frame.payload = NULL;
+  d->cap = 0;
+}
+
+/*
+ * parse a completed header into d->frame, making sure the payload buffer can
+ * hold the payload plus a terminating NUL
+ */
+static int start_frame(proto_decoder_t *d){
+  size_t length;
+  char *grown;
+
+  if(d->hdr[0] != PROTO_VERSION){
+    return -1;
+  }
+  length = ((size_t)d->hdr[4] << 24) | ((size_t)d->hdr[5] << 16) |
+           ((size_t)d->hdr[6] << 8) | (size_t)d->hdr[7];
+  if(length > d->maxlen){
+    return -1;
+  }
+  if(d->cap < length + 1){
+    grown = (char *)realloc(d->frame.payload, length + 1);
+    if(!grown){
+      return -1;
+    }
+    d->frame.payload = grown;
+    d->cap = length + 1;
+  }
+  d->frame.opcode = d->hdr[1];
+  d->frame.flags = (d->hdr[2] << 8) | d->hdr[3];
+  d->frame.length = length;
+  d->got = 0;
+  return 0;
+}
+
+/* feed stream bytes into the decoder, calling fn for every whole frame */
+int proto_decode(proto_decoder_t *d, const char *data, size_t len,
+                 int (*fn)(proto_frame_t *frame, void *arg), void *arg){
+  size_t take;
+  int rc;
+
+  while(len > 0){
+    /* still collecting the header */
+    if(d->hdrlen < PROTO_HDRLEN){
+      take = PROTO_HDRLEN - d->hdrlen;
+      if(take > len){
+        take = len;
+      }
+      memcpy(d->hdr + d->hdrlen, data, take);
+      d->hdrlen += take;
+      data += take;
+      len -= take;
+      if(d->hdrlen < PROTO_HDRLEN){
+        return 0;
+      }
+      if(start_frame(d) < 0){
+        return -1;
+      }
+    }
+
+    /* collecting the payload */
+    take = d->frame.length - d->got;
+    if(take > len){
+      take = len;
+    }
+    memcpy(d->frame.payload + d->got, data, take);
+    d->got += take;
+    data += take;
+    len -= take;
+    if(d->got < d->frame.length){
+      return 0;
+    }
+
+    /* the frame is complete, hand it over and start on the next one */
+    d->frame.payload[d->frame.length] = '\0';
+    d->hdrlen = 0;
+    d->got = 0;
+    rc = fn(&d->frame, arg);
+    if(rc != 0){
+      return rc;
+    }
+  }
+  return 0;
+}
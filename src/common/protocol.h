@@ -0,0 +1,163 @@
+/*=============================================================================
+|   Title: protocol.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile in the client or server folder
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  the framed wire protocol spoken by the client and the server
+|
+|  every frame is an 8 byte header followed by a variable length payload:
+|
+|      byte 0     protocol version (PROTO_VERSION)
+|      byte 1     opcode, one of the OP_ values below
+|      bytes 2-3  flags, big endian
+|      bytes 4-7  payload length, big endian
+|
+|  a streaming decoder turns an arbitrary sequence of reads (partial frames,
+|  several frames in one read) back into whole frames
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* protocol.h -- public interface to the wire protocol module
+*/
+
+#include <stddef.h>
+
+#define PROTO_VERSION 1
+#define PROTO_HDRLEN 8
+/* largest payload either side will accept in a single frame */
+#define PROTO_MAXPAYLOAD 65536
+
+/* client -> server: the user's screen name, sent once after connecting */
+#define OP_HELLO 1
+/* client -> server: one line typed by the user, a chat line or a /command */
+#define OP_CHAT 2
+/* longest OP_CHAT payload the server accepts, a reply of 2048 bytes has to
+hold it with "[room] name: " in front */
+#define PROTO_MAXLINE 1911
+/* server -> client: text to print for the user */
+#define OP_TEXT 3
+/* server -> client: a keepalive, the client answers with OP_PONG */
+#define OP_PING 4
+/* client -> server: the answer to OP_PING */
+#define OP_PONG 5
+/* server -> client: a user joined or left a room the client is in, sent as
+it happens so a member list stays current without asking for it again:
+room name, NUL, user name */
+#define OP_JOINED 6
+#define OP_LEFT 7
+
+/* server <-> server, on federation links, the flags carry the node id of
+the server the frame started from */
+/* the sending server's node id, sent once after connecting */
+#define OP_LINK_HELLO 16
+/* a user joined or left a room: room name, NUL, user name */
+#define OP_LINK_JOIN 17
+#define OP_LINK_LEAVE 18
+/* a line said in a room: room name, NUL, the text members are sent */
+#define OP_LINK_CHAT 19
+
+/* a decoded frame, payload is always NUL terminated */
+typedef struct proto_frame_t{
+  int opcode;
+  int flags;
+  size_t length;
+  char *payload;
+} proto_frame_t;
+
+/* incremental decoder state, one per connection */
+typedef struct proto_decoder_t{
+  unsigned char hdr[PROTO_HDRLEN];
+  size_t hdrlen;
+  proto_frame_t frame;
+  size_t got;
+  size_t cap;
+  size_t maxlen;
+} proto_decoder_t;
+
+/*
+* Function:  proto_pack_header()
+* --------------------
+* writes a frame header into hdr
+*
+* paramaters:
+*  unsigned char *hdr: PROTO_HDRLEN bytes to fill in
+*  int opcode: the frame's opcode
+*  int flags: the frame's flags
+*  size_t length: the payload length that will follow the header
+*
+*  returns: PROTO_HDRLEN
+*/
+size_t proto_pack_header(unsigned char *hdr, int opcode, int flags, size_t length);
+
+/*
+* Function:  proto_pack()
+* --------------------
+* writes a whole frame, header and payload, into buf
+*
+* paramaters:
+*  char *buf: where to write the frame
+*  size_t bufsize: the size of buf
+*  int opcode: the frame's opcode
+*  int flags: the frame's flags
+*  const char *payload: the payload bytes
+*  size_t length: the payload length
+*
+*  returns: the number of bytes written, 0 if the frame does not fit
+*/
+size_t proto_pack(char *buf, size_t bufsize, int opcode, int flags,
+                  const char *payload, size_t length);
+
+/*
+* Function:  proto_decoder_init()
+* --------------------
+* prepares a decoder for a new stream
+*
+* paramaters:
+*  proto_decoder_t *d: the decoder to set up
+*  size_t maxlen: the largest payload to accept, at most PROTO_MAXPAYLOAD
+*
+*  returns: NULL
+*/
+void proto_decoder_init(proto_decoder_t *d, size_t maxlen);
+
+/*
+* Function:  proto_decoder_free()
+* --------------------
+* frees the payload buffer held by a decoder
+*
+* paramaters:
+*  proto_decoder_t *d: the decoder to clean up
+*
+*  returns: NULL
+*/
+void proto_decoder_free(proto_decoder_t *d);
+
+/*
+* Function:  proto_decode()
+* --------------------
+* feeds bytes read from a stream into the decoder, calling fn once for every
+* frame that is completed, bytes of an unfinished frame are kept until the
+* next call
+*
+* paramaters:
+*  proto_decoder_t *d: the stream's decoder
+*  const char *data: the bytes that were read
+*  size_t len: number of bytes that were read
+*  int (*fn)(proto_frame_t *frame, void *arg): called for each whole frame,
+*        the frame is only valid during the call, return 0 to keep going
+*  void *arg: passed through to fn
+*
+*  returns: 0 if successful, -1 on a malformed frame, otherwise the
+*           non-zero value returned by fn (decoding stops there)
+*/
+int proto_decode(proto_decoder_t *d, const char *data, size_t len,
+                 int (*fn)(proto_frame_t *frame, void *arg), void *arg);
@@ -0,0 +1,212 @@
+/*=============================================================================
+ |   Title:  alloctest.c
+ |
+ |       Author:  Grace Miller
+ |     Language:  C
+ |   To Compile:  Run the Makefile in the server folder (make check)
+ |
+ |        Class:  CS 63 Programming Parallel Systems
+ |     Due Date:  10/17/2026
+ |
+ +-----------------------------------------------------------------------------
+ |
+ |  Description:  checks that broadcasting makes no heap allocations once the
+ |              pools and arenas have warmed up, using the server's own
+ |              heap_allocs counter fed by the same --wrap'd allocator
+ |
+ |              each round frames lines the way the server does, walks a
+ |              room's member snapshot, queues every line on each member's
+ |              outbound queue in bursts deeper than the smallest ring,
+ |              flushes them, records them in the room's history and reads
+ |              the history back as for '/history', with short lines and
+ |              lines as long as the server takes
+ |
+ |        Input:  ./alloctest [RECIPIENTS] [ROUNDS]
+ |              RECIPIENTS- sockets each line goes to, defaults to 64
+ |              ROUNDS- rounds counted after the warm up, defaults to 20
+ |
+ |       Output:  the allocations counted, exits 1 if there were any
+ |
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "protocol.h"
+#include "msgbuf.h"
+#include "outbuf.h"
+#include "snapshot.h"
+#include "room.h"
+#include "arena.h"
+#include "stats.h"
+
+#define MAXPENDING (256 * 1024)
+#define SCRATCHSIZE (64 * 1024)
+/* lines sent to the room back to back in one round */
+#define BURST 100
+/* rounds run before counting, enough for every pool and arena to grow */
+#define WARMUP 3
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_realloc(ptr, size);
+}
+
+/* a member of the test room, one end of a socket pair */
+typedef struct member_t{
+  int sock;
+  int peer;
+  outbuf_t outbuf;
+} member_t;
+
+/* read and throw away everything waiting on the receiving ends */
+void drain(member_t *members, int n){
+  char buf[65536];
+  int i;
+
+  for(i = 0; i < n; i++){
+    while(recv(members[i].peer, buf, sizeof(buf), MSG_DONTWAIT) > 0){
+    }
+  }
+}
+
+/* write every queue out, reading the other ends until they are empty */
+void flush(member_t *members, int n){
+  size_t pending;
+  int i;
+
+  do{
+    pending = 0;
+    for(i = 0; i < n; i++){
+      outbuf_flush(&members[i].outbuf, members[i].sock);
+      pending += outbuf_pending(&members[i].outbuf);
+    }
+    drain(members, n);
+  }while(pending > 0);
+}
+
+/* send a burst of lines of one length to the room and read its history */
+void round_trip(Room *room, member_t *members, int n, size_t linelen,
+                arena_t *scratch){
+  msgbuf_t *frames[ROOMHISTORY];
+  snapshot_t *snap;
+  member_t *m;
+  msgbuf_t *mb;
+  char line[PROTO_MAXLINE];
+  int b, i, found;
+
+  memset(line, 'x', linelen);
+  line[linelen - 1] = '\n';
+  for(b = 0; b < BURST; b++){
+    if(!(mb = msgbuf_frame(OP_TEXT, 0, "alice: ", strlen("alice: "), line,
+                           linelen))){
+      printf("could not frame a line of %lu bytes\n", (unsigned long)linelen);
+      exit(1);
+    }
+    snap = snapset_acquire(room->members[0]);
+    for(i = 0; i < snap->count; i++){
+      m = (member_t *)snap->items[i];
+      outbuf_queue(&m->outbuf, mb);
+    }
+    snapshot_release(snap);
+    room_record(room, 0, mb);
+    msgbuf_release(mb);
+  }
+  /* the queues hold the whole burst until they are flushed */
+  flush(members, n);
+  found = room_history(room, ROOMHISTORY, frames, scratch);
+  for(i = 0; i < found; i++){
+    outbuf_queue(&members[0].outbuf, frames[i]);
+    msgbuf_release(frames[i]);
+  }
+  flush(members, 1);
+  arena_reset(scratch);
+}
+
+/* the heap allocations counted so far, read back from the stats snapshot */
+unsigned long heap_allocs(void){
+  static char snapshot[16384];
+  char *p;
+
+  stats_format(snapshot, sizeof(snapshot), STATS_TEXT);
+  p = strstr(snapshot, "\nheap_allocs ");
+  return p ? strtoul(p + strlen("\nheap_allocs "), NULL, 10) : 0;
+}
+
+int main(int argc, char* argv[]){
+  int recipients = 64, rounds = 20;
+  int pair[2], i, r;
+  member_t *members;
+  snap_reader_t *reader;
+  roomdir_t *dir;
+  Room *room = NULL;
+  arena_t *scratch;
+  unsigned long before = 0, after;
+
+  if(argc > 1){
+    recipients = atoi(argv[1]);
+  }
+  if(argc > 2){
+    rounds = atoi(argv[2]);
+  }
+  members = (member_t *)malloc(sizeof(member_t) * recipients);
+  if(!members || recipients <= 0 || rounds <= 0 ||
+     !(reader = snap_register()) || !(dir = roomdir_open(64, 1)) ||
+     !(scratch = arena_open(SCRATCHSIZE))){
+    printf("could not set up the test\n");
+    return(1);
+  }
+  for(i = 0; i < recipients; i++){
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) < 0){
+      perror("socketpair");
+      return(1);
+    }
+    members[i].sock = pair[0];
+    members[i].peer = pair[1];
+    outbuf_init(&members[i].outbuf, MAXPENDING, 0);
+    if(!(room = room_join(dir, "lobby", &members[i], 0))){
+      printf("could not join the test room\n");
+      return(1);
+    }
+  }
+
+  for(r = 0; r < WARMUP + rounds; r++){
+    if(r == WARMUP){
+      before = heap_allocs();
+    }
+    round_trip(room, members, recipients, 64, scratch);
+    round_trip(room, members, recipients, PROTO_MAXLINE, scratch);
+    snap_quiescent(reader);
+  }
+  after = heap_allocs();
+
+  printf("broadcast path: %lu heap allocations over %d lines to %d "
+         "recipients\n", after - before, rounds * 2 * BURST, recipients);
+  for(i = 0; i < recipients; i++){
+    outbuf_free(&members[i].outbuf);
+    close(members[i].sock);
+    close(members[i].peer);
+  }
+  free(members);
+  return(after == before ? 0 : 1);
+}
@@ -0,0 +1,151 @@
+/*=============================================================================
+|   Title: arena.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a per thread scratch arena, see arena.h
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "arena.h"
+
+/* every allocation starts on a multiple of this */
+#define ARENA_ALIGN 16
+#define ALIGNED(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct block_t{
+  struct block_t *next;
+  size_t size;
+} block_t;
+
+struct arena_t{
+  block_t *first;
+  /* the block being bumped through, and the bytes of it used */
+  block_t *current;
+  size_t used;
+  size_t size;
+  unsigned long blocks;
+};
+
+/* the bytes of a block, after its header */
+static char *block_data(block_t *b){
+  return (char *)b + ALIGNED(sizeof(block_t));
+}
+
+/* take a block holding at least size bytes from the heap */
+static block_t *new_block(arena_t *a, size_t size){
+  block_t *b = (block_t *)malloc(ALIGNED(sizeof(block_t)) + size);
+
+  if(b){
+    b->next = NULL;
+    b->size = size;
+    a->blocks++;
+  }
+  return b;
+}
+
+/* create an arena with one block */
+arena_t *arena_open(size_t size){
+  arena_t *a = (arena_t *)malloc(sizeof(arena_t));
+
+  if(!a){
+    return NULL;
+  }
+  a->size = ALIGNED(size);
+  a->blocks = 0;
+  if(!(a->first = new_block(a, a->size))){
+    free(a);
+    return NULL;
+  }
+  a->current = a->first;
+  a->used = 0;
+  return a;
+}
+
+/* free the arena and its blocks */
+void arena_close(arena_t *a){
+  block_t *b, *next;
+
+  for(b = a->first; b; b = next){
+    next = b->next;
+    free(b);
+  }
+  free(a);
+}
+
+/* bump through the blocks, adding one at the end if none has room */
+void *arena_alloc(arena_t *a, size_t n){
+  char *p;
+
+  n = ALIGNED(n ? n : 1);
+  for(;;){
+    if(a->used + n <= a->current->size){
+      p = block_data(a->current) + a->used;
+      a->used += n;
+      return p;
+    }
+    if(!a->current->next &&
+       !(a->current->next = new_block(a, n > a->size ? n : a->size))){
+      return NULL;
+    }
+    a->current = a->current->next;
+    a->used = 0;
+  }
+}
+
+/* format into the room left in the current block, or into an allocation
+sized by a first try that did not fit */
+char *arena_printf(arena_t *a, size_t *len, const char *fmt, ...){
+  size_t room = a->current->size - a->used;
+  char *p = block_data(a->current) + a->used;
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(p, room, fmt, ap);
+  va_end(ap);
+  if(n < 0){
+    return NULL;
+  }
+  if((size_t)n < room){
+    a->used += ALIGNED((size_t)n + 1);
+    if(a->used > a->current->size){
+      a->used = a->current->size;
+    }
+  }else{
+    if(!(p = (char *)arena_alloc(a, (size_t)n + 1))){
+      return NULL;
+    }
+    va_start(ap, fmt);
+    vsnprintf(p, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+  }
+  if(len){
+    *len = (size_t)n;
+  }
+  return p;
+}
+
+/* rewind to the start of the first block */
+void arena_reset(arena_t *a){
+  a->current = a->first;
+  a->used = 0;
+}
+
+/* blocks taken from the heap so far */
+unsigned long arena_blocks(arena_t *a){
+  return a->blocks;
+}
@@ -0,0 +1,115 @@
+/*=============================================================================
+|   Title: arena.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a bump allocator for scratch memory that only
+|  lives while one message is handled, such as the text of a reply, each
+|  event loop thread owns one and resets it once the message is done
+|
+|  an allocation is a pointer bump in the current block, nothing is freed on
+|  its own, a reset rewinds to the first block, a message needing more than
+|  the blocks hold takes another block from the heap, which is kept, so once
+|  the blocks have grown to the biggest message handled every allocation
+|  after that is served without going to the heap
+|
+|  an arena is used by one thread only and takes no lock
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* arena.h -- public interface to the scratch arena module
+*/
+
+#include <stddef.h>
+
+/* the arena representation is hidden from users of the module */
+typedef struct arena_t arena_t;
+
+/*
+* Function:  arena_open()
+* --------------------
+* creates an empty arena
+*
+* paramaters:
+*  size_t size: the size of its first block, later blocks are at least this
+*        big
+*
+*  returns: arena_t*, the arena, NULL if out of memory
+*/
+arena_t *arena_open(size_t size);
+
+/*
+* Function:  arena_close()
+* --------------------
+* frees an arena and everything allocated from it
+*
+* paramaters:
+*  arena_t *a: the arena
+*
+*  returns: NULL
+*/
+void arena_close(arena_t *a);
+
+/*
+* Function:  arena_alloc()
+* --------------------
+* allocates scratch memory, suitably aligned for any type, that stays valid
+* until the next arena_reset()
+*
+* paramaters:
+*  arena_t *a: the arena
+*  size_t n: the bytes wanted
+*
+*  returns: void*, the memory, NULL if out of memory
+*/
+void *arena_alloc(arena_t *a, size_t n);
+
+/*
+* Function:  arena_printf()
+* --------------------
+* formats a string like sprintf() into scratch memory just big enough for
+* it, valid until the next arena_reset()
+*
+* paramaters:
+*  arena_t *a: the arena
+*  size_t *len: set to the length of the string if not NULL
+*  const char *fmt: the format, followed by its arguments
+*
+*  returns: char*, the NUL terminated string, NULL if out of memory
+*/
+char *arena_printf(arena_t *a, size_t *len, const char *fmt, ...);
+
+/*
+* Function:  arena_reset()
+* --------------------
+* gives back everything allocated from an arena at once, its blocks are
+* kept for the next message
+*
+* paramaters:
+*  arena_t *a: the arena
+*
+*  returns: NULL
+*/
+void arena_reset(arena_t *a);
+
+/*
+* Function:  arena_blocks()
+* --------------------
+* the number of blocks an arena has taken from the heap, which stops
+* growing once the arena is big enough for every message
+*
+* paramaters:
+*  arena_t *a: the arena
+*
+*  returns: unsigned long, the number of blocks
+*/
+unsigned long arena_blocks(arena_t *a);
@@ -0,0 +1,516 @@
+/*=============================================================================
+|   Title: chatlog.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the durable chat log, see chatlog.h
+|
+|  segments are named chat-NNNNNNNN.log and hold records laid end to end:
+|
+|      4 bytes   length of what follows up to the trailer, big endian
+|      1 byte    length of the room name
+|      n bytes   the room name
+|      m bytes   the frame as it was sent to the room
+|      4 bytes   the length again, so the log can be read backwards
+|
+|  a new segment is sized to SEGMENTBYTES up front and mapped, the writer
+|  fills it with pwritev() and publishes how much it has written, readers
+|  never look past that, a full segment is synced and cut down to what was
+|  written, the mapping stays for the life of the server
+|
+|  the writer is woken through an eventfd, as a reactor is for its mail,
+|  and only by the first line after it last synced, it then sleeps out the
+|  rest of the sync interval, so every line queued in one interval goes out
+|  in one pwritev() (of up to LOGBATCH records) and one fdatasync()
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+
+#include "queue.h"
+#include "lqueue.h"
+#include "pool.h"
+#include "stats.h"
+#include "chatlog.h"
+
+/* size of a segment file */
+#define SEGMENTBYTES (8 * 1024 * 1024)
+/* most segments a log can hold */
+#define MAXSEGMENTS 16384
+/* longest room name logged */
+#define LOGNAMEMAX 64
+/* most records gathered into one write */
+#define LOGBATCH 256
+/* segments searched back through for a room's lines */
+#define SCANSEGMENTS 8
+#define PATHLENGTH 512
+
+typedef struct segment_t{
+  unsigned long id;
+  char *base;
+  /* bytes of records written, readers never look past it */
+  size_t len;
+} segment_t;
+
+/* a line waiting for the writer, with its record's head and trailer */
+typedef struct entry_t{
+  msgbuf_t *mb;
+  size_t headlen;
+  unsigned char head[5 + LOGNAMEMAX];
+  unsigned char tail[4];
+} entry_t;
+
+struct chatlog_t{
+  char dir[PATHLENGTH];
+  unsigned long sync_ns;
+  lqueue_t *queue;
+  pool_t *entries;
+  /* written to wake the writer, only while wake_pending was clear */
+  int wakefd;
+  int wake_pending;
+  /* the segment being written and its file */
+  segment_t *current;
+  int fd;
+  /* every segment, oldest first, published for readers by nsegments */
+  segment_t *segments[MAXSEGMENTS];
+  int nsegments;
+  pthread_t thread;
+};
+
+/* nanoseconds on the monotonic clock */
+static unsigned long now_ns(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* read a 4 byte big endian length */
+static size_t get_len(const char *p){
+  uint32_t v;
+
+  memcpy(&v, p, 4);
+  return ntohl(v);
+}
+
+/* put a 4 byte big endian length */
+static void put_len(unsigned char *p, size_t len){
+  uint32_t v = htonl((uint32_t)len);
+
+  memcpy(p, &v, 4);
+}
+
+/* the file name of a segment */
+static void segment_path(chatlog_t *log, unsigned long id, char *path){
+  snprintf(path, PATHLENGTH, "%s/chat-%08lu.log", log->dir, id);
+}
+
+/* add a mapped segment to the list readers see */
+static int publish(chatlog_t *log, unsigned long id, char *base, size_t len){
+  segment_t *seg;
+
+  if(log->nsegments == MAXSEGMENTS ||
+     !(seg = (segment_t *)malloc(sizeof(segment_t)))){
+    return -1;
+  }
+  seg->id = id;
+  seg->base = base;
+  seg->len = len;
+  log->segments[log->nsegments] = seg;
+  __atomic_store_n(&log->nsegments, log->nsegments + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* the length of the records in a segment up to the first damaged one */
+static size_t valid_length(const char *base, size_t size){
+  size_t off = 0, len;
+
+  while(size - off >= 9){
+    len = get_len(base + off);
+    if(len == 0 || len > size - off - 8 || (unsigned char)base[off + 4] >= len ||
+       get_len(base + off + 4 + len) != len){
+      break;
+    }
+    off += len + 8;
+  }
+  return off;
+}
+
+/* map an existing segment, cutting off anything after its last whole record */
+static int recover_segment(chatlog_t *log, unsigned long id){
+  char path[PATHLENGTH];
+  struct stat st;
+  char *base = NULL;
+  size_t len = 0;
+  int fd;
+
+  segment_path(log, id, path);
+  if((fd = open(path, O_RDWR)) < 0 || fstat(fd, &st) < 0){
+    perror("could not open log segment");
+    if(fd >= 0){
+      close(fd);
+    }
+    return -1;
+  }
+  if(st.st_size > 0){
+    base = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(base == MAP_FAILED){
+      perror("could not map log segment");
+      close(fd);
+      return -1;
+    }
+    len = valid_length(base, st.st_size);
+    if(len < (size_t)st.st_size){
+      printf("log segment %s cut to %lu bytes\n", path, (unsigned long)len);
+      if(ftruncate(fd, len) < 0){
+        perror("could not cut log segment");
+      }
+    }
+  }
+  close(fd);
+  /* a segment the server never wrote to before it stopped is of no use */
+  if(len == 0){
+    if(base){
+      munmap(base, st.st_size);
+    }
+    unlink(path);
+    return 0;
+  }
+  return publish(log, id, base, len);
+}
+
+/* comparator for sorting segment ids */
+static int by_id(const void *a, const void *b){
+  unsigned long ia = *(const unsigned long *)a, ib = *(const unsigned long *)b;
+
+  return ia < ib ? -1 : ia > ib;
+}
+
+/* map every segment in the directory, returns the next segment id */
+static long recover(chatlog_t *log){
+  unsigned long *ids, id, next = 0;
+  struct dirent *de;
+  DIR *d;
+  int n = 0, i;
+
+  if(!(ids = (unsigned long *)malloc(sizeof(unsigned long) * MAXSEGMENTS)) ||
+     !(d = opendir(log->dir))){
+    free(ids);
+    return -1;
+  }
+  while((de = readdir(d)) != NULL && n < MAXSEGMENTS){
+    if(strlen(de->d_name) == 17 && sscanf(de->d_name, "chat-%8lu.log", &id) == 1){
+      ids[n++] = id;
+    }
+  }
+  closedir(d);
+  qsort(ids, n, sizeof(unsigned long), by_id);
+  for(i = 0; i < n; i++){
+    recover_segment(log, ids[i]);
+    next = ids[i] + 1;
+  }
+  free(ids);
+  return (long)next;
+}
+
+/* create and map the next segment */
+static int open_segment(chatlog_t *log, unsigned long id){
+  char path[PATHLENGTH];
+  char *base;
+  int fd;
+
+  segment_path(log, id, path);
+  if((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0){
+    perror("could not create log segment");
+    return -1;
+  }
+  if(ftruncate(fd, SEGMENTBYTES) < 0 ||
+     (base = (char *)mmap(NULL, SEGMENTBYTES, PROT_READ, MAP_SHARED, fd, 0))
+       == MAP_FAILED){
+    perror("could not map log segment");
+    close(fd);
+    return -1;
+  }
+  if(publish(log, id, base, 0) < 0){
+    munmap(base, SEGMENTBYTES);
+    close(fd);
+    return -1;
+  }
+  log->current = log->segments[log->nsegments - 1];
+  log->fd = fd;
+  return 0;
+}
+
+/* sync a full segment, cut it to what was written and start the next */
+static int roll_segment(chatlog_t *log){
+  if(fdatasync(log->fd) < 0 || ftruncate(log->fd, log->current->len) < 0){
+    perror("could not close log segment");
+  }
+  stats_add(STAT_LOG_SYNCS, 1);
+  close(log->fd);
+  return open_segment(log, log->current->id + 1);
+}
+
+/* write a batch of records to the current segment with one pwritev(),
+readers are only shown the batch once all of it is written, so they never
+see part of a record */
+static void write_batch(chatlog_t *log, entry_t **batch, int n){
+  struct iovec iov[3 * LOGBATCH], *v = iov;
+  size_t start = log->current->len, len = 0, whole = 0, rec;
+  size_t written = 0;
+  ssize_t done;
+  int i, iovcnt = 3 * n, failed = 0, kept = n;
+
+  for(i = 0; i < n; i++){
+    iov[3 * i].iov_base = batch[i]->head;
+    iov[3 * i].iov_len = batch[i]->headlen;
+    iov[3 * i + 1].iov_base = batch[i]->mb->data;
+    iov[3 * i + 1].iov_len = batch[i]->mb->len;
+    iov[3 * i + 2].iov_base = batch[i]->tail;
+    iov[3 * i + 2].iov_len = 4;
+    len += batch[i]->headlen + batch[i]->mb->len + 4;
+  }
+  /* a regular file only takes less than everything when the disk is full */
+  while(iovcnt > 0){
+    done = pwritev(log->fd, v, iovcnt, log->current->len);
+    if(done < 0){
+      if(errno == EINTR){
+        continue;
+      }
+      perror("could not write the log");
+      failed = 1;
+      break;
+    }
+    written += done;
+    while(iovcnt > 0 && (size_t)done >= v->iov_len){
+      done -= v->iov_len;
+      v++;
+      iovcnt--;
+    }
+    if(iovcnt > 0){
+      v->iov_base = (char *)v->iov_base + done;
+      v->iov_len -= done;
+    }
+  }
+  if(failed){
+    /* keep the records written in full, the torn one after them is zeroed
+    so recovery stops there too, the segment keeps its size */
+    for(i = 0; i < n; i++){
+      rec = batch[i]->headlen + batch[i]->mb->len + 4;
+      if(whole + rec > written){
+        break;
+      }
+      whole += rec;
+    }
+    if(ftruncate(log->fd, start + whole) < 0 ||
+       ftruncate(log->fd, SEGMENTBYTES) < 0){
+      perror("could not cut the log");
+    }
+    stats_add(STAT_LOG_DROPS, n - i);
+    len = whole;
+    kept = i;
+  }
+  __atomic_store_n(&log->current->len, start + len, __ATOMIC_RELEASE);
+  stats_add(STAT_LOG_WRITES, 1);
+  stats_add(STAT_LOG_RECORDS, kept);
+  for(i = 0; i < n; i++){
+    msgbuf_release(batch[i]->mb);
+    pool_put(log->entries, batch[i]);
+  }
+}
+
+/* body of the writer thread, wakes for the first line queued, waits out
+the rest of the sync interval while more lines queue up, then writes them
+all and syncs once */
+static void *write_log(void *arg){
+  chatlog_t *log = (chatlog_t *)arg;
+  entry_t *batch[LOGBATCH], *entry;
+  unsigned long last_sync = 0, now, size;
+  struct pollfd pfd;
+  struct timespec ts;
+  uint64_t count;
+  int n, written;
+
+  pfd.fd = log->wakefd;
+  pfd.events = POLLIN;
+  while(1){
+    if(poll(&pfd, 1, -1) < 0 ||
+       (read(log->wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN)){
+      continue;
+    }
+    /* wake_pending stays set while we wait, so the event loops queueing
+    lines in the meantime do not write to the eventfd */
+    now = now_ns();
+    if(now - last_sync < log->sync_ns){
+      ts.tv_sec = (last_sync + log->sync_ns - now) / 1000000000UL;
+      ts.tv_nsec = (last_sync + log->sync_ns - now) % 1000000000UL;
+      while(nanosleep(&ts, &ts) < 0 && errno == EINTR){
+      }
+    }
+    /* cleared before draining, so lines queued from here on wake us again */
+    __atomic_store_n(&log->wake_pending, 0, __ATOMIC_SEQ_CST);
+
+    n = 0;
+    written = 0;
+    size = log->current ? log->current->len : 0;
+    while((entry = (entry_t *)lqget(log->queue)) != NULL){
+      if(log->current &&
+         size + entry->headlen + entry->mb->len + 4 > SEGMENTBYTES){
+        if(n > 0){
+          write_batch(log, batch, n);
+          n = 0;
+        }
+        if(roll_segment(log) < 0){
+          log->current = NULL;
+        }
+        size = 0;
+      }
+      if(!log->current){
+        msgbuf_release(entry->mb);
+        pool_put(log->entries, entry);
+        continue;
+      }
+      batch[n++] = entry;
+      size += entry->headlen + entry->mb->len + 4;
+      if(n == LOGBATCH){
+        write_batch(log, batch, n);
+        n = 0;
+      }
+      written = 1;
+    }
+    if(n > 0){
+      write_batch(log, batch, n);
+    }
+    if(written && log->current){
+      if(fdatasync(log->fd) < 0){
+        perror("could not sync the log");
+      }
+      stats_add(STAT_LOG_SYNCS, 1);
+    }
+    last_sync = now_ns();
+  }
+  return NULL;
+}
+
+/* open the log in a directory and start its writer */
+chatlog_t *chatlog_open(const char *dir, long sync_ms){
+  chatlog_t *log;
+  long next;
+
+  if(strlen(dir) + 20 >= PATHLENGTH ||
+     !(log = (chatlog_t *)calloc(1, sizeof(chatlog_t)))){
+    return NULL;
+  }
+  strcpy(log->dir, dir);
+  log->sync_ns = sync_ms > 0 ? (unsigned long)sync_ms * 1000000 : 0;
+  if(mkdir(dir, 0755) < 0 && errno != EEXIST){
+    perror("could not create the log directory");
+    free(log);
+    return NULL;
+  }
+  log->queue = lqopen();
+  log->entries = pool_open("logentry", sizeof(entry_t));
+  log->wakefd = eventfd(0, EFD_NONBLOCK);
+  if(!log->queue || !log->entries || log->wakefd < 0 ||
+     (next = recover(log)) < 0 || open_segment(log, next) < 0 ||
+     pthread_create(&log->thread, NULL, write_log, log) != 0){
+    perror("could not open the log");
+    return NULL;
+  }
+  pthread_detach(log->thread);
+  return log;
+}
+
+/* hand a line to the writer */
+int chatlog_append(chatlog_t *log, const char *room, msgbuf_t *mb){
+  size_t namelen = strlen(room);
+  entry_t *entry;
+  uint64_t one = 1;
+
+  if(namelen > LOGNAMEMAX || !(entry = (entry_t *)pool_get(log->entries))){
+    return -1;
+  }
+  put_len(entry->head, 1 + namelen + mb->len);
+  entry->head[4] = (unsigned char)namelen;
+  memcpy(entry->head + 5, room, namelen);
+  entry->headlen = 5 + namelen;
+  put_len(entry->tail, 1 + namelen + mb->len);
+  entry->mb = msgbuf_hold(mb);
+  if(lqput(log->queue, entry) != 0){
+    msgbuf_release(mb);
+    pool_put(log->entries, entry);
+    return -1;
+  }
+  if(!__atomic_exchange_n(&log->wake_pending, 1, __ATOMIC_SEQ_CST)){
+    if(write(log->wakefd, &one, sizeof(one)) < 0){
+      perror("could not wake the log writer");
+    }
+  }
+  return 0;
+}
+
+/* the newest lines of a room, read backwards out of the mapped segments */
+int chatlog_history(chatlog_t *log, const char *room, int n, msgbuf_t **frames){
+  int nsegments = __atomic_load_n(&log->nsegments, __ATOMIC_ACQUIRE);
+  size_t namelen = strlen(room), end, len;
+  segment_t *seg;
+  msgbuf_t *tmp;
+  const char *rec;
+  int found = 0, s, i;
+
+  for(s = nsegments - 1; s >= 0 && s >= nsegments - SCANSEGMENTS && found < n;
+      s--){
+    seg = log->segments[s];
+    end = __atomic_load_n(&seg->len, __ATOMIC_ACQUIRE);
+    while(end >= 9 && found < n){
+      len = get_len(seg->base + end - 4);
+      /* a record that does not add up ends the walk through this segment */
+      if(len == 0 || len > end - 8 ||
+         get_len(seg->base + end - 8 - len) != len ||
+         (unsigned char)seg->base[end - 4 - len] >= len){
+        break;
+      }
+      rec = seg->base + end - 4 - len;
+      if((unsigned char)rec[0] == namelen &&
+         memcmp(rec + 1, room, namelen) == 0){
+        if(!(frames[found] = msgbuf_wrap(rec + 1 + namelen,
+                                         len - 1 - namelen))){
+          break;
+        }
+        found++;
+      }
+      end -= len + 8;
+    }
+  }
+
+  for(i = 0; i < found / 2; i++){
+    tmp = frames[i];
+    frames[i] = frames[found - 1 - i];
+    frames[found - 1 - i] = tmp;
+  }
+  return found;
+}
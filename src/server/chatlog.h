@@ -0,0 +1,85 @@
+/*=============================================================================
+|   Title: chatlog.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a durable, append only log of chat lines kept in
+|  a directory of fixed size segment files, so what was said survives the
+|  server
+|
+|  appending only hands the line to a queue, a writer thread of the log's
+|  own gathers everything queued into one write and makes it durable with
+|  fdatasync() at most once per sync interval (group commit), so no event
+|  loop ever waits on the disk, a line is lost only if the machine goes
+|  down before the next sync
+|
+|  every segment is memory mapped once it is created, or found when the log
+|  is opened, and stays mapped, lines are read straight out of the mapping
+|  without a copy and without a lock
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* chatlog.h -- public interface to the chat log module
+*/
+
+#include "msgbuf.h"
+
+/* the log representation is hidden from users of the module */
+typedef struct chatlog_t chatlog_t;
+
+/*
+* Function:  chatlog_open()
+* --------------------
+* opens the log in a directory, maps the segments already there, cutting
+* off a line left half written by a crash, and starts the writer thread,
+* new lines go to a new segment
+*
+* paramaters:
+*  const char *dir: the directory, created if it does not exist
+*  long sync_ms: the longest a written line waits for fdatasync(), 0 syncs
+*        after every write
+*
+*  returns: chatlog_t*, the log, NULL if not successful
+*/
+chatlog_t *chatlog_open(const char *dir, long sync_ms);
+
+/*
+* Function:  chatlog_append()
+* --------------------
+* queues a line for the writer thread, never blocks on the disk
+*
+* paramaters:
+*  chatlog_t *log: the log
+*  const char *room: the room the line was said in
+*  msgbuf_t *mb: the framed line, held until it is written
+*
+*  returns: 0 if successful, -1 if the line could not be queued
+*/
+int chatlog_append(chatlog_t *log, const char *room, msgbuf_t *mb);
+
+/*
+* Function:  chatlog_history()
+* --------------------
+* finds the newest lines written for a room, searching the newest segments
+* back from what the writer has finished, each line is a msgbuf wrapping
+* the frame in the mapped segment, so sending it copies nothing
+*
+* paramaters:
+*  chatlog_t *log: the log
+*  const char *room: the room
+*  int n: the most lines to find
+*  msgbuf_t **frames: where to put them, room for n, oldest first, each
+*        holds a reference for the caller
+*
+*  returns: int, the number of lines found
+*/
+int chatlog_history(chatlog_t *log, const char *room, int n, msgbuf_t **frames);
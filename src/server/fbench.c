@@ -0,0 +1,192 @@
+/*=============================================================================
+ |   Title:  fbench.c
+ |
+ |       Author:  Grace Miller
+ |     Language:  C
+ |   To Compile:  Run the Makefile in the server folder (make fbench)
+ |
+ |        Class:  CS 63 Programming Parallel Systems
+ |     Due Date:  10/17/2026
+ |
+ +-----------------------------------------------------------------------------
+ |
+ |  Description:  measures what one broadcast costs in heap allocations, bytes
+ |              and time, comparing shared msgbufs sent through each
+ |              recipient's outbound queue with the old approach of building
+ |              the reply with malloc() and sending a full BUFFERSIZE copy to
+ |              every recipient
+ |
+ |              every malloc(), calloc() and realloc() made by the benchmark
+ |              is counted by wrapping them at link time
+ |
+ |        Input:  ./fbench [RECIPIENTS] [BROADCASTS]
+ |              RECIPIENTS- sockets each broadcast goes to, defaults to 1000
+ |              BROADCASTS- broadcasts timed, defaults to 200
+ |
+ |       Output:  one line per approach with allocations per broadcast, bytes
+ |              per recipient and nanoseconds per broadcast
+ |
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "protocol.h"
+#include "msgbuf.h"
+#include "outbuf.h"
+
+#define NAMELENGTH 100
+#define BUFFERSIZE 2048
+#define MAXPENDING (256 * 1024)
+
+/* allocation counter fed by the --wrap'd allocator functions */
+static unsigned long allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size){
+  allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size){
+  allocs++;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size){
+  allocs++;
+  return __real_realloc(ptr, size);
+}
+
+/* nanoseconds on the monotonic clock */
+double now_ns(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* read and throw away everything waiting on the receiving ends */
+void drain(int *peers, int n){
+  char buf[65536];
+  int i;
+
+  for(i = 0; i < n; i++){
+    while(recv(peers[i], buf, sizeof(buf), MSG_DONTWAIT) > 0){
+    }
+  }
+}
+
+int main(int argc, char* argv[]){
+  int recipients = 1000, broadcasts = 200;
+  int *socks, *peers, pair[2], i, b;
+  outbuf_t *obs;
+  const char *name = "alice";
+  const char *line = "hi\n";
+  unsigned long start_allocs, bytes;
+  double start, elapsed;
+  struct rlimit rl;
+
+  if(argc > 1){
+    recipients = atoi(argv[1]);
+  }
+  if(argc > 2){
+    broadcasts = atoi(argv[2]);
+  }
+  if(getrlimit(RLIMIT_NOFILE, &rl) == 0){
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  socks = (int *)malloc(sizeof(int) * recipients);
+  peers = (int *)malloc(sizeof(int) * recipients);
+  obs = (outbuf_t *)malloc(sizeof(outbuf_t) * recipients);
+  if(!socks || !peers || !obs || recipients <= 0 || broadcasts <= 0){
+    printf("could not set up the benchmark\n");
+    return(1);
+  }
+  for(i = 0; i < recipients; i++){
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) < 0){
+      perror("socketpair");
+      return(1);
+    }
+    socks[i] = pair[0];
+    peers[i] = pair[1];
+    outbuf_init(&obs[i], MAXPENDING, 0);
+  }
+
+  printf("%-10s %10s %10s %16s %18s %14s\n", "approach", "recipients",
+         "broadcasts", "allocs_per_bcast", "bytes_per_recipient", "ns_per_bcast");
+
+  /* the old approach, two mallocs to build the line, a full buffer each */
+  elapsed = 0;
+  start_allocs = allocs;
+  for(b = 0; b < broadcasts; b++){
+    char *src, *dest;
+
+    start = now_ns();
+    src = malloc(sizeof(char)*BUFFERSIZE);
+    dest = malloc(sizeof(char)*BUFFERSIZE);
+    strcpy(src, name);
+    strcat(src, ": ");
+    strcpy(dest, line);
+    strcat(src, dest);
+    for(i = 0; i < recipients; i++){
+      send(socks[i], src, BUFFERSIZE + NAMELENGTH, MSG_DONTWAIT);
+    }
+    elapsed += now_ns() - start;
+    /* the old server leaked both buffers, free them here to keep going */
+    free(src);
+    free(dest);
+    drain(peers, recipients);
+  }
+  printf("%-10s %10d %10d %16.2f %18d %14.0f\n", "copy", recipients, broadcasts,
+         (double)(allocs - start_allocs) / broadcasts, BUFFERSIZE + NAMELENGTH,
+         elapsed / broadcasts);
+
+  /* shared msgbufs through the outbound queues, as the server does now */
+  elapsed = 0;
+  start_allocs = allocs;
+  bytes = 0;
+  for(b = 0; b < broadcasts; b++){
+    msgbuf_t *mb;
+
+    start = now_ns();
+    mb = msgbuf_frame(OP_TEXT, 0, "alice: ", strlen("alice: "), line,
+                      strlen(line));
+    for(i = 0; i < recipients; i++){
+      outbuf_send(&obs[i], socks[i], mb);
+    }
+    bytes = mb->len;
+    msgbuf_release(mb);
+    elapsed += now_ns() - start;
+    drain(peers, recipients);
+    for(i = 0; i < recipients; i++){
+      outbuf_flush(&obs[i], socks[i]);
+    }
+  }
+  printf("%-10s %10d %10d %16.2f %18lu %14.0f\n", "shared", recipients,
+         broadcasts, (double)(allocs - start_allocs) / broadcasts, bytes,
+         elapsed / broadcasts);
+
+  for(i = 0; i < recipients; i++){
+    outbuf_free(&obs[i]);
+    close(socks[i]);
+    close(peers[i]);
+  }
+  free(socks);
+  free(peers);
+  free(obs);
+  return(0);
+}
@@ -0,0 +1,773 @@
+/*=============================================================================
+|   Title: federation.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements links between chat servers, see federation.h
+|
+|  links speak the framed protocol of protocol.h with the OP_LINK_ opcodes,
+|  each side starts with a hello carrying its node id, only then are joins,
+|  leaves and lines exchanged
+|
+|  for each peer the link thread keeps the set of its members of every room,
+|  keyed by room and user so a join or leave heard twice, once as it
+|  happened and again in the full list sent when a link comes up, counts
+|  once, and how many members each room has there, which decides whether a
+|  line is forwarded to it
+|
+|  the event loops queue ready made frames, a line is framed for the links
+|  once however many peers it goes to, and the link thread queues it on
+|  each peer's outbound queue and writes every peer out once per pass
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "queue.h"
+#include "lqueue.h"
+#include "hash.h"
+#include "outbuf.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "protocol.h"
+#include "federation.h"
+
+/* most peers a node links to, dialled and accepted together */
+#define FEDMAXPEERS 64
+#define FEDEVENTS 64
+/* bytes pulled off a link per recv() call */
+#define FEDREADSIZE 65536
+/* how long a dialled peer is left before it is dialled again */
+#define FEDREDIALMS 1000
+/* bytes a peer may fall behind by before its link is dropped, it catches
+up on the membership it missed when the link comes back */
+#define FEDMAXPENDING (16 * 1024 * 1024)
+/* slots in each peer's room and member sets */
+#define FEDROOMSLOTS 1024
+#define FEDMEMBERSLOTS 4096
+/* longest room name, NUL, user name and NUL a link carries */
+#define FEDKEYLENGTH 256
+#define ADDRLENGTH 64
+/* longest secret a hello carries */
+#define FEDSECRETLENGTH 256
+/* slots in the set of this node's own members */
+#define FEDLOCALSLOTS 4096
+
+/* a room a peer has members in */
+typedef struct fed_room_t{
+  char name[FEDKEYLENGTH];
+  int count;
+} fed_room_t;
+
+/* a user of a peer in a room, the key is the room name, NUL, the user name
+and NUL */
+typedef struct fed_member_t{
+  char key[FEDKEYLENGTH];
+} fed_member_t;
+
+/* a user of this node in a room, kept with the join that announced it so a
+link coming up can be sent it again */
+typedef struct fed_local_t{
+  char key[FEDKEYLENGTH];
+  msgbuf_t *join;
+  struct fed_local_t *prev;
+  struct fed_local_t *next;
+} fed_local_t;
+
+/* one link, a dialled peer keeps its slot while the link is down */
+typedef struct peer_t{
+  int fd;
+  /* the peer's node id, 0 until its hello arrives */
+  int node;
+  int outbound;
+  int connecting;
+  char host[ADDRLENGTH];
+  /* where an accepted link came from */
+  in_addr_t addr;
+  int port;
+  unsigned long redial_ms;
+  proto_decoder_t decoder;
+  outbuf_t out;
+  /* set while frames queued this pass wait to be written */
+  int dirty;
+  /* set once the link failed, it is closed at the end of the pass */
+  int failed;
+  hashtable_t *rooms;
+  hashtable_t *members;
+} peer_t;
+
+struct fed_t{
+  int node;
+  int listenfd;
+  int epollfd;
+  /* eventfd written to wake the link thread, only while wake_pending was
+  clear */
+  int wakefd;
+  int wake_pending;
+  lqueue_t *queue;
+  peer_t *peers[FEDMAXPEERS];
+  int npeers;
+  /* every hello has to carry the secret if there is one, if not an accepted
+  link has to come from a trusted address */
+  char secret[FEDSECRETLENGTH];
+  in_addr_t trusted[FEDMAXPEERS];
+  int ntrusted;
+  /* this node's members as of the frames drained so far, a link that comes
+  up is sent them from the same thread and queue as the joins and leaves,
+  so it can not be told of a join after the leave that followed it */
+  hashtable_t *local;
+  fed_local_t *local_head;
+  void (*deliver)(const char *room, msgbuf_t *mb, void *arg);
+  void *arg;
+  pthread_t thread;
+};
+
+/* the monotonic clock in milliseconds */
+static unsigned long now_ms(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* comparators for a peer's sets, a member key holds two strings */
+static int find_room(void *elementp, const void *keyp){
+  return strcmp(((fed_room_t *)elementp)->name, (const char *)keyp) == 0;
+}
+
+static int same_key(const char *a, const char *b){
+  return strcmp(a, b) == 0 &&
+         strcmp(a + strlen(a) + 1, b + strlen(b) + 1) == 0;
+}
+
+static int find_member(void *elementp, const void *keyp){
+  return same_key(((fed_member_t *)elementp)->key, (const char *)keyp);
+}
+
+static int find_local(void *elementp, const void *keyp){
+  return same_key(((fed_local_t *)elementp)->key, (const char *)keyp);
+}
+
+/* forget everything a peer said about its members */
+static void clear_sets(peer_t *p){
+  if(p->rooms){
+    happly(p->rooms, free);
+    hclose(p->rooms);
+    p->rooms = NULL;
+  }
+  if(p->members){
+    happly(p->members, free);
+    hclose(p->members);
+    p->members = NULL;
+  }
+}
+
+/* put a frame on a peer's outbound queue, a peer too far behind is dropped */
+static void queue_peer(peer_t *p, msgbuf_t *mb){
+  if(p->failed){
+    return;
+  }
+  if(outbuf_queue(&p->out, mb) < 0){
+    printf("link to node %d fell too far behind\n", p->node);
+    p->failed = 1;
+    return;
+  }
+  p->dirty = 1;
+}
+
+/* queue our hello, carrying the secret */
+static int send_hello(fed_t *fed, peer_t *p){
+  msgbuf_t *hello;
+
+  hello = msgbuf_frame(OP_LINK_HELLO, fed->node, NULL, 0, fed->secret,
+                       strlen(fed->secret));
+  if(!hello){
+    return -1;
+  }
+  queue_peer(p, hello);
+  msgbuf_release(hello);
+  return 0;
+}
+
+/* take up a connected socket, a dialled peer is sent our hello first, an
+accepted one only once its own hello was taken, so the secret is never
+sent to whoever happens to connect */
+static int start_peer(fed_t *fed, peer_t *p, int fd){
+  struct epoll_event ev;
+  int one = 1;
+
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  p->fd = fd;
+  p->node = 0;
+  p->dirty = 0;
+  p->failed = 0;
+  proto_decoder_init(&p->decoder, PROTO_MAXPAYLOAD);
+  outbuf_init(&p->out, FEDMAXPENDING, 0);
+  p->rooms = hopen(FEDROOMSLOTS);
+  p->members = hopen(FEDMEMBERSLOTS);
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = p;
+  if(!p->rooms || !p->members ||
+     epoll_ctl(fed->epollfd, EPOLL_CTL_ADD, fd, &ev) < 0){
+    return -1;
+  }
+  return p->outbound ? send_hello(fed, p) : 0;
+}
+
+/* close a link, a dialled peer is dialled again later, an accepted one is
+forgotten */
+static void stop_peer(fed_t *fed, peer_t *p){
+  int i;
+
+  if(p->fd >= 0){
+    if(p->node){
+      printf("link to node %d is down\n", p->node);
+    }
+    epoll_ctl(fed->epollfd, EPOLL_CTL_DEL, p->fd, NULL);
+    close(p->fd);
+    proto_decoder_free(&p->decoder);
+    outbuf_free(&p->out);
+  }
+  clear_sets(p);
+  p->fd = -1;
+  p->node = 0;
+  p->connecting = 0;
+  p->dirty = 0;
+  p->failed = 0;
+  if(p->outbound){
+    p->redial_ms = now_ms() + FEDREDIALMS;
+    return;
+  }
+  for(i = 0; i < fed->npeers; i++){
+    if(fed->peers[i] == p){
+      fed->peers[i] = fed->peers[--fed->npeers];
+      break;
+    }
+  }
+  free(p);
+}
+
+/* start a non-blocking connect to a dialled peer */
+static void dial_peer(fed_t *fed, peer_t *p){
+  struct sockaddr_in addr;
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(p->host);
+  addr.sin_port = htons(p->port);
+  p->redial_ms = now_ms() + FEDREDIALMS;
+  if((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0){
+    return;
+  }
+  if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+     errno != EINPROGRESS){
+    close(fd);
+    return;
+  }
+  p->connecting = 1;
+  if(start_peer(fed, p, fd) < 0){
+    p->fd = fd;
+    stop_peer(fed, p);
+  }
+}
+
+/* a peer joined or left a room, counted once however often it is heard */
+static void update_member(peer_t *p, const char *key, size_t keylen,
+                          int joined){
+  fed_member_t *m;
+  fed_room_t *r;
+
+  m = (fed_member_t *)hsearch(p->members, find_member, key, keylen);
+  r = (fed_room_t *)hsearch(p->rooms, find_room, key, strlen(key));
+  if(joined && !m){
+    if(!(m = (fed_member_t *)malloc(sizeof(fed_member_t)))){
+      return;
+    }
+    memcpy(m->key, key, keylen);
+    if(hput(p->members, m, m->key, keylen) < 0){
+      free(m);
+      return;
+    }
+    if(!r && (r = (fed_room_t *)calloc(1, sizeof(fed_room_t)))){
+      strcpy(r->name, key);
+      if(hput(p->rooms, r, r->name, strlen(r->name)) < 0){
+        free(r);
+        r = NULL;
+      }
+    }
+    if(r){
+      r->count++;
+    }
+  }else if(!joined && m){
+    hremove(p->members, find_member, key, keylen);
+    free(m);
+    if(r && --r->count == 0){
+      hremove(p->rooms, find_room, r->name, strlen(r->name));
+      free(r);
+    }
+  }
+}
+
+/* whether a peer's hello may be taken, every byte of the secret is compared
+so the time taken does not tell how much of it matched */
+static int trusted_hello(fed_t *fed, peer_t *p, proto_frame_t *frame){
+  size_t len = strlen(fed->secret), i;
+  unsigned char diff = 0;
+  int j;
+
+  if(len > 0){
+    if(frame->length != len){
+      return 0;
+    }
+    for(i = 0; i < len; i++){
+      diff |= (unsigned char)(frame->payload[i] ^ fed->secret[i]);
+    }
+    return diff == 0;
+  }
+  if(p->outbound){
+    return 1;
+  }
+  for(j = 0; j < fed->ntrusted; j++){
+    if(fed->trusted[j] == p->addr){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* send a peer whose link just came up every member of this node */
+static void resync_peer(fed_t *fed, peer_t *p){
+  fed_local_t *l;
+
+  for(l = fed->local_head; l; l = l->next){
+    queue_peer(p, l->join);
+  }
+}
+
+/* the decoder callback of a link */
+static int link_frame(proto_frame_t *frame, void *arg){
+  fed_t *fed = ((void **)arg)[0];
+  peer_t *p = ((void **)arg)[1];
+  char *text;
+  size_t roomlen;
+  msgbuf_t *mb;
+  int i;
+
+  if(frame->opcode == OP_LINK_HELLO){
+    if(p->node || frame->flags == 0 || frame->flags == fed->node){
+      return -1;
+    }
+    if(!trusted_hello(fed, p, frame)){
+      stats_add(STAT_LINKS_REFUSED, 1);
+      return -1;
+    }
+    /* a second link to the same node would deliver everything twice */
+    for(i = 0; i < fed->npeers; i++){
+      if(fed->peers[i] != p && fed->peers[i]->node == frame->flags){
+        printf("already linked to node %d\n", frame->flags);
+        return -1;
+      }
+    }
+    if(!p->outbound && send_hello(fed, p) < 0){
+      return -1;
+    }
+    p->node = frame->flags;
+    printf("linked to node %d\n", p->node);
+    resync_peer(fed, p);
+    return 0;
+  }
+  if(!p->node){
+    return -1;
+  }
+  /* nothing is forwarded twice, but a frame from ourselves is dropped all
+  the same */
+  if(frame->flags == fed->node){
+    return 0;
+  }
+  if(!memchr(frame->payload, '\0', frame->length)){
+    return -1;
+  }
+  roomlen = strlen(frame->payload);
+  if(frame->opcode == OP_LINK_JOIN || frame->opcode == OP_LINK_LEAVE){
+    if(frame->length + 1 > FEDKEYLENGTH){
+      return -1;
+    }
+    /* the payload keeps the NUL the decoder ends it with */
+    update_member(p, frame->payload, frame->length + 1,
+                  frame->opcode == OP_LINK_JOIN);
+  }else if(frame->opcode == OP_LINK_CHAT){
+    text = frame->payload + roomlen + 1;
+    mb = msgbuf_frame(OP_TEXT, 0, NULL, 0, text,
+                      frame->length - roomlen - 1);
+    if(mb){
+      stats_add(STAT_LINK_IN, 1);
+      fed->deliver(frame->payload, mb, fed->arg);
+      msgbuf_release(mb);
+    }
+  }
+  return 0;
+}
+
+/* read everything a link has */
+static void read_peer(fed_t *fed, peer_t *p){
+  char buf[FEDREADSIZE];
+  void *args[2];
+  ssize_t n;
+
+  args[0] = fed;
+  args[1] = p;
+  while(!p->failed){
+    n = recv(p->fd, buf, sizeof(buf), 0);
+    if(n > 0){
+      if(proto_decode(&p->decoder, buf, n, link_frame, args) != 0){
+        p->failed = 1;
+      }
+    }else if(n < 0 && errno == EINTR){
+      continue;
+    }else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+      return;
+    }else{
+      p->failed = 1;
+    }
+  }
+}
+
+/* accept every pending link */
+static void accept_peers(fed_t *fed){
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  peer_t *p;
+  int fd;
+
+  while((fd = accept4(fed->listenfd, (struct sockaddr *)&addr, &addrlen,
+                      SOCK_NONBLOCK)) >= 0){
+    addrlen = sizeof(addr);
+    if(fed->npeers == FEDMAXPEERS ||
+       !(p = (peer_t *)calloc(1, sizeof(peer_t)))){
+      close(fd);
+      continue;
+    }
+    p->addr = addr.sin_addr.s_addr;
+    fed->peers[fed->npeers++] = p;
+    if(start_peer(fed, p, fd) < 0){
+      stop_peer(fed, p);
+    }
+  }
+}
+
+/* keep this node's members up to date with a join or leave being sent */
+static void track_local(fed_t *fed, msgbuf_t *mb){
+  char key[FEDKEYLENGTH];
+  size_t keylen = mb->len - PROTO_HDRLEN + 1;
+  fed_local_t *l;
+
+  /* fed_member() made sure the key fits, the user is not NUL ended */
+  memcpy(key, mb->data + PROTO_HDRLEN, keylen - 1);
+  key[keylen - 1] = '\0';
+  l = (fed_local_t *)hsearch(fed->local, find_local, key, keylen);
+  if((unsigned char)mb->data[1] == OP_LINK_JOIN && !l){
+    if(!(l = (fed_local_t *)malloc(sizeof(fed_local_t)))){
+      return;
+    }
+    memcpy(l->key, key, keylen);
+    if(hput(fed->local, l, l->key, keylen) < 0){
+      free(l);
+      return;
+    }
+    l->join = msgbuf_hold(mb);
+    l->prev = NULL;
+    l->next = fed->local_head;
+    if(l->next){
+      l->next->prev = l;
+    }
+    fed->local_head = l;
+  }else if((unsigned char)mb->data[1] == OP_LINK_LEAVE && l){
+    hremove(fed->local, find_local, key, keylen);
+    if(l->prev){
+      l->prev->next = l->next;
+    }else{
+      fed->local_head = l->next;
+    }
+    if(l->next){
+      l->next->prev = l->prev;
+    }
+    msgbuf_release(l->join);
+    free(l);
+  }
+}
+
+/* queue every frame the event loops handed over on the peers it is for,
+a line only on the peers with members in its room */
+static void drain_queue(fed_t *fed){
+  uint64_t count;
+  msgbuf_t *mb;
+  peer_t *p;
+  const char *room;
+  int i;
+
+  if(read(fed->wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN){
+    perror("could not read link wakeup");
+  }
+  /* cleared before draining, so frames queued from here on wake us again */
+  __atomic_store_n(&fed->wake_pending, 0, __ATOMIC_SEQ_CST);
+  while((mb = (msgbuf_t *)lqget(fed->queue)) != NULL){
+    room = mb->data + PROTO_HDRLEN;
+    if((unsigned char)mb->data[1] != OP_LINK_CHAT){
+      track_local(fed, mb);
+    }
+    for(i = 0; i < fed->npeers; i++){
+      p = fed->peers[i];
+      if(!p->node){
+        continue;
+      }
+      if((unsigned char)mb->data[1] != OP_LINK_CHAT){
+        queue_peer(p, mb);
+      }else if(hsearch(p->rooms, find_room, room, strlen(room))){
+        queue_peer(p, mb);
+        stats_add(STAT_LINK_OUT, 1);
+      }
+    }
+    msgbuf_release(mb);
+  }
+}
+
+/* the link thread, accepts, dials and services every link */
+static void *run_links(void *arg){
+  fed_t *fed = (fed_t *)arg;
+  struct epoll_event events[FEDEVENTS];
+  snap_reader_t *reader = snap_register();
+  unsigned long now, next;
+  socklen_t errlen;
+  peer_t *p;
+  /* the first pass dials the peers straight away */
+  int i, n, err, timeout = 0;
+
+  while(1){
+    snap_offline(reader);
+    n = epoll_wait(fed->epollfd, events, FEDEVENTS, timeout);
+    snap_online(reader);
+    for(i = 0; i < n; i++){
+      p = (peer_t *)events[i].data.ptr;
+      if(p == NULL){
+        accept_peers(fed);
+        continue;
+      }
+      if((void *)p == (void *)fed){
+        drain_queue(fed);
+        continue;
+      }
+      if(p->connecting && (events[i].events & (EPOLLOUT | EPOLLERR))){
+        errlen = sizeof(err);
+        if(getsockopt(p->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0 ||
+           err != 0){
+          p->failed = 1;
+          continue;
+        }
+        p->connecting = 0;
+        p->dirty = 1;
+      }
+      if(events[i].events & EPOLLOUT){
+        p->dirty = 1;
+      }
+      if(!p->connecting &&
+         (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))){
+        read_peer(fed, p);
+      }
+    }
+
+    /* every peer gets one write for everything queued this pass */
+    now = now_ms();
+    next = 0;
+    for(i = fed->npeers - 1; i >= 0; i--){
+      p = fed->peers[i];
+      if(p->fd >= 0 && !p->connecting && p->dirty && !p->failed){
+        p->dirty = 0;
+        if(outbuf_flush(&p->out, p->fd) < 0){
+          p->failed = 1;
+        }
+      }
+      if(p->fd >= 0 && p->failed){
+        stop_peer(fed, p);
+      }else if(p->fd < 0 && p->redial_ms <= now){
+        dial_peer(fed, p);
+      }
+      /* the list may have shrunk under i */
+      if(i < fed->npeers && fed->peers[i] == p && p->fd < 0 &&
+         (next == 0 || p->redial_ms < next)){
+        next = p->redial_ms;
+      }
+    }
+    timeout = next == 0 ? -1 : (next > now ? (int)(next - now) : 0);
+    snap_quiescent(reader);
+    snap_reclaim();
+  }
+  return NULL;
+}
+
+/* hand a frame to the link thread */
+static int post_frame(fed_t *fed, msgbuf_t *mb){
+  uint64_t one = 1;
+
+  if(!mb){
+    return -1;
+  }
+  if(lqput(fed->queue, mb) != 0){
+    msgbuf_release(mb);
+    return -1;
+  }
+  if(!__atomic_exchange_n(&fed->wake_pending, 1, __ATOMIC_SEQ_CST)){
+    if(write(fed->wakefd, &one, sizeof(one)) < 0){
+      perror("could not wake the link thread");
+    }
+  }
+  return 0;
+}
+
+/* undo a fed_open() that went wrong part way */
+static void free_fed(fed_t *fed){
+  if(fed->listenfd >= 0){
+    close(fed->listenfd);
+  }
+  if(fed->epollfd >= 0){
+    close(fed->epollfd);
+  }
+  if(fed->wakefd >= 0){
+    close(fed->wakefd);
+  }
+  if(fed->queue){
+    lqclose(fed->queue);
+  }
+  if(fed->local){
+    hclose(fed->local);
+  }
+  free(fed);
+}
+
+/* set up a node and its listening socket */
+fed_t *fed_open(int node, const char *host, int port, const char *secret,
+                void (*deliver)(const char *room, msgbuf_t *mb, void *arg),
+                void *arg){
+  struct sockaddr_in addr;
+  struct epoll_event ev;
+  fed_t *fed;
+  int one = 1;
+
+  if(node < 1 || node > 65535 || strlen(secret) >= FEDSECRETLENGTH ||
+     !(fed = (fed_t *)calloc(1, sizeof(fed_t)))){
+    return NULL;
+  }
+  fed->listenfd = -1;
+  fed->epollfd = -1;
+  fed->wakefd = -1;
+  fed->node = node;
+  fed->deliver = deliver;
+  fed->arg = arg;
+  strcpy(fed->secret, secret);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if(inet_pton(AF_INET, host, &addr.sin_addr) != 1){
+    free_fed(fed);
+    return NULL;
+  }
+  if(!(fed->queue = lqopen()) || !(fed->local = hopen(FEDLOCALSLOTS)) ||
+     (fed->listenfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0 ||
+     setsockopt(fed->listenfd, SOL_SOCKET, SO_REUSEADDR, &one,
+                sizeof(one)) < 0 ||
+     bind(fed->listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(fed->listenfd, FEDMAXPEERS) < 0 ||
+     (fed->epollfd = epoll_create1(0)) < 0 ||
+     (fed->wakefd = eventfd(0, EFD_NONBLOCK)) < 0){
+    perror("could not open the link port");
+    free_fed(fed);
+    return NULL;
+  }
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = NULL;
+  epoll_ctl(fed->epollfd, EPOLL_CTL_ADD, fed->listenfd, &ev);
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = fed;
+  epoll_ctl(fed->epollfd, EPOLL_CTL_ADD, fed->wakefd, &ev);
+  return fed;
+}
+
+/* trust links accepted from an address */
+int fed_trust(fed_t *fed, const char *host){
+  struct in_addr in;
+
+  if(fed->ntrusted == FEDMAXPEERS || inet_pton(AF_INET, host, &in) != 1){
+    return -1;
+  }
+  fed->trusted[fed->ntrusted++] = in.s_addr;
+  return 0;
+}
+
+/* add a peer to dial */
+int fed_peer(fed_t *fed, const char *addr){
+  const char *colon = strrchr(addr, ':');
+  peer_t *p;
+
+  if(!colon || colon == addr || colon - addr >= ADDRLENGTH ||
+     atoi(colon + 1) <= 0 || fed->npeers == FEDMAXPEERS ||
+     !(p = (peer_t *)calloc(1, sizeof(peer_t)))){
+    return -1;
+  }
+  memcpy(p->host, addr, colon - addr);
+  p->port = atoi(colon + 1);
+  p->fd = -1;
+  p->outbound = 1;
+  fed->peers[fed->npeers++] = p;
+  return 0;
+}
+
+/* start the link thread, it dials every peer straight away */
+int fed_start(fed_t *fed){
+  if(pthread_create(&fed->thread, NULL, run_links, fed) != 0){
+    perror("could not start the link thread");
+    return -1;
+  }
+  pthread_detach(fed->thread);
+  return 0;
+}
+
+/* frame a local line for the links, once however many peers it goes to */
+int fed_forward(fed_t *fed, const char *room, msgbuf_t *mb){
+  return post_frame(fed, msgbuf_frame(OP_LINK_CHAT, fed->node, room,
+                                      strlen(room) + 1,
+                                      mb->data + PROTO_HDRLEN,
+                                      mb->len - PROTO_HDRLEN));
+}
+
+/* frame a local join or leave for the links */
+int fed_member(fed_t *fed, const char *room, const char *user, int joined){
+  if(strlen(room) + strlen(user) + 2 > FEDKEYLENGTH){
+    return -1;
+  }
+  return post_frame(fed, msgbuf_frame(joined ? OP_LINK_JOIN : OP_LINK_LEAVE,
+                                      fed->node, room, strlen(room) + 1,
+                                      user, strlen(user)));
+}
@@ -0,0 +1,137 @@
+/*=============================================================================
+|   Title: federation.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements links between chat servers, so several server
+|  processes, each a node with its own id, serve one set of rooms
+|
+|  every node tells its peers which of its users are in which rooms, as a
+|  join or leave happens and in full when a link comes up, both sent from
+|  the link thread in the order the event loops queued them, so each node
+|  knows which peers have members in a room, a line said in a room is then
+|  sent once to each such peer rather than once to each remote user, and
+|  the peer fans it out to its own members
+|
+|  the nodes are linked in a full mesh, each pair once, in either direction,
+|  a node only forwards lines its own users said, never lines a peer sent
+|  it, and drops anything that started from itself, so a line can not loop
+|
+|  the links are run by a thread of the module's own, which the event loops
+|  hand frames to through a queue, every frame queued for a peer in one pass
+|  of its loop goes out in one write
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* federation.h -- public interface to the federation module
+*/
+
+#include "msgbuf.h"
+
+/* the federation representation is hidden from users of the module */
+typedef struct fed_t fed_t;
+
+/*
+* Function:  fed_open()
+* --------------------
+* sets up a node listening for links from its peers, nothing is linked
+* until fed_start()
+*
+* a hello is only taken with the secret in it if there is one, and if not
+* only on a link the node dialled or accepted from a trusted address
+*
+* paramaters:
+*  int node: the node's id, unique among the nodes, 1 to 65535
+*  const char *host: the IP address the link port is bound to
+*  int port: the port peers link to
+*  const char *secret: the secret every node's hello carries, "" for none
+*  void (*deliver)(const char *room, msgbuf_t *mb, void *arg): called on
+*        the link thread for every line a peer sends, with the frame to send
+*        to the room's members, the link thread is a snapshot reader
+*  void *arg: passed through to deliver
+*
+*  returns: fed_t*, the node, NULL if not successful
+*/
+fed_t *fed_open(int node, const char *host, int port, const char *secret,
+                void (*deliver)(const char *room, msgbuf_t *mb, void *arg),
+                void *arg);
+
+/*
+* Function:  fed_trust()
+* --------------------
+* takes hellos on links accepted from an address, only called before
+* fed_start()
+*
+* paramaters:
+*  fed_t *fed: the node
+*  const char *host: the peer's IP address
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int fed_trust(fed_t *fed, const char *host);
+
+/*
+* Function:  fed_peer()
+* --------------------
+* adds a peer for the node to link to, redialled whenever the link is down,
+* only called before fed_start()
+*
+* paramaters:
+*  fed_t *fed: the node
+*  const char *addr: the peer's address and link port, as IP:PORT
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int fed_peer(fed_t *fed, const char *addr);
+
+/*
+* Function:  fed_start()
+* --------------------
+* starts the link thread
+*
+* paramaters:
+*  fed_t *fed: the node
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int fed_start(fed_t *fed);
+
+/*
+* Function:  fed_forward()
+* --------------------
+* sends a line a local user said in a room to every peer with members in
+* the room
+*
+* paramaters:
+*  fed_t *fed: the node
+*  const char *room: the room's name
+*  msgbuf_t *mb: the line as framed for the room's members, the caller
+*        keeps its reference
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int fed_forward(fed_t *fed, const char *room, msgbuf_t *mb);
+
+/*
+* Function:  fed_member()
+* --------------------
+* tells every peer a local user joined or left a room
+*
+* paramaters:
+*  fed_t *fed: the node
+*  const char *room: the room's name
+*  const char *user: the user's name
+*  int joined: TRUE if the user joined, FALSE if they left
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int fed_member(fed_t *fed, const char *room, const char *user, int joined);
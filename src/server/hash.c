@@ -0,0 +1,253 @@
+/*=============================================================================
+|   Title: hash.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a generic hash table of chained slots,
+|  each slot holds the first entry of its chain and later entries come from
+|  a pool, each entry keeps its key's full hash so a lookup walks the chain
+|  without touching the elements of other keys
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+/* one element in a slot's chain, with its key's full hash so a lookup only
+calls the search function, and so only touches the element, on a match */
+typedef struct hentry_t{
+  struct hentry_t *next;
+  uint32_t hash;
+  void *ep;
+} hentry_t;
+
+/* the first entry of every chain lives in the slot itself, so a lookup in a
+table that is not overfull reads one slot and the element it finds, later
+entries come from a pool shared by every table */
+typedef struct {
+  uint32_t hsize;
+  hentry_t *table;
+} hashtable_t;
+
+static pool_t *entry_pool;
+static pthread_once_t entry_pool_once = PTHREAD_ONCE_INIT;
+
+static void open_entry_pool(void){
+  entry_pool = pool_open("hashentry", sizeof(hentry_t));
+}
+
+/* 32 bit FNV-1a over the key bytes */
+static uint32_t fnv1a(const char *key, int keylen){
+  uint32_t h = 2166136261u;
+  int i;
+
+  for(i = 0; i < keylen; i++){
+    h ^= (unsigned char)key[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* create an empty hash table */
+hashtable_t *hopen(uint32_t hsize){
+  hashtable_t *htp;
+
+  if(hsize == 0){
+    return NULL;
+  }
+  pthread_once(&entry_pool_once, open_entry_pool);
+  if(!entry_pool){
+    return NULL;
+  }
+  htp = (hashtable_t *)malloc(sizeof(hashtable_t));
+  if(!htp){
+    return NULL;
+  }
+  htp->hsize = hsize;
+  /* an empty slot has no element */
+  htp->table = (hentry_t *)calloc(hsize, sizeof(hentry_t));
+  if(!htp->table){
+    free(htp);
+    return NULL;
+  }
+  return htp;
+}
+
+
+/* give a table's chain entries back to the pool, the slots stay */
+static void free_chains(hentry_t *table, uint32_t hsize){
+  hentry_t *e, *next;
+  uint32_t i;
+
+  for(i = 0; i < hsize; i++){
+    for(e = table[i].next; e; e = next){
+      next = e->next;
+      pool_put(entry_pool, e);
+    }
+  }
+}
+
+/* deallocate a hash table and its entries */
+void hclose(hashtable_t *htp){
+  free_chains(htp->table, htp->hsize);
+  free(htp->table);
+  free(htp);
+}
+
+/* the full hash of a key */
+uint32_t hhash(const char *key, int keylen){
+  return fnv1a(key, keylen);
+}
+
+/* move every element into a new array of slots, the old slots are only let
+go once every element has a place in the new ones */
+int hresize(hashtable_t *htp, uint32_t hsize){
+  hentry_t *table, *e, *slot, *added;
+  uint32_t i;
+
+  if(hsize == 0 ||
+     !(table = (hentry_t *)calloc(hsize, sizeof(hentry_t)))){
+    return -1;
+  }
+  for(i = 0; i < htp->hsize; i++){
+    for(e = htp->table[i].ep ? &htp->table[i] : NULL; e; e = e->next){
+      slot = &table[e->hash % hsize];
+      if(!slot->ep){
+        slot->hash = e->hash;
+        slot->ep = e->ep;
+        continue;
+      }
+      if(!(added = (hentry_t *)pool_get(entry_pool))){
+        free_chains(table, hsize);
+        free(table);
+        return -1;
+      }
+      added->hash = e->hash;
+      added->ep = e->ep;
+      added->next = slot->next;
+      slot->next = added;
+    }
+  }
+  free_chains(htp->table, htp->hsize);
+  free(htp->table);
+  htp->table = table;
+  htp->hsize = hsize;
+  return 0;
+}
+
+/* the slot a key hashes to */
+uint32_t hslot(hashtable_t *htp, const char *key, int keylen){
+  return fnv1a(key, keylen) % htp->hsize;
+}
+
+/* put an element at the end of the chain of the slot its key hashes to */
+int hput(hashtable_t *htp, void *ep, const char *key, int keylen){
+  hentry_t *slot, *e;
+  uint32_t hash;
+
+  if(!htp || !ep || !key){
+    return -1;
+  }
+  hash = fnv1a(key, keylen);
+  slot = &htp->table[hash % htp->hsize];
+  if(!slot->ep){
+    slot->hash = hash;
+    slot->ep = ep;
+    return 0;
+  }
+  if(!(e = (hentry_t *)pool_get(entry_pool))){
+    return -1;
+  }
+  e->next = NULL;
+  e->hash = hash;
+  e->ep = ep;
+  while(slot->next){
+    slot = slot->next;
+  }
+  slot->next = e;
+  return 0;
+}
+
+/* apply a function to every element in the table */
+void happly(hashtable_t *htp, void (*fn)(void* ep)){
+  hentry_t *e, *next;
+  uint32_t i;
+
+  for(i = 0; i < htp->hsize; i++){
+    if(!htp->table[i].ep){
+      continue;
+    }
+    for(e = &htp->table[i]; e; e = next){
+      /* fn may free the element, the entry stays */
+      next = e->next;
+      fn(e->ep);
+    }
+  }
+}
+
+/* the entry holding the first element matching a key, NULL if none does,
+prev is set to the entry before it, NULL for the slot itself */
+static hentry_t *find(hashtable_t *htp,
+                      int (*searchfn)(void* elementp, const void* searchkeyp),
+                      const char *key, int keylen, hentry_t **prev){
+  uint32_t hash = fnv1a(key, keylen);
+  hentry_t *e = &htp->table[hash % htp->hsize];
+
+  if(!e->ep){
+    return NULL;
+  }
+  for(*prev = NULL; e; *prev = e, e = e->next){
+    if(e->hash == hash && searchfn(e->ep, key)){
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* find an element stored under a key */
+void *hsearch(hashtable_t *htp,
+              int (*searchfn)(void* elementp, const void* searchkeyp),
+              const char *key,
+              int keylen){
+  hentry_t *e, *prev;
+
+  if(!htp || !key || !(e = find(htp, searchfn, key, keylen, &prev))){
+    return NULL;
+  }
+  return e->ep;
+}
+
+/* find, remove and return an element stored under a key */
+void *hremove(hashtable_t *htp,
+              int (*searchfn)(void* elementp, const void* searchkeyp),
+              const char *key,
+              int keylen){
+  hentry_t *e, *prev, *next;
+  void *ep;
+
+  if(!htp || !key || !(e = find(htp, searchfn, key, keylen, &prev))){
+    return NULL;
+  }
+  ep = e->ep;
+  if(prev){
+    prev->next = e->next;
+    pool_put(entry_pool, e);
+  }else if((next = e->next) != NULL){
+    /* the slot takes over the second entry */
+    *e = *next;
+    pool_put(entry_pool, next);
+  }else{
+    e->ep = NULL;
+  }
+  return ep;
+}
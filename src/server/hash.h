@@ -0,0 +1,164 @@
+/*=============================================================================
+|   Title: hash.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a generic hash table, each slot holds a chain of
+|  the elements whose keys hash to that slot, the number of slots is chosen
+|  when the table is opened and can be changed with hresize()
+|
+|  keys are arbitrary byte strings, so a table can be keyed by a user name
+|  or by the bytes of a socket number or connection id
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* hash.h -- public interface to the hash table module
+*/
+
+#include <stdint.h>
+
+/* the hash table representation is hidden from users of the module */
+typedef void hashtable_t;
+
+/*
+* Function:  hopen()
+* --------------------
+* create an empty hash table
+*
+* paramaters:
+*  uint32_t hsize: the number of slots in the table
+*
+*  returns: hashtable_t*, an open hash table, NULL if out of memory
+*/
+hashtable_t *hopen(uint32_t hsize);
+
+/*
+* Function:  hclose()
+* --------------------
+* deallocate a hash table, frees everything in it except the elements
+*
+* paramaters:
+*  hashtable_t *htp: table to close
+*
+*  returns: NULL
+*/
+void hclose(hashtable_t *htp);
+
+/*
+* Function:  hhash()
+* --------------------
+* the full hash of a key, the slot it lands in is this modulo the table size
+*
+* paramaters:
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: uint32_t, the hash
+*/
+uint32_t hhash(const char *key, int keylen);
+
+/*
+* Function:  hresize()
+* --------------------
+* moves every element into a new set of hsize slots, the hashes kept with
+* the elements are reused so no key is hashed again
+*
+* paramaters:
+*  hashtable_t *htp: the table
+*  uint32_t hsize: the new number of slots
+*
+*  returns: 0 if successful, -1 if out of memory, the table is unchanged
+*/
+int hresize(hashtable_t *htp, uint32_t hsize);
+
+/*
+* Function:  hslot()
+* --------------------
+* the slot a key hashes to
+*
+* paramaters:
+*  hashtable_t *htp: the table
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: uint32_t, a slot number smaller than the table size
+*/
+uint32_t hslot(hashtable_t *htp, const char *key, int keylen);
+
+/*
+* Function:  hput()
+* --------------------
+* put an element into the table under the given key
+*
+* paramaters:
+*  hashtable_t *htp: table to insert into
+*  void *ep: element to insert
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int hput(hashtable_t *htp, void *ep, const char *key, int keylen);
+
+/*
+* Function:  happly()
+* --------------------
+*  apply a void function to every element of the table
+*
+* paramaters:
+*  hashtable_t *htp: table of items to apply the function on
+*  void (*fn)(void* ep): a function to apply to each element
+*
+*  returns: NULL
+*/
+void happly(hashtable_t *htp, void (*fn)(void* ep));
+
+/*
+* Function:  hsearch()
+* --------------------
+*  find an element stored under a key, the supplied boolean function tells
+*  apart elements whose keys share a slot
+*
+* paramaters:
+*  hashtable_t *htp: table to search
+*  int (*searchfn)(void* elementp, const void* searchkeyp): returns 1 if
+*        the element matches the search key, 0 if not, the key bytes are
+*        passed in as searchkeyp
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: the void* element if found, NULL if not found
+*/
+void *hsearch(hashtable_t *htp,
+              int (*searchfn)(void* elementp, const void* searchkeyp),
+              const char *key,
+              int keylen);
+
+/*
+* Function:  hremove()
+* --------------------
+*  find an element stored under a key, remove it and return it
+*
+* paramaters:
+*  hashtable_t *htp: table to search
+*  int (*searchfn)(void* elementp, const void* searchkeyp): returns 1 if
+*        the element matches the search key, 0 if not, the key bytes are
+*        passed in as searchkeyp
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: the void* element if found and removed, NULL if not found
+*/
+void *hremove(hashtable_t *htp,
+              int (*searchfn)(void* elementp, const void* searchkeyp),
+              const char *key,
+              int keylen);
@@ -0,0 +1,195 @@
+/*=============================================================================
+ |   Title:  hbench.c
+ |
+ |       Author:  Grace Miller
+ |     Language:  C
+ |   To Compile:  Run the Makefile in the server folder (make hbench)
+ |
+ |        Class:  CS 63 Programming Parallel Systems
+ |     Due Date:  10/17/2026
+ |
+ +-----------------------------------------------------------------------------
+ |
+ |  Description:  measures what the server's user registry costs as the number
+ |              of users grows, comparing the hashed index in lhash.c with the
+ |              linear lqsearch() walk it replaced
+ |
+ |        Input:  ./hbench [LOOKUPS]
+ |              LOOKUPS- lookups timed at each size, defaults to 200000
+ |
+ |       Output:  one line per registry size with the nanoseconds per
+ |              lookup by name, lookup by socket, and join + leave pair,
+ |              and per touch of a looked up user's name under a lock
+ |              without any index, the cost of the cache misses every
+ |              lookup at that size pays before the index adds its own
+ |
+ |              the users looked up are picked and copied out before the
+ |              clock starts, as the server's keys are already in the
+ |              message it is handling, so only the registry is timed
+ |
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "queue.h"
+#include "lqueue.h"
+#include "lhash.h"
+
+#define NAMELENGTH 100
+/* same number of slots the server's name index starts with */
+#define USERSLOTS 1024
+/* the linear walk is only timed up to this many users, it gets slow */
+#define MAXLINEAR 10000
+
+typedef struct BenchUser{
+  char name[NAMELENGTH];
+  int usocket;
+} BenchUser;
+
+/* comparator for lookups by name, the key is the name */
+int find_name(void* elementp, const void* keyp){
+  return strcmp(((BenchUser *)elementp)->name, (const char *)keyp) == 0;
+}
+
+/* comparator for lookups by socket, the key is the socket number */
+int find_socket(void* elementp, const void* keyp){
+  return ((BenchUser *)elementp)->usocket == *(const int *)keyp;
+}
+
+/* comparator for lqsearch(), the key is another BenchUser */
+int find_user(void* elementp, const void* keyp){
+  return strcmp(((BenchUser *)elementp)->name, ((const BenchUser *)keyp)->name) == 0;
+}
+
+/* nanoseconds on the monotonic clock */
+double now_ns(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char* argv[]){
+  int sizes[] = {10, 100, 1000, 10000, 100000};
+  int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+  long lookups = 200000;
+  int s, i, n, found;
+  long j, linear_lookups;
+  BenchUser *bench_users, *keys, *u, extra;
+  lhashtable_t *by_name, *by_socket;
+  lqueue_t *list;
+  double start, t_name, t_sock, t_touch, t_churn, t_linear;
+  pthread_mutex_t touch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+  if(argc > 1){
+    lookups = atol(argv[1]);
+  }
+  bench_users = (BenchUser *)malloc(sizeof(BenchUser) * sizes[nsizes - 1]);
+  keys = lookups > 0 ? (BenchUser *)malloc(sizeof(BenchUser) * lookups) : NULL;
+  if(!bench_users || !keys){
+    printf("could not set up the benchmark\n");
+    return(1);
+  }
+  srand(63);
+
+  printf("%-8s %14s %14s %14s %14s %14s\n", "users", "name_ns", "socket_ns",
+         "touch_ns", "join_leave_ns", "linear_ns");
+  for(s = 0; s < nsizes; s++){
+    n = sizes[s];
+    by_name = lhopen(USERSLOTS);
+    by_socket = lhopen(USERSLOTS);
+    list = lqopen();
+    for(i = 0; i < n; i++){
+      u = &bench_users[i];
+      sprintf(u->name, "user%d", i);
+      u->usocket = i + 5;
+      lhput(by_name, u, u->name, strlen(u->name));
+      lhput(by_socket, u, (const char *)&u->usocket, sizeof(int));
+      if(n <= MAXLINEAR){
+        lqput(list, u);
+      }
+    }
+
+    for(j = 0; j < lookups; j++){
+      keys[j] = bench_users[rand() % n];
+    }
+
+    found = 0;
+    start = now_ns();
+    for(j = 0; j < lookups; j++){
+      u = &keys[j];
+      found += lhsearch(by_name, find_name, u->name, strlen(u->name)) != NULL;
+    }
+    t_name = (now_ns() - start) / lookups;
+
+    start = now_ns();
+    for(j = 0; j < lookups; j++){
+      u = &keys[j];
+      found += lhsearch(by_socket, find_socket, (const char *)&u->usocket,
+                        sizeof(int)) != NULL;
+    }
+    t_sock = (now_ns() - start) / lookups;
+
+    /* the user is found from its socket number, which is its index + 5 */
+    start = now_ns();
+    for(j = 0; j < lookups; j++){
+      u = &keys[j];
+      pthread_mutex_lock(&touch_lock);
+      found += find_name(&bench_users[u->usocket - 5], u->name);
+      pthread_mutex_unlock(&touch_lock);
+    }
+    t_touch = (now_ns() - start) / lookups;
+
+    /* a user joining and leaving, the registry size stays at n */
+    strcpy(extra.name, "newcomer");
+    extra.usocket = -1;
+    start = now_ns();
+    for(j = 0; j < lookups; j++){
+      lhinsert(by_name, &extra, find_name, extra.name, strlen(extra.name));
+      lhremove(by_name, find_name, extra.name, strlen(extra.name));
+    }
+    t_churn = (now_ns() - start) / lookups;
+
+    t_linear = -1;
+    if(n <= MAXLINEAR){
+      /* keep the total work of the linear walk roughly constant */
+      linear_lookups = lookups / (n / 10 > 0 ? n / 10 : 1);
+      if(linear_lookups < 100){
+        linear_lookups = 100;
+      }
+      start = now_ns();
+      for(j = 0; j < linear_lookups; j++){
+        u = &keys[j];
+        found += lqsearch(list, find_user, u) != NULL;
+      }
+      t_linear = (now_ns() - start) / linear_lookups;
+    }
+
+    if(t_linear < 0){
+      printf("%-8d %14.1f %14.1f %14.1f %14.1f %14s\n", n, t_name, t_sock,
+             t_touch, t_churn, "-");
+    }else{
+      printf("%-8d %14.1f %14.1f %14.1f %14.1f %14.1f\n", n, t_name, t_sock,
+             t_touch, t_churn, t_linear);
+    }
+    if(found == 0){
+      printf("no users were found\n");
+    }
+
+    lhclose(by_name);
+    lhclose(by_socket);
+    while(lqget(list)){
+    }
+    lqclose(list);
+  }
+
+  free(bench_users);
+  free(keys);
+  return(0);
+}
@@ -0,0 +1,154 @@
+/*=============================================================================
+|   Title: history.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a ring of recent messages, see history.h
+|
+|  messages and bytes are numbered from the start of the ring's life, so
+|  message k lives in entry k % maxcount and byte p in data[p % maxbytes],
+|  before the writer touches an entry or a byte it claims them by raising
+|  claimed_count and claimed_bytes, a reader copies a message and only then
+|  looks at the claims, if they reach past the copied message the writer
+|  may have been overwriting it and the copy is thrown away, as with a
+|  seqlock
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+
+typedef struct entry_t{
+  unsigned long seq;
+  /* number of the message's first byte */
+  unsigned long pos;
+  size_t len;
+} entry_t;
+
+struct history_t{
+  entry_t *entries;
+  size_t maxcount;
+  char *data;
+  size_t maxbytes;
+  /* messages and bytes recorded so far, readers see up to these */
+  unsigned long count;
+  unsigned long bytes;
+  /* messages and bytes the writer may be writing, raised before it does */
+  unsigned long claimed_count;
+  unsigned long claimed_bytes;
+};
+
+/* create an empty ring */
+history_t *history_open(size_t maxcount, size_t maxbytes){
+  history_t *h = (history_t *)calloc(1, sizeof(history_t));
+
+  if(!h){
+    return NULL;
+  }
+  h->entries = (entry_t *)calloc(maxcount, sizeof(entry_t));
+  h->data = (char *)malloc(maxbytes);
+  if(!h->entries || !h->data || maxcount == 0 || maxbytes == 0){
+    history_close(h);
+    return NULL;
+  }
+  h->maxcount = maxcount;
+  h->maxbytes = maxbytes;
+  return h;
+}
+
+/* free a ring nobody is reading */
+void history_close(history_t *h){
+  free(h->entries);
+  free(h->data);
+  free(h);
+}
+
+/* copy a message into the ring, only ever called by one thread */
+void history_record(history_t *h, unsigned long seq, const char *data,
+                    size_t len){
+  unsigned long k = h->count, pos = h->bytes;
+  size_t off = pos % h->maxbytes, first;
+  entry_t *e = &h->entries[k % h->maxcount];
+
+  if(len == 0 || len > h->maxbytes){
+    return;
+  }
+  __atomic_store_n(&h->claimed_count, k + 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&h->claimed_bytes, pos + len, __ATOMIC_RELAXED);
+  /* the claims must be visible before any of the writes they cover */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  first = len < h->maxbytes - off ? len : h->maxbytes - off;
+  memcpy(h->data + off, data, first);
+  memcpy(h->data, data + first, len - first);
+  __atomic_store_n(&e->seq, seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->pos, pos, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->len, len, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&h->bytes, pos + len, __ATOMIC_RELAXED);
+  __atomic_store_n(&h->count, k + 1, __ATOMIC_RELEASE);
+}
+
+/* copy out the n newest messages, oldest first */
+size_t history_read(history_t *h, size_t n, history_item_t *items, char *buf,
+                    size_t size){
+  unsigned long end = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+  unsigned long k, pos, top = 0, claimed_count, claimed_bytes;
+  size_t used = 0, got = 0, valid, len, off, first, i;
+  history_item_t tmp;
+  entry_t *e;
+
+  /* newest first, so running out of room leaves out the oldest */
+  for(k = end; k > 0 && got < n && end - k < h->maxcount; k--){
+    e = &h->entries[(k - 1) % h->maxcount];
+    len = __atomic_load_n(&e->len, __ATOMIC_RELAXED);
+    pos = __atomic_load_n(&e->pos, __ATOMIC_RELAXED);
+    /* a torn entry is thrown away below, it only has to be safe to copy */
+    if(len > h->maxbytes || len > size - used){
+      break;
+    }
+    if(got == 0){
+      top = pos + len;
+    }
+    off = pos % h->maxbytes;
+    first = len < h->maxbytes - off ? len : h->maxbytes - off;
+    memcpy(buf + used, h->data + off, first);
+    memcpy(buf + used + first, h->data, len - first);
+    items[got].seq = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+    items[got].data = buf + used;
+    items[got].len = len;
+    used += len;
+    got++;
+  }
+
+  /* the claims are read after the copies, so anything the writer could
+  have been overwriting during them shows up in the claims */
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  claimed_count = __atomic_load_n(&h->claimed_count, __ATOMIC_RELAXED);
+  claimed_bytes = __atomic_load_n(&h->claimed_bytes, __ATOMIC_RELAXED);
+  /* messages are laid end to end, so each one starts where the next newer
+  one's bytes begin, once one is overwritten every older one is too */
+  for(valid = 0; valid < got; valid++){
+    top -= items[valid].len;
+    if(claimed_count - (end - 1 - valid) > h->maxcount ||
+       claimed_bytes - top > h->maxbytes){
+      break;
+    }
+  }
+
+  for(i = 0; i < valid / 2; i++){
+    tmp = items[i];
+    items[i] = items[valid - 1 - i];
+    items[valid - 1 - i] = tmp;
+  }
+  return valid;
+}
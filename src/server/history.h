@@ -0,0 +1,102 @@
+/*=============================================================================
+|   Title: history.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a fixed size ring of recent messages, bounded by
+|  both a number of messages and a number of bytes, the oldest messages are
+|  overwritten to make room for new ones
+|
+|  one thread records into a ring and any number of threads read it at the
+|  same time without a lock, the writer never waits for a reader, a reader
+|  copies messages out and then checks that the writer did not overwrite
+|  them while it was copying, throwing away any that were
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* history.h -- public interface to the message history module
+*/
+
+#include <stddef.h>
+
+/* one message copied out of a ring */
+typedef struct history_item_t{
+  /* the sequence number it was recorded with */
+  unsigned long seq;
+  /* where the copy is and how long it is */
+  char *data;
+  size_t len;
+} history_item_t;
+
+/* the ring representation is hidden from users of the module */
+typedef struct history_t history_t;
+
+/*
+* Function:  history_open()
+* --------------------
+* creates an empty ring
+*
+* paramaters:
+*  size_t maxcount: the most messages the ring remembers
+*  size_t maxbytes: the most bytes of messages the ring remembers
+*
+*  returns: history_t*, the ring, NULL if out of memory
+*/
+history_t *history_open(size_t maxcount, size_t maxbytes);
+
+/*
+* Function:  history_close()
+* --------------------
+* frees a ring, no thread may still be reading it
+*
+* paramaters:
+*  history_t *h: the ring
+*
+*  returns: NULL
+*/
+void history_close(history_t *h);
+
+/*
+* Function:  history_record()
+* --------------------
+* copies a message into the ring, overwriting the oldest ones if it is full,
+* only one thread may record into a ring
+*
+* paramaters:
+*  history_t *h: the ring
+*  unsigned long seq: a number to order messages by, handed back by
+*        history_read()
+*  const char *data: the message
+*  size_t len: its length, a message longer than the ring is not recorded
+*
+*  returns: NULL
+*/
+void history_record(history_t *h, unsigned long seq, const char *data,
+                    size_t len);
+
+/*
+* Function:  history_read()
+* --------------------
+* copies out up to the n newest messages, safe to call while the writer
+* records, a message overwritten during the copy is left out
+*
+* paramaters:
+*  history_t *h: the ring
+*  size_t n: the most messages to copy
+*  history_item_t *items: where to describe them, room for n, oldest first
+*  char *buf: where to copy them, messages that do not fit are left out
+*  size_t size: the size of buf, the ring's maxbytes always fits
+*
+*  returns: size_t, the number of messages copied
+*/
+size_t history_read(history_t *h, size_t n, history_item_t *items, char *buf,
+                    size_t size);
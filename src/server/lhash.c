@@ -0,0 +1,180 @@
+/*=============================================================================
+|   Title: lhash.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a generic locked hash table on top of hash.c, a
+|  slot is guarded by stripe (slot % LHSTRIPES), the table always has a
+|  multiple of LHSTRIPES slots so that is also (hash % LHSTRIPES) and a key
+|  keeps its stripe when the table grows
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "hash.h"
+
+/* number of mutexes shared out over the slots of a table, enough that
+reactors looking up different users seldom share one */
+#define LHSTRIPES 256
+
+/* the most slots a table grows to */
+#define LHMAXSLOTS (1u << 30)
+
+typedef struct lhashtable_t{
+  hashtable_t *h;
+  pthread_mutex_t stripes[LHSTRIPES];
+  /* slots in h, only changed with every stripe held, and elements in it */
+  uint32_t slots;
+  unsigned long count;
+} lhashtable_t;
+
+/* the mutex guarding the slot a key hashes to */
+static pthread_mutex_t *stripe_of(lhashtable_t *lhtp, const char *key, int keylen){
+  return &lhtp->stripes[hhash(key, keylen) % LHSTRIPES];
+}
+
+/* count an element put in, doubling the slots once there are more elements
+than slots, with every stripe held as lhapply() does */
+static void added(lhashtable_t *lhtp){
+  uint32_t slots;
+  int i;
+
+  if(__atomic_add_fetch(&lhtp->count, 1, __ATOMIC_RELAXED) <=
+     __atomic_load_n(&lhtp->slots, __ATOMIC_RELAXED)){
+    return;
+  }
+  for(i = 0; i < LHSTRIPES; i++){
+    pthread_mutex_lock(&lhtp->stripes[i]);
+  }
+  /* another thread may have grown it while the stripes were taken */
+  slots = lhtp->slots;
+  if(__atomic_load_n(&lhtp->count, __ATOMIC_RELAXED) > slots &&
+     slots < LHMAXSLOTS && hresize(lhtp->h, slots * 2) == 0){
+    __atomic_store_n(&lhtp->slots, slots * 2, __ATOMIC_RELAXED);
+  }
+  for(i = LHSTRIPES - 1; i >= 0; i--){
+    pthread_mutex_unlock(&lhtp->stripes[i]);
+  }
+}
+
+/* create an empty locked hash table */
+lhashtable_t *lhopen(uint32_t hsize){
+  lhashtable_t *lhtp = (lhashtable_t *)malloc(sizeof(lhashtable_t));
+  int i;
+
+  if(!lhtp){
+    return NULL;
+  }
+  hsize = hsize < LHSTRIPES ? LHSTRIPES :
+          (hsize + LHSTRIPES - 1) / LHSTRIPES * LHSTRIPES;
+  lhtp->slots = hsize;
+  lhtp->count = 0;
+  lhtp->h = hopen(hsize);
+  if(!lhtp->h){
+    free(lhtp);
+    return NULL;
+  }
+  for(i = 0; i < LHSTRIPES; i++){
+    pthread_mutex_init(&lhtp->stripes[i], NULL);
+  }
+  return lhtp;
+}
+
+/* deallocate a locked hash table */
+void lhclose(lhashtable_t *lhtp){
+  int i;
+
+  hclose(lhtp->h);
+  for(i = 0; i < LHSTRIPES; i++){
+    pthread_mutex_destroy(&lhtp->stripes[i]);
+  }
+  free(lhtp);
+}
+
+/* put an element into the table */
+int lhput(lhashtable_t *lhtp, void *ep, const char *key, int keylen){
+  pthread_mutex_t *m = stripe_of(lhtp, key, keylen);
+  int n;
+
+  pthread_mutex_lock(m);
+  n = hput(lhtp->h, ep, key, keylen);
+  pthread_mutex_unlock(m);
+  if(n == 0){
+    added(lhtp);
+  }
+  return n;
+}
+
+/* put an element into the table unless a matching one is already there */
+int lhinsert(lhashtable_t *lhtp, void *ep,
+             int (*searchfn)(void* elementp, const void* searchkeyp),
+             const char *key, int keylen){
+  pthread_mutex_t *m = stripe_of(lhtp, key, keylen);
+  int n;
+
+  pthread_mutex_lock(m);
+  if(hsearch(lhtp->h, searchfn, key, keylen)){
+    n = 1;
+  }else{
+    n = hput(lhtp->h, ep, key, keylen);
+  }
+  pthread_mutex_unlock(m);
+  if(n == 0){
+    added(lhtp);
+  }
+  return n;
+}
+
+/* apply a function to every element, every stripe is held for the walk */
+void lhapply(lhashtable_t *lhtp, void (*fn)(void* ep)){
+  int i;
+
+  for(i = 0; i < LHSTRIPES; i++){
+    pthread_mutex_lock(&lhtp->stripes[i]);
+  }
+  happly(lhtp->h, fn);
+  for(i = LHSTRIPES - 1; i >= 0; i--){
+    pthread_mutex_unlock(&lhtp->stripes[i]);
+  }
+}
+
+/* find an element stored under a key */
+void *lhsearch(lhashtable_t *lhtp,
+               int (*searchfn)(void* elementp, const void* searchkeyp),
+               const char *key,
+               int keylen){
+  pthread_mutex_t *m = stripe_of(lhtp, key, keylen);
+  void *ep;
+
+  pthread_mutex_lock(m);
+  ep = hsearch(lhtp->h, searchfn, key, keylen);
+  pthread_mutex_unlock(m);
+  return ep;
+}
+
+/* find, remove and return an element stored under a key */
+void *lhremove(lhashtable_t *lhtp,
+               int (*searchfn)(void* elementp, const void* searchkeyp),
+               const char *key,
+               int keylen){
+  pthread_mutex_t *m = stripe_of(lhtp, key, keylen);
+  void *ep;
+
+  pthread_mutex_lock(m);
+  ep = hremove(lhtp->h, searchfn, key, keylen);
+  pthread_mutex_unlock(m);
+  if(ep){
+    __atomic_sub_fetch(&lhtp->count, 1, __ATOMIC_RELAXED);
+  }
+  return ep;
+}
@@ -0,0 +1,147 @@
+/*=============================================================================
+|   Title: lhash.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a generic locked hash table, the slots of the
+|  table are guarded by a fixed set of striped mutexes so threads working on
+|  keys in different stripes never wait on each other
+|
+|  lookups, inserts and removes only lock the stripe of their key, lhapply()
+|  locks every stripe for the length of the walk
+|
+|  the table doubles its slots whenever it holds more elements than slots,
+|  with every stripe held, so chains stay about one entry long and the slots
+|  stay as compact as the number of elements allows, it never shrinks
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* lhash.h -- public interface to the locked hash table module
+*/
+
+#include <stdint.h>
+
+/* the locked hash table representation is hidden from users of the module */
+typedef void lhashtable_t;
+
+/*
+* Function:  lhopen()
+* --------------------
+* create an empty locked hash table
+*
+* paramaters:
+*  uint32_t hsize: the number of slots the table starts with, rounded up to
+*        a multiple of the number of stripes
+*
+*  returns: lhashtable_t*, an open table, NULL if out of memory
+*/
+lhashtable_t *lhopen(uint32_t hsize);
+
+/*
+* Function:  lhclose()
+* --------------------
+* deallocate a locked hash table, frees everything in it except the elements
+*
+* paramaters:
+*  lhashtable_t *lhtp: table to close
+*
+*  returns: NULL
+*/
+void lhclose(lhashtable_t *lhtp);
+
+/*
+* Function:  lhput()
+* --------------------
+* put an element into the table under the given key
+*
+* paramaters:
+*  lhashtable_t *lhtp: table to insert into
+*  void *ep: element to insert
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int lhput(lhashtable_t *lhtp, void *ep, const char *key, int keylen);
+
+/*
+* Function:  lhinsert()
+* --------------------
+* put an element into the table only if no element matching the key is in
+* it already, the check and the insert happen under one lock
+*
+* paramaters:
+*  lhashtable_t *lhtp: table to insert into
+*  void *ep: element to insert
+*  int (*searchfn)(void* elementp, const void* searchkeyp): returns 1 if
+*        the element matches the search key, 0 if not
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: 0 if inserted, 1 if a matching element already exists,
+*           -1 if not successful
+*/
+int lhinsert(lhashtable_t *lhtp, void *ep,
+             int (*searchfn)(void* elementp, const void* searchkeyp),
+             const char *key, int keylen);
+
+/*
+* Function:  lhapply()
+* --------------------
+*  apply a void function to every element of the table
+*
+* paramaters:
+*  lhashtable_t *lhtp: table of items to apply the function on
+*  void (*fn)(void* ep): a function to apply to each element
+*
+*  returns: NULL
+*/
+void lhapply(lhashtable_t *lhtp, void (*fn)(void* ep));
+
+/*
+* Function:  lhsearch()
+* --------------------
+*  find an element stored under a key
+*
+* paramaters:
+*  lhashtable_t *lhtp: table to search
+*  int (*searchfn)(void* elementp, const void* searchkeyp): returns 1 if
+*        the element matches the search key, 0 if not, the key bytes are
+*        passed in as searchkeyp
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: the void* element if found, NULL if not found
+*/
+void *lhsearch(lhashtable_t *lhtp,
+               int (*searchfn)(void* elementp, const void* searchkeyp),
+               const char *key,
+               int keylen);
+
+/*
+* Function:  lhremove()
+* --------------------
+*  find an element stored under a key, remove it and return it
+*
+* paramaters:
+*  lhashtable_t *lhtp: table to search
+*  int (*searchfn)(void* elementp, const void* searchkeyp): returns 1 if
+*        the element matches the search key, 0 if not
+*  const char *key: the key bytes
+*  int keylen: the number of key bytes
+*
+*  returns: the void* element if found and removed, NULL if not found
+*/
+void *lhremove(lhashtable_t *lhtp,
+               int (*searchfn)(void* elementp, const void* searchkeyp),
+               const char *key,
+               int keylen);
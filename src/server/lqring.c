@@ -0,0 +1,234 @@
+/*=============================================================================
+|   Title: lqring.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile with LQUEUE=lockfree
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the lqueue.h interface as a bounded lock-free
+|  ring that many threads can put into and get from at once, a drop in for
+|  lqueue.c chosen at build time
+|
+|  every cell of the ring carries a sequence number: a cell at position pos
+|  is free for the producer that claims pos when its sequence is pos, and
+|  holds an element for the consumer that claims pos when its sequence is
+|  pos + 1, producers and consumers claim positions with a compare and swap
+|  on their own counter, so lqput() and lqget() never take a lock and a
+|  producer never waits on a consumer unless the ring is full
+|
+|  the ring holds LQRINGSIZE elements, lqput() on a full ring fails instead
+|  of growing the ring
+|
+|  lqapply() and lqsearch() take no lock, they walk the elements present when
+|  they start and may run alongside anything else, lqremove() and lqconcat()
+|  take every element out and put the rest back, so they keep their order,
+|  and other threads see every element, only when no other thread is using
+|  the queue, they are meant for setup and teardown
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "queue.h"
+
+/* elements a ring holds, a power of two */
+#ifndef LQRINGSIZE
+#define LQRINGSIZE 65536
+#endif
+#define CACHELINE 64
+
+typedef struct cell_t{
+  unsigned long seq;
+  void *data;
+} cell_t;
+
+/* the lqueue representation is hidden from users of the module, the two
+counters sit on their own cache lines so producers and consumers do not
+slow each other down */
+typedef struct lqueue_t{
+  unsigned long put_pos;
+  char pad1[CACHELINE - sizeof(unsigned long)];
+  unsigned long get_pos;
+  char pad2[CACHELINE - sizeof(unsigned long)];
+  cell_t *cells;
+  unsigned long mask;
+  /* serializes the operations that take elements out and put them back */
+  pthread_mutex_t walk_lock;
+} lqueue_t;
+
+/* create an empty lqueue */
+lqueue_t* lqopen(void){
+  lqueue_t *lq = (lqueue_t *)malloc(sizeof(lqueue_t));
+  unsigned long i;
+
+  if(!lq){
+    return NULL;
+  }
+  lq->cells = (cell_t *)malloc(sizeof(cell_t) * LQRINGSIZE);
+  if(!lq->cells){
+    free(lq);
+    return NULL;
+  }
+  for(i = 0; i < LQRINGSIZE; i++){
+    lq->cells[i].seq = i;
+    lq->cells[i].data = NULL;
+  }
+  lq->mask = LQRINGSIZE - 1;
+  lq->put_pos = 0;
+  lq->get_pos = 0;
+  pthread_mutex_init(&lq->walk_lock, NULL);
+  return lq;
+}
+
+/* deallocate a lqueue, no other thread may be using it */
+void lqclose(lqueue_t *lqp){
+  pthread_mutex_destroy(&lqp->walk_lock);
+  free(lqp->cells);
+  free(lqp);
+}
+
+/* put element at end of lqueue, fails if the ring is full */
+int lqput(lqueue_t *lqp, void *elementp){
+  unsigned long pos = __atomic_load_n(&lqp->put_pos, __ATOMIC_RELAXED);
+  cell_t *cell;
+  long dif;
+
+  while(1){
+    cell = &lqp->cells[pos & lqp->mask];
+    dif = (long)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+    if(dif == 0){
+      /* a failed swap loads the current position into pos */
+      if(__atomic_compare_exchange_n(&lqp->put_pos, &pos, pos + 1, TRUE,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        break;
+      }
+    }else if(dif < 0){
+      return -1;
+    }else{
+      pos = __atomic_load_n(&lqp->put_pos, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_store_n(&cell->data, elementp, __ATOMIC_RELAXED);
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* get first element from lqueue, NULL if it is empty */
+void* lqget(lqueue_t *lqp){
+  unsigned long pos = __atomic_load_n(&lqp->get_pos, __ATOMIC_RELAXED);
+  cell_t *cell;
+  void *data;
+  long dif;
+
+  while(1){
+    cell = &lqp->cells[pos & lqp->mask];
+    dif = (long)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+    if(dif == 0){
+      if(__atomic_compare_exchange_n(&lqp->get_pos, &pos, pos + 1, TRUE,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        break;
+      }
+    }else if(dif < 0){
+      return NULL;
+    }else{
+      pos = __atomic_load_n(&lqp->get_pos, __ATOMIC_RELAXED);
+    }
+  }
+  data = cell->data;
+  /* the cell is free again for the producer one lap later */
+  __atomic_store_n(&cell->seq, pos + lqp->mask + 1, __ATOMIC_RELEASE);
+  return data;
+}
+
+/* the element at a position if it is still in the ring, NULL if not */
+static void *peek(lqueue_t *lqp, unsigned long pos){
+  cell_t *cell = &lqp->cells[pos & lqp->mask];
+  void *data;
+
+  /* the sequence is read on both sides of the element, as with a seqlock,
+  so an element being put or got is never returned half seen */
+  if(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1){
+    return NULL;
+  }
+  data = __atomic_load_n(&cell->data, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if(__atomic_load_n(&cell->seq, __ATOMIC_RELAXED) != pos + 1){
+    return NULL;
+  }
+  return data;
+}
+
+/* apply a void function to every element of a lqueue */
+void lqapply(lqueue_t *lqp, void (*fn)(void* elementp)){
+  unsigned long pos, end;
+  void *data;
+
+  pos = __atomic_load_n(&lqp->get_pos, __ATOMIC_ACQUIRE);
+  end = __atomic_load_n(&lqp->put_pos, __ATOMIC_ACQUIRE);
+  for(; pos != end; pos++){
+    if((data = peek(lqp, pos)) != NULL){
+      fn(data);
+    }
+  }
+}
+
+/* search a lqueue using a supplied boolean function, returns an element */
+void* lqsearch(lqueue_t *lqp, int (*searchfn)(void* elementp,const void* keyp), const void* skeyp){
+  unsigned long pos, end;
+  void *data, *found = NULL;
+
+  pos = __atomic_load_n(&lqp->get_pos, __ATOMIC_ACQUIRE);
+  end = __atomic_load_n(&lqp->put_pos, __ATOMIC_ACQUIRE);
+  for(; pos != end && !found; pos++){
+    if((data = peek(lqp, pos)) != NULL && searchfn(data, skeyp)){
+      found = data;
+    }
+  }
+  return found;
+}
+
+/* search a lqueue using a supplied boolean function, removes and
+ * returns the element
+ */
+void* lqremove(lqueue_t *lqp,
+	      int (*searchfn)(void* elementp,const void* keyp),
+	      const void* skeyp){
+  queue_t *rest = qopen();
+  void *data, *found = NULL;
+
+  if(!rest){
+    return NULL;
+  }
+  pthread_mutex_lock(&lqp->walk_lock);
+  while((data = lqget(lqp)) != NULL){
+    if(!found && searchfn(data, skeyp)){
+      found = data;
+    }else{
+      qput(rest, data);
+    }
+  }
+  while((data = qget(rest)) != NULL){
+    lqput(lqp, data);
+  }
+  pthread_mutex_unlock(&lqp->walk_lock);
+  qclose(rest);
+  return found;
+}
+
+/* concatenatenates elements of q2 into q1, q2 is dealocated upon completion */
+void lqconcat(lqueue_t *q1p, lqueue_t *q2p){
+  void *data;
+
+  pthread_mutex_lock(&q1p->walk_lock);
+  while((data = lqget(q2p)) != NULL){
+    lqput(q1p, data);
+  }
+  pthread_mutex_unlock(&q1p->walk_lock);
+  lqclose(q2p);
+}
@@ -0,0 +1,144 @@
+/*=============================================================================
+|   Title: msgbuf.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements immutable, reference counted message buffers, see
+|  msgbuf.h, the header and the bytes share one allocation
+|
+|  most chat lines are short, so buffers up to MSGBUF_SMALL bytes come from
+|  an object pool instead of the heap, and buffers up to MSGBUF_LINE bytes,
+|  enough for the longest line the server frames, from a second pool, so
+|  relaying chat never goes to the heap once the pools have warmed up, a
+|  third pool holds buffers up to MSGBUF_REPLY bytes, enough for the
+|  largest reply to a command, such as a full '/who' page or '/stats'
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "msgbuf.h"
+#include "pool.h"
+#include "protocol.h"
+
+/* buffers whose header and bytes fit in this many bytes are pooled */
+#define MSGBUF_SMALL 256
+#define MSGBUF_LINE (2048 + 128)
+#define MSGBUF_REPLY (32 * 1024)
+#define POOL_SMALL 1
+#define POOL_LINE 2
+#define POOL_REPLY 3
+
+static unsigned long allocations;
+static pool_t *small_pool;
+static pool_t *line_pool;
+static pool_t *reply_pool;
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
+
+static void open_pools(void){
+  small_pool = pool_open("msgbuf", MSGBUF_SMALL);
+  line_pool = pool_open("msgbuf-line", MSGBUF_LINE);
+  reply_pool = pool_open("msgbuf-reply", MSGBUF_REPLY);
+}
+
+/* allocate a buffer for len bytes holding one reference */
+msgbuf_t *msgbuf_alloc(size_t len){
+  msgbuf_t *mb = NULL;
+  int pooled = 0;
+
+  if(sizeof(msgbuf_t) + len <= MSGBUF_REPLY){
+    pthread_once(&pools_once, open_pools);
+    if(sizeof(msgbuf_t) + len <= MSGBUF_SMALL){
+      if(small_pool && (mb = (msgbuf_t *)pool_get(small_pool))){
+        pooled = POOL_SMALL;
+      }
+    }else if(sizeof(msgbuf_t) + len <= MSGBUF_LINE){
+      if(line_pool && (mb = (msgbuf_t *)pool_get(line_pool))){
+        pooled = POOL_LINE;
+      }
+    }else if(reply_pool && (mb = (msgbuf_t *)pool_get(reply_pool))){
+      pooled = POOL_REPLY;
+    }
+  }
+  if(!mb){
+    mb = (msgbuf_t *)malloc(sizeof(msgbuf_t) + (len ? len : 1));
+  }
+  if(!mb){
+    return NULL;
+  }
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  mb->refs = 1;
+  mb->pooled = pooled;
+  mb->len = len;
+  mb->data = (char *)(mb + 1);
+  return mb;
+}
+
+/* frame prefix and body into a single buffer */
+msgbuf_t *msgbuf_frame(int opcode, int flags, const char *prefix,
+                       size_t prefixlen, const char *body, size_t bodylen){
+  msgbuf_t *mb;
+
+  if(prefixlen + bodylen > PROTO_MAXPAYLOAD){
+    return NULL;
+  }
+  mb = msgbuf_alloc(PROTO_HDRLEN + prefixlen + bodylen);
+  if(!mb){
+    return NULL;
+  }
+  proto_pack_header((unsigned char *)mb->data, opcode, flags,
+                    prefixlen + bodylen);
+  if(prefixlen > 0){
+    memcpy(mb->data + PROTO_HDRLEN, prefix, prefixlen);
+  }
+  if(bodylen > 0){
+    memcpy(mb->data + PROTO_HDRLEN + prefixlen, body, bodylen);
+  }
+  return mb;
+}
+
+/* a buffer pointing at bytes owned by someone else */
+msgbuf_t *msgbuf_wrap(const char *data, size_t len){
+  msgbuf_t *mb = msgbuf_alloc(0);
+
+  if(mb){
+    mb->data = (char *)data;
+    mb->len = len;
+  }
+  return mb;
+}
+
+/* take another reference */
+msgbuf_t *msgbuf_hold(msgbuf_t *mb){
+  __atomic_add_fetch(&mb->refs, 1, __ATOMIC_RELAXED);
+  return mb;
+}
+
+/* drop a reference, freeing the buffer with the last one */
+void msgbuf_release(msgbuf_t *mb){
+  if(__atomic_sub_fetch(&mb->refs, 1, __ATOMIC_ACQ_REL) == 0){
+    if(mb->pooled == POOL_SMALL){
+      pool_put(small_pool, mb);
+    }else if(mb->pooled == POOL_LINE){
+      pool_put(line_pool, mb);
+    }else if(mb->pooled == POOL_REPLY){
+      pool_put(reply_pool, mb);
+    }else{
+      free(mb);
+    }
+  }
+}
+
+/* number of buffers allocated so far */
+unsigned long msgbuf_allocations(void){
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,123 @@
+/*=============================================================================
+|   Title: msgbuf.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements immutable, reference counted message buffers
+|
+|  a message going to many clients is framed once into a single msgbuf and
+|  every recipient's outbound queue holds a reference to it, so sending to
+|  one more client costs a pointer and a reference count bump instead of a
+|  copy of the message
+|
+|  a msgbuf must not be changed once it has been handed to anyone else
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* msgbuf.h -- public interface to the message buffer module
+*/
+
+#include <stddef.h>
+
+typedef struct msgbuf_t{
+  int refs;
+  /* the pool the buffer came from, 0 if it came from the heap */
+  int pooled;
+  size_t len;
+  /* the bytes to send, len of them */
+  char *data;
+} msgbuf_t;
+
+/*
+* Function:  msgbuf_alloc()
+* --------------------
+* allocates a message buffer with room for len bytes and one reference,
+* the caller fills in data before sharing it
+*
+* paramaters:
+*  size_t len: the number of bytes the message holds
+*
+*  returns: msgbuf_t*, the new buffer, NULL if out of memory
+*/
+msgbuf_t *msgbuf_alloc(size_t len);
+
+/*
+* Function:  msgbuf_frame()
+* --------------------
+* builds a framed message from a prefix and a body in one allocation, either
+* part may be empty, for example "name: " and the line the user typed
+*
+* paramaters:
+*  int opcode: the frame's opcode
+*  int flags: the frame's flags
+*  const char *prefix: bytes placed at the start of the payload
+*  size_t prefixlen: the number of prefix bytes
+*  const char *body: bytes placed after the prefix
+*  size_t bodylen: the number of body bytes
+*
+*  returns: msgbuf_t*, the framed message holding one reference, NULL if out
+*           of memory or too long for a frame
+*/
+msgbuf_t *msgbuf_frame(int opcode, int flags, const char *prefix,
+                       size_t prefixlen, const char *body, size_t bodylen);
+
+/*
+* Function:  msgbuf_wrap()
+* --------------------
+* makes a message buffer for bytes that live somewhere else, such as a
+* mapped file, so they can be queued like any other message without being
+* copied, the bytes must stay valid and unchanged for as long as the buffer
+* lives, they are not freed with it
+*
+* paramaters:
+*  const char *data: the bytes
+*  size_t len: the number of bytes
+*
+*  returns: msgbuf_t*, the buffer holding one reference, NULL if out of
+*           memory
+*/
+msgbuf_t *msgbuf_wrap(const char *data, size_t len);
+
+/*
+* Function:  msgbuf_hold()
+* --------------------
+* takes another reference to a message buffer
+*
+* paramaters:
+*  msgbuf_t *mb: the buffer
+*
+*  returns: msgbuf_t*, the same buffer
+*/
+msgbuf_t *msgbuf_hold(msgbuf_t *mb);
+
+/*
+* Function:  msgbuf_release()
+* --------------------
+* drops a reference, the buffer is freed with the last one
+*
+* paramaters:
+*  msgbuf_t *mb: the buffer
+*
+*  returns: NULL
+*/
+void msgbuf_release(msgbuf_t *mb);
+
+/*
+* Function:  msgbuf_allocations()
+* --------------------
+* the number of message buffers allocated since the program started
+*
+* paramaters: null
+*
+*  returns: unsigned long, the allocation count
+*/
+unsigned long msgbuf_allocations(void);
@@ -0,0 +1,286 @@
+/*=============================================================================
+|   Title: outbuf.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a bounded outbound queue of shared messages for a
+|  non-blocking socket, see outbuf.h
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <pthread.h>
+
+#include "outbuf.h"
+#include "pool.h"
+
+/* slots in the ring once something has to be queued */
+#define OUTBUF_MINCAP 16
+/* rings of OUTBUF_MINCAP doubled up to this many times come from pools, a
+deeper backlog than 16 KiB of entries goes to the heap */
+#define OUTBUF_RINGPOOLS 7
+/* most queued messages gathered into one sendmsg() */
+#define OUTBUF_MAXIOV 64
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static pool_t *ring_pools[OUTBUF_RINGPOOLS];
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
+
+static void open_pools(void){
+  static const char *names[OUTBUF_RINGPOOLS] = {
+    "outbuf-16", "outbuf-32", "outbuf-64", "outbuf-128", "outbuf-256",
+    "outbuf-512", "outbuf-1024"
+  };
+  int i;
+
+  for(i = 0; i < OUTBUF_RINGPOOLS; i++){
+    ring_pools[i] = pool_open(names[i], sizeof(outbuf_entry_t) *
+                                        (OUTBUF_MINCAP << i));
+  }
+}
+
+/* the pool holding rings of cap entries, -1 for a ring from the heap */
+static int ring_class(size_t cap){
+  int i;
+
+  for(i = 0; i < OUTBUF_RINGPOOLS; i++){
+    if(cap == (size_t)OUTBUF_MINCAP << i){
+      return ring_pools[i] ? i : -1;
+    }
+  }
+  return -1;
+}
+
+/* a ring of cap entries, from the calling thread's cache when it has one */
+static outbuf_entry_t *ring_get(size_t cap){
+  int c;
+
+  pthread_once(&pools_once, open_pools);
+  if((c = ring_class(cap)) >= 0){
+    return (outbuf_entry_t *)pool_get(ring_pools[c]);
+  }
+  return (outbuf_entry_t *)malloc(sizeof(outbuf_entry_t) * cap);
+}
+
+/* give a ring back to where ring_get() took it from */
+static void ring_put(outbuf_entry_t *ring, size_t cap){
+  int c;
+
+  if(!ring){
+    return;
+  }
+  if((c = ring_class(cap)) >= 0){
+    pool_put(ring_pools[c], ring);
+  }else{
+    free(ring);
+  }
+}
+
+/* set up an empty outbound queue */
+void outbuf_init(outbuf_t *ob, size_t limit, size_t maxcount){
+  ob->ring = NULL;
+  ob->head = 0;
+  ob->count = 0;
+  ob->cap = 0;
+  ob->len = 0;
+  ob->limit = limit;
+  ob->maxcount = maxcount;
+  ob->busy = 0;
+}
+
+/* drop every pending message */
+void outbuf_free(outbuf_t *ob){
+  size_t i;
+
+  for(i = 0; i < ob->count; i++){
+    msgbuf_release(ob->ring[(ob->head + i) % ob->cap].mb);
+  }
+  ring_put(ob->ring, ob->cap);
+  outbuf_init(ob, ob->limit, ob->maxcount);
+}
+
+/* number of bytes waiting to be written */
+size_t outbuf_pending(outbuf_t *ob){
+  return ob->len;
+}
+
+/* number of messages waiting to be written */
+size_t outbuf_messages(outbuf_t *ob){
+  return ob->count;
+}
+
+/* whether a message can be queued within both limits */
+int outbuf_fits(outbuf_t *ob, msgbuf_t *mb){
+  return ob->len + mb->len <= ob->limit &&
+         (ob->maxcount == 0 || ob->count < ob->maxcount);
+}
+
+/* drop the oldest message nothing has been written of */
+size_t outbuf_drop_oldest(outbuf_t *ob){
+  size_t keep, dropped, i;
+
+  /* messages handed out by outbuf_iov() and a partly written head stay */
+  keep = ob->busy;
+  if(keep == 0 && ob->count > 0 && ob->ring[ob->head].off > 0){
+    keep = 1;
+  }
+  if(keep >= ob->count){
+    return 0;
+  }
+  dropped = ob->ring[(ob->head + keep) % ob->cap].mb->len;
+  msgbuf_release(ob->ring[(ob->head + keep) % ob->cap].mb);
+  /* the kept messages move up one slot into the dropped one's place */
+  for(i = keep; i > 0; i--){
+    ob->ring[(ob->head + i) % ob->cap] = ob->ring[(ob->head + i - 1) % ob->cap];
+  }
+  ob->head = (ob->head + 1) % ob->cap;
+  ob->count--;
+  ob->len -= dropped;
+  return dropped;
+}
+
+/* queue a reference to the unwritten part of a message */
+static int append(outbuf_t *ob, msgbuf_t *mb, size_t off){
+  outbuf_entry_t *grown;
+  size_t newcap, i;
+
+  if(ob->len + (mb->len - off) > ob->limit ||
+     (ob->maxcount > 0 && ob->count >= ob->maxcount)){
+    return -1;
+  }
+  if(ob->count == ob->cap){
+    newcap = ob->cap ? ob->cap * 2 : OUTBUF_MINCAP;
+    grown = ring_get(newcap);
+    if(!grown){
+      return -1;
+    }
+    /* unwrap the ring into the new array */
+    for(i = 0; i < ob->count; i++){
+      grown[i] = ob->ring[(ob->head + i) % ob->cap];
+    }
+    ring_put(ob->ring, ob->cap);
+    ob->ring = grown;
+    ob->cap = newcap;
+    ob->head = 0;
+  }
+  ob->ring[(ob->head + ob->count) % ob->cap].mb = msgbuf_hold(mb);
+  ob->ring[(ob->head + ob->count) % ob->cap].off = off;
+  ob->count++;
+  ob->len += mb->len - off;
+  return 0;
+}
+
+/* write to the socket, queueing whatever the kernel does not take */
+int outbuf_send(outbuf_t *ob, int sock, msgbuf_t *mb){
+  ssize_t n = 0;
+
+  /* keep the stream in order, new messages go behind the pending ones */
+  if(ob->count == 0){
+    do{
+      n = send(sock, mb->data, mb->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }while(n < 0 && errno == EINTR);
+    if(n < 0){
+      if(errno != EAGAIN && errno != EWOULDBLOCK){
+        return -1;
+      }
+      n = 0;
+    }
+    if((size_t)n == mb->len){
+      return 0;
+    }
+  }
+  return append(ob, mb, n);
+}
+
+/* queue a message without trying the socket */
+int outbuf_queue(outbuf_t *ob, msgbuf_t *mb){
+  return append(ob, mb, 0);
+}
+
+/* point iovecs at the oldest pending bytes */
+int outbuf_iov(outbuf_t *ob, struct iovec *iov, int max){
+  outbuf_entry_t *e;
+  size_t i, niov = ob->count < (size_t)max ? ob->count : (size_t)max;
+
+  for(i = 0; i < niov; i++){
+    e = &ob->ring[(ob->head + i) % ob->cap];
+    iov[i].iov_base = e->mb->data + e->off;
+    iov[i].iov_len = e->mb->len - e->off;
+  }
+  ob->busy = niov;
+  return (int)niov;
+}
+
+/* account for bytes written from the iovecs */
+void outbuf_consume(outbuf_t *ob, size_t n){
+  outbuf_entry_t *e;
+  size_t done;
+
+  /* release every message that was written in full */
+  ob->busy = 0;
+  ob->len -= n;
+  while(n > 0){
+    e = &ob->ring[ob->head];
+    done = e->mb->len - e->off;
+    if(n < done){
+      e->off += n;
+      break;
+    }
+    n -= done;
+    msgbuf_release(e->mb);
+    ob->head = (ob->head + 1) % ob->cap;
+    ob->count--;
+  }
+  if(ob->count > 0){
+    return;
+  }
+  /* drained, a grown ring goes back to its pool so an idle connection holds
+  only the smallest one, the thread's pool cache hands it out again for the
+  next burst on any connection without going to the heap */
+  if(ob->cap > OUTBUF_MINCAP){
+    ring_put(ob->ring, ob->cap);
+    outbuf_init(ob, ob->limit, ob->maxcount);
+  }
+  ob->head = 0;
+}
+
+/* write pending messages until the socket would block */
+int outbuf_flush(outbuf_t *ob, int sock){
+  struct iovec iov[OUTBUF_MAXIOV];
+  struct msghdr msg;
+  ssize_t n;
+
+  while(ob->count > 0){
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = outbuf_iov(ob, iov, OUTBUF_MAXIOV);
+    n = sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if(n < 0){
+      ob->busy = 0;
+      if(errno == EINTR){
+        continue;
+      }
+      if(errno == EAGAIN || errno == EWOULDBLOCK){
+        return 1;
+      }
+      return -1;
+    }
+    outbuf_consume(ob, n);
+  }
+  return 0;
+}
@@ -0,0 +1,213 @@
+/*=============================================================================
+|   Title: outbuf.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a bounded outbound queue for a non-blocking socket,
+|  messages the kernel will not take right away are queued and written out
+|  later, several at a time with sendmsg(), when the socket becomes writable,
+|  messages can also be queued on purpose so a burst goes out in one write
+|
+|  the queue holds references to shared msgbufs rather than copies of their
+|  bytes, a connection that has never had anything queued costs nothing
+|  beyond the struct itself, rings come from object pools by size, and a
+|  ring that grew past its smallest size goes back to its pool once it
+|  drains, so memory follows the bursts in flight rather than every
+|  connection that was ever busy
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* outbuf.h -- public interface to the outbound queue module
+*/
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "msgbuf.h"
+
+/* a queued message and how much of it has been written */
+typedef struct outbuf_entry_t{
+  msgbuf_t *mb;
+  size_t off;
+} outbuf_entry_t;
+
+typedef struct outbuf_t{
+  /* ring of pending messages, ring[head] is written first */
+  outbuf_entry_t *ring;
+  size_t head;
+  size_t count;
+  size_t cap;
+  /* unwritten bytes across all pending messages */
+  size_t len;
+  /* most bytes allowed to be pending at once */
+  size_t limit;
+  /* most messages allowed to be pending at once, 0 for no limit */
+  size_t maxcount;
+  /* leading messages handed out by outbuf_iov() and not yet consumed */
+  size_t busy;
+} outbuf_t;
+
+/*
+* Function:  outbuf_init()
+* --------------------
+* sets up an empty outbound queue
+*
+* paramaters:
+*  outbuf_t *ob: the queue to set up
+*  size_t limit: the most bytes that may be pending at once
+*  size_t maxcount: the most messages that may be pending at once, 0 for no
+*        limit
+*
+*  returns: NULL
+*/
+void outbuf_init(outbuf_t *ob, size_t limit, size_t maxcount);
+
+/*
+* Function:  outbuf_free()
+* --------------------
+* drops everything pending in an outbound queue
+*
+* paramaters:
+*  outbuf_t *ob: the queue to free
+*
+*  returns: NULL
+*/
+void outbuf_free(outbuf_t *ob);
+
+/*
+* Function:  outbuf_pending()
+* --------------------
+* the number of bytes waiting to be written
+*
+* paramaters:
+*  outbuf_t *ob: the queue to check
+*
+*  returns: size_t, the number of pending bytes
+*/
+size_t outbuf_pending(outbuf_t *ob);
+
+/*
+* Function:  outbuf_messages()
+* --------------------
+* the number of messages waiting to be written, including one that is
+* partly written
+*
+* paramaters:
+*  outbuf_t *ob: the queue to check
+*
+*  returns: size_t, the number of pending messages
+*/
+size_t outbuf_messages(outbuf_t *ob);
+
+/*
+* Function:  outbuf_fits()
+* --------------------
+* checks whether a message can be queued without passing either limit
+*
+* paramaters:
+*  outbuf_t *ob: the queue to check
+*  msgbuf_t *mb: the message that would be queued
+*
+*  returns: TRUE if it fits, FALSE if not
+*/
+int outbuf_fits(outbuf_t *ob, msgbuf_t *mb);
+
+/*
+* Function:  outbuf_drop_oldest()
+* --------------------
+* drops the oldest pending message that nothing has been written of yet, a
+* partly written message is never dropped since the peer would then see half
+* a frame, nor is one outbuf_iov() handed out
+*
+* paramaters:
+*  outbuf_t *ob: the queue to drop from
+*
+*  returns: size_t, the bytes dropped, 0 if no message could be dropped
+*/
+size_t outbuf_drop_oldest(outbuf_t *ob);
+
+/*
+* Function:  outbuf_send()
+* --------------------
+* sends a message on a non-blocking socket, writing straight to the socket
+* when nothing is pending and queueing a reference to whatever the kernel does
+* not take, the call never blocks and never copies the message
+*
+* paramaters:
+*  outbuf_t *ob: the socket's outbound queue
+*  int sock: the socket to write to
+*  msgbuf_t *mb: the message, the caller keeps its own reference
+*
+*  returns: 0 if successful, -1 if the socket failed or the queue limit
+*           would be passed
+*/
+int outbuf_send(outbuf_t *ob, int sock, msgbuf_t *mb);
+
+/*
+* Function:  outbuf_queue()
+* --------------------
+* queues a message without trying the socket, so several messages can be
+* written together by the next outbuf_flush()
+*
+* paramaters:
+*  outbuf_t *ob: the socket's outbound queue
+*  msgbuf_t *mb: the message, the caller keeps its own reference
+*
+*  returns: 0 if successful, -1 if the queue limit would be passed
+*/
+int outbuf_queue(outbuf_t *ob, msgbuf_t *mb);
+
+/*
+* Function:  outbuf_iov()
+* --------------------
+* points iovecs at the oldest pending bytes, for a caller that writes them
+* itself, such as through io_uring, the messages stay queued, and are not
+* dropped by outbuf_drop_oldest(), until outbuf_consume() is called
+*
+* paramaters:
+*  outbuf_t *ob: the queue
+*  struct iovec *iov: the iovecs to fill in
+*  int max: the number of iovecs
+*
+*  returns: int, the number of iovecs filled in
+*/
+int outbuf_iov(outbuf_t *ob, struct iovec *iov, int max);
+
+/*
+* Function:  outbuf_consume()
+* --------------------
+* accounts for bytes written from the iovecs outbuf_iov() filled in,
+* releasing every message written in full
+*
+* paramaters:
+*  outbuf_t *ob: the queue
+*  size_t n: the number of bytes written, 0 if the write failed
+*
+*  returns: NULL
+*/
+void outbuf_consume(outbuf_t *ob, size_t n);
+
+/*
+* Function:  outbuf_flush()
+* --------------------
+* writes as many pending bytes as the socket will take without blocking,
+* gathering several queued messages into each sendmsg(), called when the
+* socket becomes writable
+*
+* paramaters:
+*  outbuf_t *ob: the socket's outbound queue
+*  int sock: the socket to write to
+*
+*  returns: 0 if the queue was drained, 1 if bytes are still pending,
+*           -1 if the socket failed
+*/
+int outbuf_flush(outbuf_t *ob, int sock);
@@ -0,0 +1,318 @@
+/*=============================================================================
+|   Title: pool.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a fixed size object pool with per-thread caches,
+|  see pool.h
+|
+|  a free object's first bytes link it into a free list, so free objects cost
+|  no memory beyond their own, every thread gets a slot number the first
+|  time it touches any pool and uses that slot's cache in every pool, threads
+|  past POOL_MAXTHREADS share the locked path
+|
+*===========================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+/* threads that get a private cache */
+#define POOL_MAXTHREADS 64
+/* objects a thread caches before it hands a batch back */
+#define POOL_CACHEMAX 64
+/* objects moved between a thread cache and the shared list at once */
+#define POOL_BATCH 32
+/* bytes taken from the heap for each slab */
+#define POOL_SLABBYTES (64 * 1024)
+/* pools that pool_report() knows about */
+#define POOL_MAXPOOLS 32
+
+typedef struct free_obj{
+  struct free_obj *next;
+} free_obj;
+
+/* slabs are chained together so they stay reachable */
+typedef struct slab_t{
+  struct slab_t *next;
+} slab_t;
+
+/* one thread's cache, only ever written by that thread */
+typedef struct pool_cache_t{
+  free_obj *head;
+  int count;
+  unsigned long hits;
+  unsigned long refills;
+  unsigned long misses;
+  unsigned long gets;
+  unsigned long puts;
+  /* keep each thread's cache on its own cache lines */
+  char pad[64];
+} pool_cache_t;
+
+struct pool_t{
+  const char *name;
+  size_t objsize;
+  pthread_mutex_t lock;
+  /* everything below is guarded by lock */
+  free_obj *shared;
+  slab_t *slabs;
+  size_t resident_bytes;
+  /* counters of threads without a cache */
+  unsigned long shared_gets;
+  unsigned long shared_puts;
+  unsigned long shared_misses;
+  pool_cache_t caches[POOL_MAXTHREADS];
+};
+
+static __thread int my_slot = -1;
+static int next_slot;
+static pool_t *pools[POOL_MAXPOOLS];
+static int npools;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the calling thread's cache slot, -1 if it has none */
+static int thread_slot(void){
+  if(my_slot == -1){
+    my_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+    if(my_slot >= POOL_MAXTHREADS){
+      my_slot = -2;
+    }
+  }
+  return my_slot >= 0 ? my_slot : -1;
+}
+
+/* create an empty pool */
+pool_t *pool_open(const char *name, size_t objsize){
+  pool_t *pp = (pool_t *)calloc(1, sizeof(pool_t));
+
+  if(!pp){
+    return NULL;
+  }
+  if(objsize < sizeof(free_obj)){
+    objsize = sizeof(free_obj);
+  }
+  /* keep every object 16 byte aligned */
+  pp->objsize = (objsize + 15) & ~(size_t)15;
+  pp->name = name;
+  pthread_mutex_init(&pp->lock, NULL);
+
+  pthread_mutex_lock(&registry_lock);
+  if(npools < POOL_MAXPOOLS){
+    pools[npools++] = pp;
+  }
+  pthread_mutex_unlock(&registry_lock);
+  return pp;
+}
+
+/*
+ * take a new slab from the heap and link its objects into a free list, the
+ * pool's lock is held
+ */
+static free_obj *new_slab(pool_t *pp, int *count){
+  size_t header = (sizeof(slab_t) + 15) & ~(size_t)15;
+  size_t bytes = POOL_SLABBYTES;
+  size_t n, i;
+  slab_t *slab;
+  free_obj *head = NULL, *obj;
+  char *base;
+
+  if(header + pp->objsize * 8 > bytes){
+    bytes = header + pp->objsize * 8;
+  }
+  slab = (slab_t *)malloc(bytes);
+  if(!slab){
+    return NULL;
+  }
+  slab->next = pp->slabs;
+  pp->slabs = slab;
+  pp->resident_bytes += bytes;
+
+  base = (char *)slab + header;
+  n = (bytes - header) / pp->objsize;
+  for(i = n; i > 0; i--){
+    obj = (free_obj *)(base + (i - 1) * pp->objsize);
+    obj->next = head;
+    head = obj;
+  }
+  *count = (int)n;
+  return head;
+}
+
+/* move up to POOL_BATCH objects from the shared list, the lock is held */
+static free_obj *take_batch(pool_t *pp, int *count){
+  free_obj *head = pp->shared, *tail = pp->shared;
+  int n = 1;
+
+  if(!head){
+    *count = 0;
+    return NULL;
+  }
+  while(n < POOL_BATCH && tail->next){
+    tail = tail->next;
+    n++;
+  }
+  pp->shared = tail->next;
+  tail->next = NULL;
+  *count = n;
+  return head;
+}
+
+/* allocate an object */
+void *pool_get(pool_t *pp){
+  int slot = thread_slot();
+  pool_cache_t *c;
+  free_obj *obj;
+  int n;
+
+  if(slot < 0){
+    /* no private cache, everything goes through the lock */
+    pthread_mutex_lock(&pp->lock);
+    obj = pp->shared;
+    if(obj){
+      pp->shared = obj->next;
+    }else{
+      obj = new_slab(pp, &n);
+      if(obj){
+        pp->shared = obj->next;
+        pp->shared_misses++;
+      }
+    }
+    if(obj){
+      pp->shared_gets++;
+    }
+    pthread_mutex_unlock(&pp->lock);
+    return obj;
+  }
+
+  c = &pp->caches[slot];
+  if(c->head){
+    c->hits++;
+  }else{
+    pthread_mutex_lock(&pp->lock);
+    c->head = take_batch(pp, &n);
+    if(c->head){
+      c->refills++;
+    }else{
+      c->head = new_slab(pp, &n);
+      c->misses++;
+    }
+    pthread_mutex_unlock(&pp->lock);
+    if(!c->head){
+      return NULL;
+    }
+    c->count = n;
+  }
+  obj = c->head;
+  c->head = obj->next;
+  c->count--;
+  c->gets++;
+  return obj;
+}
+
+/* give an object back */
+void pool_put(pool_t *pp, void *ptr){
+  int slot = thread_slot();
+  free_obj *obj = (free_obj *)ptr, *tail;
+  pool_cache_t *c;
+  int n;
+
+  if(!obj){
+    return;
+  }
+  if(slot < 0){
+    pthread_mutex_lock(&pp->lock);
+    obj->next = pp->shared;
+    pp->shared = obj;
+    pp->shared_puts++;
+    pthread_mutex_unlock(&pp->lock);
+    return;
+  }
+
+  c = &pp->caches[slot];
+  obj->next = c->head;
+  c->head = obj;
+  c->count++;
+  c->puts++;
+
+  /* the cache is too big, hand a batch back for other threads to use */
+  if(c->count > POOL_CACHEMAX){
+    tail = c->head;
+    for(n = 1; n < POOL_BATCH; n++){
+      tail = tail->next;
+    }
+    pthread_mutex_lock(&pp->lock);
+    obj = c->head;
+    c->head = tail->next;
+    tail->next = pp->shared;
+    pp->shared = obj;
+    pthread_mutex_unlock(&pp->lock);
+    c->count -= POOL_BATCH;
+  }
+}
+
+/* add up a pool's counters */
+void pool_stats(pool_t *pp, pool_stats_t *stats){
+  unsigned long gets, puts;
+  pool_cache_t *c;
+  int i;
+
+  pthread_mutex_lock(&pp->lock);
+  stats->name = pp->name;
+  stats->objsize = pp->objsize;
+  stats->hits = 0;
+  stats->refills = 0;
+  stats->misses = pp->shared_misses;
+  gets = pp->shared_gets;
+  puts = pp->shared_puts;
+  stats->resident_bytes = pp->resident_bytes;
+  pthread_mutex_unlock(&pp->lock);
+
+  for(i = 0; i < POOL_MAXTHREADS; i++){
+    c = &pp->caches[i];
+    stats->hits += __atomic_load_n(&c->hits, __ATOMIC_RELAXED);
+    stats->refills += __atomic_load_n(&c->refills, __ATOMIC_RELAXED);
+    stats->misses += __atomic_load_n(&c->misses, __ATOMIC_RELAXED);
+    gets += __atomic_load_n(&c->gets, __ATOMIC_RELAXED);
+    puts += __atomic_load_n(&c->puts, __ATOMIC_RELAXED);
+  }
+  stats->in_use = (long)(gets - puts);
+}
+
+/* read every pool's counters */
+int pool_stats_all(pool_stats_t *stats, int max){
+  int i, n;
+
+  pthread_mutex_lock(&registry_lock);
+  n = npools < max ? npools : max;
+  pthread_mutex_unlock(&registry_lock);
+
+  for(i = 0; i < n; i++){
+    pool_stats(pools[i], &stats[i]);
+  }
+  return n;
+}
+
+/* print every pool's counters */
+void pool_report(FILE *fp){
+  pool_stats_t stats[POOL_MAXPOOLS];
+  int i, n;
+
+  n = pool_stats_all(stats, POOL_MAXPOOLS);
+  for(i = 0; i < n; i++){
+    fprintf(fp, "pool %-10s objsize %4lu in_use %8ld hits %10lu refills %8lu "
+            "misses %6lu resident_bytes %10lu\n", stats[i].name,
+            (unsigned long)stats[i].objsize, stats[i].in_use, stats[i].hits,
+            stats[i].refills, stats[i].misses,
+            (unsigned long)stats[i].resident_bytes);
+  }
+}
@@ -0,0 +1,131 @@
+/*=============================================================================
+|   Title: pool.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a fixed size object pool (a slab allocator) for
+|  the structs the server allocates and frees all the time
+|
+|  objects are carved out of large slabs, every thread keeps a small cache of
+|  free objects that it allocates from and frees to without any lock, only
+|  when a thread's cache runs dry or grows too big does it take the pool's
+|  lock to move a batch of objects to or from the shared free list, and only
+|  when that list is empty is a new slab taken from the heap
+|
+|  slabs are never given back to the heap, a pool's resident size is the
+|  high-water mark of its use
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* pool.h -- public interface to the object pool module
+*/
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* the pool representation is hidden from users of the module */
+typedef struct pool_t pool_t;
+
+/* counters describing one pool */
+typedef struct pool_stats_t{
+  const char *name;
+  size_t objsize;
+  /* allocations served from the calling thread's cache */
+  unsigned long hits;
+  /* allocations that refilled the thread's cache from the shared list */
+  unsigned long refills;
+  /* allocations that had to take a new slab from the heap */
+  unsigned long misses;
+  /* objects handed out and not yet given back */
+  long in_use;
+  /* bytes held in slabs */
+  size_t resident_bytes;
+} pool_stats_t;
+
+/*
+* Function:  pool_open()
+* --------------------
+* create an empty pool of fixed size objects, pools are meant to live as long
+* as the program and are never closed
+*
+* paramaters:
+*  const char *name: a name to report the pool's counters under
+*  size_t objsize: the size of every object in the pool
+*
+*  returns: pool_t*, the new pool, NULL if out of memory
+*/
+pool_t *pool_open(const char *name, size_t objsize);
+
+/*
+* Function:  pool_get()
+* --------------------
+* allocate an object from a pool, the object's contents are undefined
+*
+* paramaters:
+*  pool_t *pp: the pool to allocate from
+*
+*  returns: void*, the object, NULL if out of memory
+*/
+void *pool_get(pool_t *pp);
+
+/*
+* Function:  pool_put()
+* --------------------
+* give an object back to the pool it came from, any thread may give back an
+* object no matter which thread allocated it
+*
+* paramaters:
+*  pool_t *pp: the pool the object came from
+*  void *obj: the object, NULL is ignored
+*
+*  returns: NULL
+*/
+void pool_put(pool_t *pp, void *obj);
+
+/*
+* Function:  pool_stats()
+* --------------------
+* reads a pool's counters, adding up every thread's share, the numbers are
+* a snapshot and may be slightly stale while other threads are busy
+*
+* paramaters:
+*  pool_t *pp: the pool to read
+*  pool_stats_t *stats: filled in with the pool's counters
+*
+*  returns: NULL
+*/
+void pool_stats(pool_t *pp, pool_stats_t *stats);
+
+/*
+* Function:  pool_stats_all()
+* --------------------
+* reads the counters of every pool that has been opened
+*
+* paramaters:
+*  pool_stats_t *stats: filled in with one entry per pool
+*  int max: the most entries stats has room for
+*
+*  returns: int, the number of entries filled in
+*/
+int pool_stats_all(pool_stats_t *stats, int max);
+
+/*
+* Function:  pool_report()
+* --------------------
+* prints one line of counters for every pool that has been opened
+*
+* paramaters:
+*  FILE *fp: where to print
+*
+*  returns: NULL
+*/
+void pool_report(FILE *fp);
@@ -0,0 +1,372 @@
+/*=============================================================================
+ |   Title:  qbench.c
+ |
+ |       Author:  Grace Miller
+ |     Language:  C
+ |   To Compile:  Run the Makefile in the server folder (make qbench)
+ |
+ |        Class:  CS 63 Programming Parallel Systems
+ |     Due Date:  10/17/2026
+ |
+ +-----------------------------------------------------------------------------
+ |
+ |  Description:  measures what the queue.c operations cost at growing queue
+ |              lengths from one thread, and what the lqueue.h
+ |              operations cost when 1 to 64 threads contend for one queue,
+ |              so a replacement structure can be compared against them line
+ |              for line.  Every operation is timed on its own, so the
+ |              latencies include the cost of reading the clock (a few tens
+ |              of nanoseconds).  Throughput from one thread is taken over the
+ |              time spent inside the operation, so setup between timed calls
+ |              does not count, throughput with contending threads is taken
+ |              over the wall clock time of the run
+ |
+ |        Input:  ./qbench [-o OPS] [-t MAXTHREADS]
+ |              OPS- operations timed for each line, divided between the
+ |                   threads, defaults to 200000
+ |              MAXTHREADS- most contending threads, defaults to 64
+ |
+ |       Output:  comma separated values, one header line and then one line
+ |              per structure, operation, thread count and queue length with
+ |              the operations run, operations per second and the p50, p99
+ |              and maximum latency in nanoseconds
+ |
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "queue.h"
+#include "lqueue.h"
+
+/* the latency histogram keeps 4 bits of precision in each power of two */
+#define SUBBUCKETS 16
+#define HISTBUCKETS (64 * SUBBUCKETS)
+/* queue lengths timed from one thread */
+#define NLENGTHS 4
+/* queue lengths timed with contending threads */
+#define NCONTENDED 2
+/* the lqueue implementation linked in, set by the Makefile */
+#ifndef LQUEUE_NAME
+#define LQUEUE_NAME "lqueue"
+#endif
+/* elements every queue is filled from */
+#define MAXLENGTH 10000
+
+/* a log-linear histogram of nanosecond values */
+typedef struct Histogram{
+  unsigned long counts[HISTBUCKETS];
+  unsigned long total;
+  unsigned long max;
+  /* nanoseconds spent inside the counted operations */
+  double sum;
+} Histogram;
+
+/* what one contending thread does and what it measured */
+typedef struct Worker{
+  pthread_t thread;
+  lqueue_t *q;
+  int length;
+  long ops;
+  unsigned int seed;
+  /* lqput and lqget, or lqsearch */
+  int searching;
+  Histogram first;
+  Histogram second;
+} Worker;
+
+int items[2 * MAXLENGTH];
+pthread_barrier_t start_line;
+
+/* nanoseconds on the monotonic clock */
+double now_ns(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* the bucket a value falls in */
+int hist_bucket(unsigned long v){
+  int msb = 0;
+
+  if(v < SUBBUCKETS){
+    return (int)v;
+  }
+  while((v >> msb) > 1){
+    msb++;
+  }
+  return (msb - 3) * SUBBUCKETS + (int)((v >> (msb - 4)) & (SUBBUCKETS - 1));
+}
+
+/* the smallest value in a bucket */
+unsigned long hist_value(int bucket){
+  if(bucket < SUBBUCKETS){
+    return bucket;
+  }
+  return (unsigned long)(SUBBUCKETS + bucket % SUBBUCKETS) <<
+         (bucket / SUBBUCKETS - 1);
+}
+
+/* count one value */
+void hist_add(Histogram *h, double v){
+  unsigned long u = v < 0 ? 0 : (unsigned long)v;
+
+  h->counts[hist_bucket(u)]++;
+  h->total++;
+  h->sum += v;
+  if(u > h->max){
+    h->max = u;
+  }
+}
+
+/* add every value counted in one histogram to another */
+void hist_merge(Histogram *into, Histogram *from){
+  int i;
+
+  for(i = 0; i < HISTBUCKETS; i++){
+    into->counts[i] += from->counts[i];
+  }
+  into->total += from->total;
+  into->sum += from->sum;
+  if(from->max > into->max){
+    into->max = from->max;
+  }
+}
+
+/* the value below which a fraction p of the counted values fall */
+unsigned long hist_percentile(Histogram *h, double p){
+  unsigned long target = (unsigned long)(p * h->total + 0.5), seen = 0;
+  int i;
+
+  if(target == 0){
+    target = 1;
+  }
+  for(i = 0; i < HISTBUCKETS; i++){
+    seen += h->counts[i];
+    if(seen >= target){
+      return hist_value(i);
+    }
+  }
+  return h->max;
+}
+
+/* print one result line, elapsed_ns is the time the operations took */
+void report(const char *structure, const char *op, int threads, int length,
+            Histogram *h, double elapsed_ns){
+  printf("%s,%s,%d,%d,%lu,%.0f,%lu,%lu,%lu\n", structure, op, threads, length,
+         h->total, h->total / (elapsed_ns / 1e9), hist_percentile(h, 0.50),
+         hist_percentile(h, 0.99), h->max);
+  fflush(stdout);
+}
+
+/* comparator for searches, the key is a pointer to the int to find */
+int find_item(void* elementp, const void* keyp){
+  return *(int *)elementp == *(const int *)keyp;
+}
+
+/* does nothing, for timing qapply() itself */
+void touch_item(void* elementp){
+}
+
+/* operations timed at a length, fewer for the ones that walk the queue */
+long walk_ops(long ops, int length){
+  long n = ops / (length / 10 > 0 ? length / 10 : 1);
+
+  return n < 100 ? 100 : n;
+}
+
+/* time every queue.c operation from one thread at one queue length */
+void bench_queue(long ops, int length){
+  Histogram put, get, search, rem, apply, concat;
+  queue_t *q = qopen(), *q2;
+  double t;
+  long j, walks = walk_ops(ops, length);
+  int i, key;
+
+  memset(&put, 0, sizeof(put));
+  memset(&get, 0, sizeof(get));
+  memset(&search, 0, sizeof(search));
+  memset(&rem, 0, sizeof(rem));
+  memset(&apply, 0, sizeof(apply));
+  memset(&concat, 0, sizeof(concat));
+  for(i = 0; i < length; i++){
+    qput(q, &items[i]);
+  }
+
+  /* the queue stays at length, one element in at the tail, one out the head */
+  for(j = 0; j < ops; j++){
+    t = now_ns();
+    qput(q, &items[j % length]);
+    hist_add(&put, now_ns() - t);
+    t = now_ns();
+    qget(q);
+    hist_add(&get, now_ns() - t);
+  }
+  report("queue", "qput", 1, length, &put, put.sum);
+  report("queue", "qget", 1, length, &get, get.sum);
+
+  for(j = 0; j < walks; j++){
+    key = rand() % length;
+    t = now_ns();
+    qsearch(q, find_item, &key);
+    hist_add(&search, now_ns() - t);
+  }
+  report("queue", "qsearch", 1, length, &search, search.sum);
+
+  /* the removed element goes back in untimed */
+  for(j = 0; j < walks; j++){
+    key = rand() % length;
+    t = now_ns();
+    qremove(q, find_item, &key);
+    hist_add(&rem, now_ns() - t);
+    qput(q, &items[key]);
+  }
+  report("queue", "qremove", 1, length, &rem, rem.sum);
+
+  for(j = 0; j < walks; j++){
+    t = now_ns();
+    qapply(q, touch_item);
+    hist_add(&apply, now_ns() - t);
+  }
+  report("queue", "qapply", 1, length, &apply, apply.sum);
+
+  /* a second queue of the same length is built and the extra length
+  drained off again, both untimed */
+  for(j = 0; j < walks; j++){
+    q2 = qopen();
+    for(i = 0; i < length; i++){
+      qput(q2, &items[MAXLENGTH + i]);
+    }
+    t = now_ns();
+    qconcat(q, q2);
+    hist_add(&concat, now_ns() - t);
+    for(i = 0; i < length; i++){
+      qget(q);
+    }
+  }
+  report("queue", "qconcat", 1, length, &concat, concat.sum);
+
+  qclose(q);
+}
+
+/* body of a contending thread */
+void *contend(void *arg){
+  Worker *w = (Worker *)arg;
+  double t;
+  long j;
+  int key;
+
+  pthread_barrier_wait(&start_line);
+  for(j = 0; j < w->ops; j++){
+    if(w->searching){
+      key = rand_r(&w->seed) % w->length;
+      t = now_ns();
+      lqsearch(w->q, find_item, &key);
+      hist_add(&w->first, now_ns() - t);
+    }else{
+      t = now_ns();
+      lqput(w->q, &items[j % w->length]);
+      hist_add(&w->first, now_ns() - t);
+      t = now_ns();
+      lqget(w->q);
+      hist_add(&w->second, now_ns() - t);
+    }
+  }
+  pthread_barrier_wait(&start_line);
+  return NULL;
+}
+
+/* time lqueue.c operations with threads contending for one queue */
+void bench_lqueue(long ops, int nthreads, int length, int searching){
+  Worker *workers = (Worker *)calloc(nthreads, sizeof(Worker));
+  Histogram first, second;
+  lqueue_t *q = lqopen();
+  double start, t;
+  int i;
+
+  if(!workers || !q){
+    printf("could not set up the benchmark\n");
+    exit(1);
+  }
+  memset(&first, 0, sizeof(first));
+  memset(&second, 0, sizeof(second));
+  for(i = 0; i < length; i++){
+    lqput(q, &items[i]);
+  }
+  pthread_barrier_init(&start_line, NULL, nthreads + 1);
+  for(i = 0; i < nthreads; i++){
+    workers[i].q = q;
+    workers[i].length = length;
+    workers[i].ops = (searching ? walk_ops(ops, length) : ops) / nthreads;
+    workers[i].seed = 63 + i;
+    workers[i].searching = searching;
+    pthread_create(&workers[i].thread, NULL, contend, &workers[i]);
+  }
+  /* the clock starts before the barrier, on a busy machine the workers may
+  otherwise finish before this thread runs again */
+  start = now_ns();
+  pthread_barrier_wait(&start_line);
+  pthread_barrier_wait(&start_line);
+  t = now_ns() - start;
+  for(i = 0; i < nthreads; i++){
+    pthread_join(workers[i].thread, NULL);
+    hist_merge(&first, &workers[i].first);
+    hist_merge(&second, &workers[i].second);
+  }
+  pthread_barrier_destroy(&start_line);
+
+  if(searching){
+    report(LQUEUE_NAME, "lqsearch", nthreads, length, &first, t);
+  }else{
+    report(LQUEUE_NAME, "lqput", nthreads, length, &first, t / 2);
+    report(LQUEUE_NAME, "lqget", nthreads, length, &second, t / 2);
+  }
+  lqclose(q);
+  free(workers);
+}
+
+int main(int argc, char* argv[]){
+  int lengths[NLENGTHS] = {10, 100, 1000, 10000};
+  int contended[NCONTENDED] = {10, 1000};
+  long ops = 200000;
+  int maxthreads = 64;
+  int opt, i, l, t;
+
+  while((opt = getopt(argc, argv, "o:t:")) != -1){
+    if(opt == 'o'){
+      ops = atol(optarg);
+    }else if(opt == 't'){
+      maxthreads = atoi(optarg);
+    }else{
+      printf("usage: ./qbench [-o OPS] [-t MAXTHREADS]\n");
+      return(1);
+    }
+  }
+  if(ops <= 0 || maxthreads < 1){
+    printf("could not set up the benchmark\n");
+    return(1);
+  }
+  for(i = 0; i < 2 * MAXLENGTH; i++){
+    items[i] = i;
+  }
+  srand(63);
+
+  printf("structure,op,threads,length,ops,ops_per_sec,p50_ns,p99_ns,max_ns\n");
+  for(l = 0; l < NLENGTHS; l++){
+    bench_queue(ops, lengths[l]);
+  }
+  for(l = 0; l < NCONTENDED; l++){
+    for(t = 1; t <= maxthreads; t *= 2){
+      bench_lqueue(ops, t, contended[l], 0);
+      bench_lqueue(ops, t, contended[l], 1);
+    }
+  }
+  return(0);
+}
@@ -22,6 +22,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#include "pool.h"
 
 
 typedef struct QueueNode {
@@ -36,6 +39,23 @@ typedef struct {
   QueueNode *tail;
 } queue_t;
 
+/* every queue's nodes come from one shared pool */
+static pool_t *node_pool;
+static pthread_once_t node_pool_once = PTHREAD_ONCE_INIT;
+
+static void open_node_pool(void){
+  node_pool = pool_open("queuenode", sizeof(QueueNode));
+}
+
+/* allocate a node from the pool */
+static QueueNode *new_node(void){
+  pthread_once(&node_pool_once, open_node_pool);
+  if(!node_pool){
+    return NULL;
+  }
+  return (QueueNode *)pool_get(node_pool);
+}
+
 /*
  * Function:  qopen()
  * --------------------
@@ -75,7 +95,7 @@ if(qp->head){
       QueueNode *next_node;
       next_node = curr_node->next;
       temp_node = curr_node;
-      free(temp_node);
+      pool_put(node_pool, temp_node);
       curr_node = next_node;
     }
 	}
@@ -95,12 +115,14 @@ if(qp->head){
  */
 int qput(queue_t *qp, void *elementp){
   QueueNode *node;
-  node = (QueueNode*)malloc(sizeof(QueueNode));
-
 
 	if (!elementp || !qp){
 		return -1;
 	}
+  node = new_node();
+	if (!node){
+		return -1;
+	}
 	node->next = NULL;
 	node->data = elementp;
 
@@ -112,7 +134,6 @@ int qput(queue_t *qp, void *elementp){
   }
   /* if the queue is not empty, place the item in the rear of the queue */
   else{
-		printf("here\n");
     qp->tail->next = node;
 		qp->tail = node;
   }
@@ -138,10 +159,16 @@ void* qget(queue_t *qp){
   }
   else{
     /*create another node to hold onto the old head */
+    void *data;
     temp_node = qp->head;
 		qp->head = temp_node->next;
+		if(qp->head == NULL){
+			qp->tail = NULL;
+		}
 
-    return temp_node->data;
+    data = temp_node->data;
+    pool_put(node_pool, temp_node);
+    return data;
   }
 }
 
@@ -229,6 +256,7 @@ void* qremove(queue_t *qp,
 	      const void* skeyp){
     QueueNode *prev_node;
     QueueNode *curr_node;
+    void *data;
 
 		if(!qp || !qp->head){
 			return NULL;
@@ -252,8 +280,13 @@ void* qremove(queue_t *qp,
 				}else{
 					/* if this is the head node */
 					qp->head = curr_node->next;
+					if(qp->head == NULL){
+						qp->tail = NULL;
+					}
 				}
-				return curr_node->data;
+				data = curr_node->data;
+				pool_put(node_pool, curr_node);
+				return data;
 			}
 
 			prev_node = curr_node;
@@ -276,14 +309,17 @@ void* qremove(queue_t *qp,
  *  returns: NULL, the original q1p will now contain q2p on it's end
  */
 void qconcat(queue_t *q1p, queue_t *q2p){
-  if((q1p->tail == NULL) && (q2p->head == NULL)){
+  if(q2p->head == NULL){
+    /* nothing to move */
+  }
+  else if(q1p->head == NULL){
       q1p->head = q2p->head;
       q1p->tail = q2p->tail;
-      free(q2p);
     }
   else{
     q1p->tail->next = q2p->head;
-    q2p->head = q2p->tail = NULL;
-    free(q2p);
+    q1p->tail = q2p->tail;
   }
+  q2p->head = q2p->tail = NULL;
+  free(q2p);
 }
@@ -0,0 +1,288 @@
+/*=============================================================================
+|   Title: room.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a directory of chat rooms, see room.h
+|
+|  joining locks the room's stripe to find or create the room, then takes the
+|  room's own lock before letting go of the stripe, so a room cannot be
+|  removed between being found and being joined, the last member to leave
+|  drops the room's lock, takes the stripe and the room's lock again and
+|  only removes the room if nobody joined in between
+|
+|  a room's history rings are read by copying the newest lines out of every
+|  shard's ring and sorting them by the sequence they were recorded with
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "hash.h"
+#include "msgbuf.h"
+#include "history.h"
+#include "arena.h"
+#include "room.h"
+
+/* number of mutexes shared out over the directory's slots */
+#define ROOMSTRIPES 64
+
+struct roomdir_t{
+  hashtable_t *rooms;
+  int nshards;
+  pthread_mutex_t stripes[ROOMSTRIPES];
+  /* every room, published for listing without a lock */
+  snapset_t *all;
+};
+
+/* comparator for the directory, the key is the room name */
+static int find_room(void *elementp, const void *keyp){
+  return strcmp(((Room *)elementp)->name, (const char *)keyp) == 0;
+}
+
+/* the stripe guarding the slot a room name hashes to */
+static pthread_mutex_t *stripe_of(roomdir_t *dir, const char *name){
+  return &dir->stripes[hslot(dir->rooms, name, strlen(name)) % ROOMSTRIPES];
+}
+
+/* free a room once no snapshot can reach it */
+static void free_room(void *arg){
+  Room *room = (Room *)arg;
+  int i;
+
+  for(i = 0; i < room->nshards; i++){
+    snapset_close(room->members[i]);
+    if(room->history[i]){
+      history_close(room->history[i]);
+    }
+  }
+  pthread_mutex_destroy(&room->lock);
+  free(room);
+}
+
+/* create an empty directory */
+roomdir_t *roomdir_open(uint32_t slots, int nshards){
+  roomdir_t *dir = (roomdir_t *)malloc(sizeof(roomdir_t));
+  int i;
+
+  if(!dir){
+    return NULL;
+  }
+  dir->nshards = nshards;
+  dir->rooms = hopen(slots);
+  dir->all = snapset_open();
+  if(!dir->rooms || !dir->all){
+    if(dir->rooms){
+      hclose(dir->rooms);
+    }
+    if(dir->all){
+      snapset_close(dir->all);
+    }
+    free(dir);
+    return NULL;
+  }
+  for(i = 0; i < ROOMSTRIPES; i++){
+    pthread_mutex_init(&dir->stripes[i], NULL);
+  }
+  return dir;
+}
+
+/* make a new empty room, the stripe is held */
+static Room *new_room(roomdir_t *dir, const char *name){
+  Room *room = (Room *)calloc(1, sizeof(Room));
+
+  if(!room){
+    return NULL;
+  }
+  strcpy(room->name, name);
+  pthread_mutex_init(&room->lock, NULL);
+  for(room->nshards = 0; room->nshards < dir->nshards; room->nshards++){
+    room->members[room->nshards] = snapset_open();
+    if(!room->members[room->nshards]){
+      free_room(room);
+      return NULL;
+    }
+  }
+  if(hput(dir->rooms, room, room->name, strlen(room->name)) < 0){
+    free_room(room);
+    return NULL;
+  }
+  snapset_add(dir->all, room);
+  return room;
+}
+
+/* add a member to the named room, creating it if needed */
+Room *room_join(roomdir_t *dir, const char *name, void *member, int shard){
+  pthread_mutex_t *stripe;
+  Room *room;
+
+  if(strlen(name) == 0 || strlen(name) >= ROOMNAMELENGTH){
+    return NULL;
+  }
+  stripe = stripe_of(dir, name);
+  pthread_mutex_lock(stripe);
+  room = (Room *)hsearch(dir->rooms, find_room, name, strlen(name));
+  if(!room){
+    room = new_room(dir, name);
+  }
+  if(!room){
+    pthread_mutex_unlock(stripe);
+    return NULL;
+  }
+  pthread_mutex_lock(&room->lock);
+  pthread_mutex_unlock(stripe);
+
+  if(snapset_add(room->members[shard], member) < 0){
+    room = NULL;
+  }else{
+    room->count++;
+  }
+  pthread_mutex_unlock(&room->lock);
+  return room;
+}
+
+/* remove a member, removing the room with its last member */
+int room_leave(roomdir_t *dir, Room *room, void *member, int shard){
+  pthread_mutex_t *stripe = stripe_of(dir, room->name);
+  int empty;
+
+  pthread_mutex_lock(&room->lock);
+  if(snapset_remove(room->members[shard], member) != 0){
+    pthread_mutex_unlock(&room->lock);
+    return -1;
+  }
+  room->count--;
+  empty = room->count == 0;
+  pthread_mutex_unlock(&room->lock);
+  if(!empty){
+    return 0;
+  }
+
+  /* take the locks in order and check nobody joined in the meantime */
+  pthread_mutex_lock(stripe);
+  pthread_mutex_lock(&room->lock);
+  if(room->count == 0 && !room->dead){
+    room->dead = 1;
+    hremove(dir->rooms, find_room, room->name, strlen(room->name));
+    snapset_remove(dir->all, room);
+  }else{
+    empty = 0;
+  }
+  pthread_mutex_unlock(&room->lock);
+  pthread_mutex_unlock(stripe);
+
+  if(empty){
+    snap_defer(free_room, room);
+  }
+  return 0;
+}
+
+/* find a room by name, it is freed only after a quiescent state */
+Room *room_find(roomdir_t *dir, const char *name){
+  pthread_mutex_t *stripe = stripe_of(dir, name);
+  Room *room;
+
+  pthread_mutex_lock(stripe);
+  room = (Room *)hsearch(dir->rooms, find_room, name, strlen(name));
+  pthread_mutex_unlock(stripe);
+  return room;
+}
+
+/* remember a line, from the thread serving the shard */
+void room_record(Room *room, int shard, msgbuf_t *mb){
+  history_t *h = room->history[shard];
+
+  if(!h){
+    if(!(h = history_open(ROOMHISTORY, ROOMHISTORYBYTES))){
+      return;
+    }
+    __atomic_store_n(&room->history[shard], h, __ATOMIC_RELEASE);
+  }
+  history_record(h, __atomic_add_fetch(&room->seq, 1, __ATOMIC_RELAXED),
+                 mb->data, mb->len);
+}
+
+/* a line kept for a history reply, with when it was recorded */
+typedef struct history_line_t{
+  unsigned long seq;
+  msgbuf_t *mb;
+} history_line_t;
+
+/* comparator for sorting history by when it was recorded */
+static int by_seq(const void *a, const void *b){
+  unsigned long sa = ((const history_line_t *)a)->seq;
+  unsigned long sb = ((const history_line_t *)b)->seq;
+
+  return sa < sb ? -1 : sa > sb;
+}
+
+/* the newest n lines of every shard's history, one frame each, the shards
+are read one at a time through the same scratch buffer */
+int room_history(Room *room, size_t n, msgbuf_t **frames, arena_t *scratch){
+  history_item_t items[ROOMHISTORY];
+  history_line_t lines[ROOMHISTORY];
+  history_t *ring;
+  msgbuf_t *mb;
+  char *buf = NULL;
+  size_t kept = 0, got, oldest, i, j;
+  int s;
+
+  if(n > ROOMHISTORY){
+    n = ROOMHISTORY;
+  }
+  for(s = 0; s < room->nshards && n > 0; s++){
+    if(!(ring = __atomic_load_n(&room->history[s], __ATOMIC_ACQUIRE))){
+      continue;
+    }
+    if(!buf && !(buf = (char *)arena_alloc(scratch, ROOMHISTORYBYTES))){
+      break;
+    }
+    got = history_read(ring, n, items, buf, ROOMHISTORYBYTES);
+    /* newest first, so once the kept lines are all newer than one of this
+    shard's, they are newer than the rest of its lines too */
+    for(j = got; j > 0; j--){
+      oldest = 0;
+      if(kept == n){
+        for(i = 1; i < kept; i++){
+          if(lines[i].seq < lines[oldest].seq){
+            oldest = i;
+          }
+        }
+        if(items[j - 1].seq < lines[oldest].seq){
+          break;
+        }
+      }
+      if(!(mb = msgbuf_alloc(items[j - 1].len))){
+        break;
+      }
+      memcpy(mb->data, items[j - 1].data, items[j - 1].len);
+      if(kept == n){
+        msgbuf_release(lines[oldest].mb);
+      }else{
+        oldest = kept++;
+      }
+      lines[oldest].seq = items[j - 1].seq;
+      lines[oldest].mb = mb;
+    }
+  }
+  qsort(lines, kept, sizeof(history_line_t), by_seq);
+  for(i = 0; i < kept; i++){
+    frames[i] = lines[i].mb;
+  }
+  return (int)kept;
+}
+
+/* a snapshot of every room */
+snapshot_t *roomdir_rooms(roomdir_t *dir){
+  return snapset_acquire(dir->all);
+}
@@ -0,0 +1,177 @@
+/*=============================================================================
+|   Title: room.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a directory of chat rooms, each room owns its own
+|  member set and lock, so conversations in different rooms never contend
+|  with each other, a room's members are split into shards, one per event
+|  loop thread, so each thread walks only the members it serves
+|
+|  the directory is a hash table of rooms sharded over striped mutexes, a
+|  room is created by the first member to join it and removed when its last
+|  member leaves, the room itself is freed once no snapshot can reach it
+|
+|  each room remembers its recent lines for members who join later, in one
+|  history ring per shard so every ring has a single writer, the thread that
+|  serves the shard, and recording a line takes no lock
+|
+|  lock order: a directory stripe, then a room's lock
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* room.h -- public interface to the chat room module
+*/
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "snapshot.h"
+#include "msgbuf.h"
+#include "history.h"
+#include "arena.h"
+
+#define ROOMNAMELENGTH 32
+/* most shards a room's members can be split over */
+#define MAXSHARDS 64
+/* lines and bytes of history each shard of a room remembers */
+#define ROOMHISTORY 100
+#define ROOMHISTORYBYTES (64 * 1024)
+
+typedef struct Room{
+  char name[ROOMNAMELENGTH];
+  /* members published as snapshots, one set per shard, walked without a
+  lock to send to everyone in the room */
+  snapset_t *members[MAXSHARDS];
+  int nshards;
+  /* guards count and dead, serializes joins and leaves of this room */
+  pthread_mutex_t lock;
+  int count;
+  /* TRUE once the room has been taken out of the directory */
+  int dead;
+  /* recent lines sent from each shard, made when the shard first records */
+  history_t *history[MAXSHARDS];
+  /* orders lines recorded on different shards */
+  unsigned long seq;
+} Room;
+
+/* the directory representation is hidden from users of the module */
+typedef struct roomdir_t roomdir_t;
+
+/*
+* Function:  roomdir_open()
+* --------------------
+* create an empty room directory
+*
+* paramaters:
+*  uint32_t slots: the number of hash slots in the directory
+*  int nshards: the number of shards each room's members are split over,
+*        at most MAXSHARDS
+*
+*  returns: roomdir_t*, the directory, NULL if out of memory
+*/
+roomdir_t *roomdir_open(uint32_t slots, int nshards);
+
+/*
+* Function:  room_join()
+* --------------------
+* adds a member to the named room, creating the room if it does not exist
+*
+* paramaters:
+*  roomdir_t *dir: the directory
+*  const char *name: the room's name, shorter than ROOMNAMELENGTH
+*  void *member: the member to add, must not already be in the room
+*  int shard: the shard to add the member to
+*
+*  returns: Room*, the room joined, NULL if not successful
+*/
+Room *room_join(roomdir_t *dir, const char *name, void *member, int shard);
+
+/*
+* Function:  room_leave()
+* --------------------
+* removes a member from a room, the room is taken out of the directory when
+* its last member leaves and must not be used by the caller afterwards
+*
+* paramaters:
+*  roomdir_t *dir: the directory
+*  Room *room: a room the member joined
+*  void *member: the member to remove
+*  int shard: the shard the member was added to
+*
+*  returns: 0 if removed, -1 if not successful
+*/
+int room_leave(roomdir_t *dir, Room *room, void *member, int shard);
+
+/*
+* Function:  room_find()
+* --------------------
+* finds a room by name without joining it, the room stays valid until the
+* calling snapshot reader's next quiescent state, but may already have been
+* taken out of the directory
+*
+* paramaters:
+*  roomdir_t *dir: the directory
+*  const char *name: the room's name
+*
+*  returns: Room*, the room, NULL if there is no room with that name
+*/
+Room *room_find(roomdir_t *dir, const char *name);
+
+/*
+* Function:  room_record()
+* --------------------
+* remembers a line sent to a room, only the thread serving the shard may
+* record into it
+*
+* paramaters:
+*  Room *room: the room the line was sent to
+*  int shard: the sender's shard
+*  msgbuf_t *mb: the framed line, copied
+*
+*  returns: NULL
+*/
+void room_record(Room *room, int shard, msgbuf_t *mb);
+
+/*
+* Function:  room_history()
+* --------------------
+* copies the newest lines recorded in a room, from every shard, into one frame
+* each, in the order they were recorded, safe to call while lines are being
+* recorded, the rings are read one at a time through one ROOMHISTORYBYTES
+* buffer of scratch memory, the frames themselves come from the message
+* pools
+*
+* paramaters:
+*  Room *room: the room
+*  size_t n: the most lines to gather, at most ROOMHISTORY are
+*  msgbuf_t **frames: filled with the frames, each holding one reference,
+*        room for ROOMHISTORY
+*  arena_t *scratch: the calling thread's arena, valid until it is reset
+*
+*  returns: int, the number of frames, 0 if the room has no history or out
+*          of memory
+*/
+int room_history(Room *room, size_t n, msgbuf_t **frames, arena_t *scratch);
+
+/*
+* Function:  roomdir_rooms()
+* --------------------
+* takes a reference to a snapshot of every room in the directory, the rooms
+* in it stay valid until the snapshot is released
+*
+* paramaters:
+*  roomdir_t *dir: the directory
+*
+*  returns: snapshot_t*, items are Room*, give it back with snapshot_release()
+*/
+snapshot_t *roomdir_rooms(roomdir_t *dir);
@@ -11,389 +11,2927 @@
  +-----------------------------------------------------------------------------
  |
  |  Description:  A TCP server which takes in multiple clients and allows them
- |              to talk like a chat room.  Every client that it accepts becomes
- |              a new thread within the server.  This can be run on a different
+ |              to talk in chat rooms.  The server runs one reactor thread per
+ |              core, each with its own SO_REUSEPORT listening socket, epoll
+ |              instance and set of clients.  Every client a reactor accepts
+ |              is made non-blocking and registered with its edge-triggered
+ |              event loop, which reads the client's messages incrementally
+ |              and answers them as they complete.  Messages for clients of
+ |              another reactor are posted to that reactor's mailbox.  This
+ |              can be run on a different
  |              ip address than the clients, you can discover the ip address of
  |            the server by logging into it and then cat’ing the
  |            file /etc/network/interfaces
  |
- |        Input:  ./server [PORT_NUM]
- |              Takes in a port number to run the server
+ |        Input:  ./server [-r REACTORS] [-b BACKLOG] [-a ADMIN_SOCKET]
+ |                       [-d DELAY_US] [-c COALESCE_BYTES] [-q HIGH_BYTES]
+ |                       [-n HIGH_MSGS] [-p POLICY] [-l LOG_DIR]
+ |                       [-f SYNC_MS] [-i BACKEND] [-w HELLO_S]
+ |                       [-k KEEPALIVE_S] [-t IDLE_S] [-m MSGS_S[,BURST]]
+ |                       [-B BYTES_S[,BURST]] [-N NODE_ID]
+ |                       [-P LINK_PORT] [-A LINK_ADDR] [-S SECRET_FILE]
+ |                       [-T PEER_IP]... [-L IP:LINK_PORT]... [PORT_NUM]
+ |              Takes in a port number to run the server, optionally the
+ |              number of reactor threads (one per core by default), the
+ |              listen backlog of each reactor, the path of the unix
+ |              socket that serves the live counters, the longest a reply
+ |              may wait to be written together with later ones (0, the
+ |              default, writes at the end of each event loop pass) and the
+ |              pending bytes that get a client written to right away, and
+ |              how many bytes and messages a client may fall behind by
+ |              before POLICY (disconnect, oldest or newest) is applied,
+ |              and a directory to keep a durable log of every chat line in
+ |              with how often it is synced to disk, whether the
+ |              reactors wait on epoll (the default) or io_uring, and how
+ |              long a client may take to give its name (10 seconds by
+ |              default), stay silent before it is pinged and dropped if
+ |              it does not answer (30 seconds) and go without chatting
+ |              (no limit), 0 turns any of them off, how many lines and
+ |              bytes a client may send per second and in one burst (no
+ |              limit by default), lines over it are dropped with a notice,
+ |              and to link with
+ |              other servers, this server's node id (the link port by
+ |              default), the port they link to and the address it is
+ |              bound to (127.0.0.1 by default), a file holding the secret
+ |              every linked server's hello must carry, the addresses links
+ |              are taken from without one and the servers to link to
  |
  |       Output:  prints information on the server running, to end the server just control C
  |
  *===========================================================================*/
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 
 #include "queue.h"
 #include "lqueue.h"
+#include "hash.h"
+#include "lhash.h"
+#include "outbuf.h"
+#include "pool.h"
+#include "snapshot.h"
+#include "room.h"
+#include "stats.h"
+#include "chatlog.h"
+#include "uring.h"
+#include "wheel.h"
+#include "federation.h"
+#include "arena.h"
+#include "protocol.h"
 
 
 
 #define NAMELENGTH 100
 #define BUFFERSIZE 2048
 #define ADDRLENGTH 50
-#define LISTENQ 8
-#define MAXPEOPLE 1000
-#define SWITCHCOUNT 4
-#define PING 0
-#define JOIN 1
-#define LEAVE 2
-#define WHO 3
-
-/* message passed to server with the user name inside */
+/* longest secret linked servers share, the link module takes up to 255
+bytes */
+#define SECRETLENGTH 256
+/* default listen backlog of each reactor, deep enough that a reconnect
+storm is queued rather than refused */
+#define LISTENQ 4096
+/* most reactor threads, each is a snapshot reader and a room shard */
+#define MAXREACTORS 32
+#define MAXEVENTS 256
+/* bytes pulled off a socket per recv() call */
+#define READSIZE 16384
+/* longest chat line accepted, leaves room for "[room] name: " in a BUFFERSIZE
+reply */
+#define MAXLINE PROTO_MAXLINE
+#if MAXLINE > BUFFERSIZE - NAMELENGTH - ROOMNAMELENGTH - 5
+#error "PROTO_MAXLINE leaves no room for the name and room in a reply"
+#endif
+/* default high-water marks, the most reply bytes and messages a client may
+fall behind by before the slow client policy is applied */
+#define MAXPENDING (256 * 1024)
+#define MAXPENDINGMSGS 4096
+/* what happens to a message for a client past a high-water mark */
+#define POLICY_DISCONNECT 0
+#define POLICY_DROP_OLDEST 1
+#define POLICY_DROP_NEWEST 2
+/* slots the user name index starts with, it doubles as users arrive so
+chains stay about one entry long and the slots only as big as they need */
+#define USERSLOTS 1024
+/* slots in the room directory */
+#define ROOMSLOTS 4096
+/* most rooms one user can be in at a time */
+#define MAXUSERROOMS 16
+/* the room a bare /join puts a user in, its lines are sent without a tag */
+#define DEFAULTROOM "lobby"
+/* pending bytes that get a client written to without waiting for the end of
+the event loop pass */
+#define COALESCEBYTES (16 * 1024)
+/* bytes of counters sent back for /stats */
+#define STATSSIZE 8192
+/* bytes in the first block of each reactor's scratch arena */
+#define SCRATCHSIZE (64 * 1024)
+/* default longest a logged line waits to be synced to disk */
+#define LOGSYNCMS 50
+/* lines of a room's history replayed to a user who joins it */
+#define JOINHISTORY 20
+/* names sent back in one page of /who */
+#define WHOPAGE 200
+/* io_uring operations a reactor queues at once, and the buffers receives
+are made into */
+#define URINGENTRIES 1024
+#define URINGBUFS 256
+#define URINGBUFSIZE 4096
+/* most queued messages one io_uring send gathers, a connection only has
+one send in flight, so it takes more than a sendmsg() on epoll would */
+#define URINGMAXIOV 256
+/* io_uring completions taken off the ring but not yet handled */
+#define URINGBACKLOG 1024
+/* io_uring completions for the listening socket and wakeup carry these,
+a connection's carry its address with the low bits saying which of its
+operations completed */
+#define UD_ACCEPT 1
+#define UD_WAKE 2
+#define UD_RECV 1
+#define UD_SEND 2
+#define UD_TAGS 3
+/* milliseconds per tick of a reactor's timer wheel, timers fire at most
+this late */
+#define TIMERTICKMS 10
+/* default longest a new client may take to send its screen name, and how
+long a client may be silent before it is pinged and before it is dropped
+for not answering */
+#define HANDSHAKEMS 10000
+#define KEEPALIVEMS 30000
+/* slots in the command table, and the longest command name */
+#define COMMANDSLOTS 64
+#define COMMANDLENGTH 16
+
+/* a decoded chat line together with the name of the user who sent it, and
+the arena of the reactor handling it, for anything that need not outlive it */
 typedef struct Message{
-   char buffer[BUFFERSIZE];
-   char user_id[NAMELENGTH];
+   char *buffer;
+   size_t length;
+   char *user_id;
+   arena_t *scratch;
 }Message;
 
-/* Struct to pass the socket information to the server thread*/
-typedef struct Connection{
-  int csocket;
-}Connection;
+struct Connection;
+struct Reactor;
+
+/* a sendmsg() handed to io_uring, it has to stay put until it completes */
+typedef struct SendOp{
+  struct msghdr msg;
+  struct iovec iov[URINGMAXIOV];
+} SendOp;
 
 /* ChatUser struct which contains information to send messages back
 this information stored in the queue of users*/
 typedef struct ChatUser{
   char name[NAMELENGTH];
   int usocket;
+  struct Connection *conn;
+  /* TRUE once the name is taken in the user index */
+  int registered;
+  /* the rooms the user is in, lines they type go to the active one */
+  Room *rooms[MAXUSERROOMS];
+  int nrooms;
+  Room *active;
+  /* messages the slow client policy dropped instead of sending, only
+  written by the owning reactor */
+  unsigned long dropped;
 } ChatUser;
 
-/* queue of users currently "joined" in the chatroom */
-lqueue_t *myqueue;
-/* message to send to all users */
-char public_message_tosend[BUFFERSIZE];
-int sockfd;
-/* person sending the current message */
-char curr_sender[NAMELENGTH];
-/* socket of the person sending the current message */
-int curr_sender_socket;
+/* per-socket state owned by the event loop, frames are decoded piece by
+piece as bytes arrive and handled once they are complete, replies wait in
+outbuf until the socket can take them */
+typedef struct Connection{
+  int csocket;
+  /* the reactor thread that owns the connection, only it touches the
+  socket and outbuf */
+  struct Reactor *reactor;
+  proto_decoder_t decoder;
+  outbuf_t outbuf;
+  ChatUser *chat_user;
+  /* set once the connection is waiting to be closed by the event loop */
+  int closing;
+  struct Connection *next_closing;
+  /* set while queued replies wait on the reactor's dirty list */
+  int dirty;
+  /* when the oldest of those replies was queued, if there is a delay */
+  unsigned long dirty_since;
+  struct Connection *next_dirty;
+  /* set while the socket is full, writing then waits for EPOLLOUT, or on
+  io_uring while a send is in flight, writing then waits for it */
+  int blocked;
+  /* io_uring operations that still point at the connection, the send and
+  the receive, it is only released once they have all completed */
+  SendOp *send_op;
+  int inflight;
+  /* set once close_connection() has taken it out of its rooms */
+  int closed;
+  /* the connection's one timer, for the handshake deadline, keepalive
+  pings and the idle timeout, it is only moved when it fires */
+  wheel_timer_t timer;
+  unsigned long accepted_ms;
+  /* when anything, and when a chat line, last arrived, and whether a ping
+  has gone unanswered since */
+  unsigned long heard_ms;
+  unsigned long chat_ms;
+  int pinged;
+  /* the connection's token buckets, a line takes one message token and a
+  byte token per byte, both refill at their rate up to their burst, and
+  whether lines are being dropped for running them dry */
+  double msg_tokens;
+  double byte_tokens;
+  unsigned long refill_ms;
+  int throttled;
+}Connection;
+
+/* an io_uring completion taken off the ring */
+typedef struct Completion{
+  unsigned long data;
+  int res;
+  unsigned flags;
+} Completion;
+
+/* a broadcast handed to another reactor, sent to the members in snap, or
+with no snap a direct message for the user named in to */
+typedef struct Mail{
+  snapshot_t *snap;
+  msgbuf_t *mb;
+  char to[NAMELENGTH];
+} Mail;
+
+/* a command a user can type, the handler fills in the reply to send back,
+an empty reply sends nothing */
+typedef struct Command{
+  char name[COMMANDLENGTH];
+  void (*fn)(Message *message, ChatUser *chat_user, char *sendback);
+} Command;
 
+/* one event loop thread, with its own listening socket and clients */
+typedef struct Reactor{
+  int id;
+  pthread_t thread;
+  int listenfd;
+  int epollfd;
+  /* eventfd written to wake the reactor when mail is posted */
+  int wakefd;
+  lqueue_t *mailbox;
+  /* TRUE while a wakeup is outstanding, saves a write per posted mail */
+  int wake_pending;
+  /* connections to close once the current batch of events is handled */
+  struct Connection *closing_list;
+  /* connections with replies to write once the current batch is handled */
+  struct Connection *dirty_list;
+  snap_reader_t *reader;
+  /* the reactor's io_uring, NULL when it waits on epoll, and the
+  completions taken off it that wait to be handled, in order */
+  uring_t *ring;
+  Completion *backlog;
+  int backlog_first;
+  int backlog_count;
+  /* the reactor's connection timers, and the time at the start of the
+  current event loop pass in milliseconds */
+  wheel_t *timers;
+  unsigned long now_ms;
+  /* scratch memory for the message being handled, reset after each one */
+  arena_t *scratch;
+} Reactor;
 
+/* every named user on the server, indexed by name */
+lhashtable_t *users;
+/* the commands, indexed by name, only written before the reactors start */
+hashtable_t *commands;
+/* the chat rooms, each with its own members and lock */
+roomdir_t *rooms;
+Reactor reactors[MAXREACTORS];
+int nreactors;
+/* slabs that connection state is allocated from */
+pool_t *conn_pool;
+pool_t *user_pool;
+pool_t *mail_pool;
+pool_t *send_pool;
+/* set by SIGUSR1, the event loop then prints the pool counters */
+volatile sig_atomic_t report_requested;
+/* how long and how many bytes replies may be held back to be written in one
+sendmsg() */
+unsigned long coalesce_delay_ns;
+size_t coalesce_bytes = COALESCEBYTES;
+/* the high-water marks and what is done to a client that passes one */
+size_t highwater_bytes = MAXPENDING;
+size_t highwater_msgs = MAXPENDINGMSGS;
+int slow_policy = POLICY_DISCONNECT;
+/* the durable log of chat lines, NULL unless a directory was given */
+chatlog_t *chat_log;
+/* TRUE if the reactors do their socket I/O through io_uring */
+int use_uring;
+/* the connection timeouts in milliseconds, 0 turns one off */
+unsigned long handshake_ms = HANDSHAKEMS;
+unsigned long keepalive_ms = KEEPALIVEMS;
+unsigned long idle_ms;
+/* how many lines and bytes a client may send per second, and how many it
+may send at once after a quiet spell, a rate of 0 is no limit */
+double rate_msgs;
+double burst_msgs;
+double rate_bytes;
+double burst_bytes;
+/* the keepalive frame, shared by every connection it is sent to */
+msgbuf_t *ping_frame;
+/* the links to the other servers, NULL unless a link port was given, the
+link thread records lines from them in a room shard of its own */
+fed_t *federation;
+int link_shard;
+
+/* conn_send() needs it before the io_uring event loop is defined */
+int uring_push(Connection *conn);
+
+/* the server is linked with malloc(), calloc() and realloc() wrapped, so
+every heap allocation its own code makes is counted on the way through */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_malloc(size);
+}
 
+void *__wrap_calloc(size_t nmemb, size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_calloc(nmemb, size);
+}
 
-void print(void* elementp){
-  ChatUser *c = (ChatUser*) elementp;
-  printf("printq: %s\n", c->name);
+void *__wrap_realloc(void *ptr, size_t size){
+  stats_add(STAT_HEAP_ALLOCS, 1);
+  return __real_realloc(ptr, size);
 }
 
+
+
+
 /*
- * Function:  find_user()
+ * Function:  shutdown_connection()
  * --------------------
- * comparator method to be passed into lqsearch() and lqremove() to
- * compare if two chatusers are the same person, since each username is
- * unique they can compare names
+ * marks a connection to be closed by the event loop once the current batch of
+ * events is handled, so a connection is never freed while the user queue is
+ * being walked or while its frames are being decoded
  *
  * paramaters:
- *  void* elementp: the element to see if it is the same element
- *  const void* id: the element to find
+ *  Connection *conn: the connection to close
  *
- *  returns: 0 if user not found, 1 if user found
+ *  returns: NULL
  */
-int find_user(void* elementp, const void* id){
-  ChatUser *curr_user = (ChatUser *)elementp;
-  ChatUser *search_user = (ChatUser *) id;
+void shutdown_connection(Connection *conn){
+  if(!conn->closing){
+    conn->closing = TRUE;
+    conn->next_closing = conn->reactor->closing_list;
+    conn->reactor->closing_list = conn;
+  }
+}
 
-  if(strcmp(curr_user->name, search_user->name) == 0){
-    return TRUE;
-  }else{
-    return FALSE;
+/*
+ * Function:  start_send()
+ * --------------------
+ * hands a connection's oldest queued replies to io_uring as one sendmsg(),
+ * which is submitted together with every other send of the event loop
+ * pass, the replies stay queued until it completes
+ *
+ * paramaters:
+ *  Connection *conn: the connection to write to, with no send in flight
+ *
+ *  returns: 1 if the send was queued, -1 if not successful
+ */
+int start_send(Connection *conn){
+  SendOp *op = (SendOp *)pool_get(send_pool);
+
+  if(!op){
+    return -1;
+  }
+  memset(&op->msg, 0, sizeof(op->msg));
+  op->msg.msg_iov = op->iov;
+  op->msg.msg_iovlen = outbuf_iov(&conn->outbuf, op->iov, URINGMAXIOV);
+  if(uring_sendmsg(conn->reactor->ring, conn->csocket, &op->msg,
+                   (unsigned long)conn | UD_SEND) < 0){
+    outbuf_consume(&conn->outbuf, 0);
+    pool_put(send_pool, op);
+    return -1;
   }
+  conn->send_op = op;
+  conn->inflight++;
+  return 1;
 }
 
 /*
- * Function:  send_message_toall()
+ * Function:  flush_connection()
  * --------------------
- * method to be applied to each every in the queue using lqapply() which
- * sends the current message out to all users, unless it is the user sending
- * the message
+ * writes as much of a connection's queued replies as the socket will take,
+ * gathered into as few sendmsg() calls as possible, on io_uring the write
+ * is only started
  *
  * paramaters:
- *  void* elementp: the element containing the user to send the message to
+ *  Connection *conn: the connection to write to
  *
  *  returns: NULL
  */
-void send_message_toall(void* elementp){
-  int reclen;
-  ChatUser *curr_user = (ChatUser*) elementp;
+void flush_connection(Connection *conn){
+  int n;
 
-  if(strcmp(curr_user->name, curr_sender) != 0){
-    reclen = send(curr_user->usocket, public_message_tosend, BUFFERSIZE, 0);
+  if(conn->closing || outbuf_pending(&conn->outbuf) == 0){
+    return;
+  }
+  stats_add(STAT_FLUSHES, 1);
+  if(conn->reactor->ring){
+    n = start_send(conn);
+  }else{
+    n = outbuf_flush(&conn->outbuf, conn->csocket);
   }
-  if (reclen < 0) {
-    perror("ERROR in sendto");
+  if(n < 0){
+    stats_add(STAT_SEND_ERRORS, 1);
+    shutdown_connection(conn);
+  }else{
+    conn->blocked = n > 0;
   }
 }
 
 /*
- * Function:  send_user_in_room()
+ * Function:  disconnect_slow()
  * --------------------
- * method to be applied to each every in the queue using lqapply() which
- * sends the current user's name back to the user who requested it using the
- * '/who' request.  It only sends the list of users to the user who requested it
+ * disconnects a client that fell past a high-water mark, the messages not
+ * yet started are thrown away to make room for a last line telling the
+ * client why, which is written if the socket will take it
  *
  * paramaters:
- *  void* elementp: the element containing the user name to send
+ *  Connection *conn: the connection to close
+ *  const char *reason: why, sent to the client
  *
  *  returns: NULL
  */
-void send_user_in_room(void *elementp){
-  int reclen;
-  char user_tosend[BUFFERSIZE];
-  ChatUser *curr_user = (ChatUser*) elementp;
+void disconnect_slow(Connection *conn, const char *reason){
+  char line[BUFFERSIZE];
+  msgbuf_t *mb;
 
-  if(strcmp(curr_user->name, curr_sender) != 0){
-    strcpy(user_tosend, curr_user->name);
-    strcat(user_tosend, "\n");
-    reclen = send(curr_sender_socket, user_tosend, BUFFERSIZE, 0);
+  stats_add(STAT_SLOW_DROPS, 1);
+  while(outbuf_drop_oldest(&conn->outbuf) > 0){
   }
-  if (reclen < 0) {
-    perror("ERROR in sendto");
+  sprintf(line, "SERVER: disconnected, %s\n", reason);
+  mb = msgbuf_frame(OP_TEXT, 0, NULL, 0, line, strlen(line));
+  /* a send in flight still owns the head of the queue */
+  if(mb && outbuf_queue(&conn->outbuf, mb) == 0 && !conn->blocked){
+    outbuf_flush(&conn->outbuf, conn->csocket);
   }
-
+  msgbuf_release(mb);
+  shutdown_connection(conn);
 }
 
+/*
+ * Function:  drop_message()
+ * --------------------
+ * counts a message the slow client policy did not send, against the server
+ * and against the user it was meant for
+ *
+ * paramaters:
+ *  Connection *conn: the connection it was meant for
+ *
+ *  returns: NULL
+ */
+void drop_message(Connection *conn){
+  ChatUser *chat_user = conn->chat_user;
+
+  stats_add(STAT_MSGS_DROPPED, 1);
+  /* other reactors read the count for /who */
+  __atomic_store_n(&chat_user->dropped, chat_user->dropped + 1,
+                   __ATOMIC_RELAXED);
+}
 
 /*
- * Function:  combine_return_message()
+ * Function:  conn_send()
  * --------------------
- * helper method to synthesize the user's message with their user name
+ * queues bytes for a client without ever blocking, the connection is put on
+ * its reactor's dirty list and everything queued for it during the current
+ * batch of events is written together once the batch is handled, or
+ * straight away once more than coalesce_bytes are waiting, bytes the socket
+ * does not take are written when epoll reports it writable, once a client
+ * falls highwater_bytes or highwater_msgs behind, slow_policy either drops
+ * its oldest unwritten messages, drops the new one, or disconnects it, on
+ * io_uring the queue is first pushed to the kernel, since the send in
+ * flight may be done without the pass having ended to see it
  *
  * paramaters:
- *  Message *message: message struct containing the user name and the message
+ *  Connection *conn: the connection to write to
+ *  msgbuf_t *mb: the framed message, shared with other recipients, the
+ *        caller keeps its reference
  *
- *  returns: char *, the message with the username concatenated to the front
+ *  returns: 0 if the message was queued or dropped by the policy, -1 if the
+ *        connection is being closed
  */
-char *combine_return_message(Message *message){
-  char *src = malloc(sizeof(char)*BUFFERSIZE);
-  char *dest = malloc(sizeof(char)*BUFFERSIZE);
+int conn_send(Connection *conn, msgbuf_t *mb){
+  char reason[BUFFERSIZE];
+
+  if(conn->closing){
+    return -1;
+  }
+  while(!outbuf_fits(&conn->outbuf, mb)){
+    if(conn->reactor->ring && uring_push(conn) > 0){
+      continue;
+    }
+    if(slow_policy == POLICY_DISCONNECT){
+      if(outbuf_messages(&conn->outbuf) >= highwater_msgs){
+        sprintf(reason, "more than %lu messages behind",
+                (unsigned long)highwater_msgs);
+      }else{
+        sprintf(reason, "more than %lu bytes behind",
+                (unsigned long)highwater_bytes);
+      }
+      disconnect_slow(conn, reason);
+      return -1;
+    }
+    /* the newest is dropped as well when the only older message is the one
+    being written */
+    if(slow_policy == POLICY_DROP_NEWEST ||
+       outbuf_drop_oldest(&conn->outbuf) == 0){
+      drop_message(conn);
+      return 0;
+    }
+    drop_message(conn);
+  }
+  if(outbuf_queue(&conn->outbuf, mb) < 0){
+    stats_add(STAT_SEND_ERRORS, 1);
+    shutdown_connection(conn);
+    return -1;
+  }
+  stats_add(STAT_MSGS_OUT, 1);
+  stats_add(STAT_BYTES_OUT, mb->len);
+  stats_record(HIST_OUTQ_BYTES, outbuf_pending(&conn->outbuf));
+  if(conn->blocked){
+    return 0;
+  }
+  if(outbuf_pending(&conn->outbuf) >= coalesce_bytes){
+    flush_connection(conn);
+  }else if(!conn->dirty){
+    conn->dirty = TRUE;
+    conn->dirty_since = coalesce_delay_ns > 0 ? stats_now_ns() : 0;
+    conn->next_dirty = conn->reactor->dirty_list;
+    conn->reactor->dirty_list = conn;
+  }
+  return 0;
+}
 
-  strcpy(src,  message->user_id);
-  strcat(src,  ": ");
-  strcpy(dest, message->buffer);
-  strcat(src, dest);
+/*
+ * Function:  send_text()
+ * --------------------
+ * frames a line of text for the client to print and queues it
+ *
+ * paramaters:
+ *  Connection *conn: the connection to write to
+ *  const char *text: NUL terminated text, shorter than BUFFERSIZE
+ *
+ *  returns: 0 if successful, -1 if not successful
+ */
+int send_text(Connection *conn, const char *text){
+  msgbuf_t *mb;
+  int n;
 
-  return src;
+  mb = msgbuf_frame(OP_TEXT, 0, NULL, 0, text, strlen(text));
+  if(!mb){
+    return -1;
+  }
+  n = conn_send(conn, mb);
+  msgbuf_release(mb);
+  return n;
 }
 
 /*
- * Function:  add_user()
+ * Function:  send_last_text()
  * --------------------
- * helper method to add a user to the queue of users if they are not already in it
+ * sends a line of text to a connection about to be closed, written straight
+ * away since a closing connection is not flushed at the end of the pass, a
+ * send in flight still owns the head of the queue
  *
  * paramaters:
- *   ChatUser *chat_user: the user to add into the queue
+ *  Connection *conn: the connection to write to
+ *  const char *text: NUL terminated text, shorter than BUFFERSIZE
  *
- *  returns: char *, the message to return to the user about whether they were
- *          successfully added or not
+ *  returns: NULL
  */
-char *add_user(ChatUser *chat_user){
-  void *returned_user;
-  char *add_status_message = malloc(sizeof(char)*BUFFERSIZE);
+void send_last_text(Connection *conn, const char *text){
+  if(send_text(conn, text) == 0 && !conn->blocked){
+    outbuf_flush(&conn->outbuf, conn->csocket);
+  }
+}
 
-  returned_user = lqsearch(myqueue, find_user, chat_user);
+/*
+ * Function:  find_user()
+ * --------------------
+ * comparator method to be passed into lhsearch() and lhremove() to
+ * tell apart users whose names hash to the same slot, since each username is
+ * unique they can compare names
+ *
+ * paramaters:
+ *  void* elementp: the element to see if it is the same element
+ *  const void* id: the name to find
+ *
+ *  returns: 0 if user not found, 1 if user found
+ */
+int find_user(void* elementp, const void* id){
+  ChatUser *curr_user = (ChatUser *)elementp;
 
-  if(!returned_user){
-     lqput(myqueue, chat_user);
-     add_status_message = "SERVER: successfully joined the chatroom, start typing!\n";
+  if(strcmp(curr_user->name, (const char *)id) == 0){
+    return TRUE;
   }else{
-    add_status_message = "SERVER ERROR: A user with this username already exists!\n";
+    return FALSE;
   }
-  return add_status_message;
 }
 
 /*
- * Function:  check_switches()
+ * Function:  find_joined()
  * --------------------
- * helper method to check whether a user's message is one of the installed messages
- * for the server client, which then responds accordingly:
- |          /ping – tells the user that the server is running
- |           /join – adds user to the chat room, messages not displayed otherwise
- |           /leave – removes user from the chat room
- |          /who – obtains the current list of ID’s in the chat room, return to the server
+ * helper method to find one of the rooms a user is in by name
  *
  * paramaters:
- *   ChatUser *chat_user: the user to add into the queue
- *   Message *message: the user's message
+ *   ChatUser *chat_user: the user
+ *   const char *room_name: the room to find
  *
- *  returns: int, 1 if the user's message was a switch case, 0 if it was not
+ *  returns: int, the room's index in the user's rooms, -1 if not in it
  */
-int check_switches(Message *message, ChatUser *chat_user){
+int find_joined(ChatUser *chat_user, const char *room_name){
   int i;
-  char sendback[BUFFERSIZE];
-  const char *switches[SWITCHCOUNT] = {"/ping", "/join", "/leave", "/who"};
-
-  for(i = 0; i < SWITCHCOUNT; i++){
-    if(strncmp(message->buffer, switches[i], (strlen(switches[i]) -1)) == 0){
-      strcpy(sendback,"\n");
-      if(i == WHO){
-        lqapply(myqueue, print);
-        printf("IN WHO\n");
-        strcpy(curr_sender, message->user_id);
-        curr_sender_socket = chat_user->usocket;
-        lqapply(myqueue, send_user_in_room);
-      }
-      else if(i == PING){
-        strcpy(sendback,"SERVER: server is currently running...\n");
-      }else if(i == JOIN){
-        strcpy(sendback, add_user(chat_user));
-      }else if(i == LEAVE){
-        lqremove(myqueue, find_user, chat_user);
-        lqapply(myqueue, print);
-
-        strcpy(sendback,"SERVER: leaving the chat room..\n");
-      }
 
-      /* send message back */
-      send(chat_user->usocket, sendback, BUFFERSIZE, 0);
-      return TRUE;
+  for(i = 0; i < chat_user->nrooms; i++){
+    if(strcmp(chat_user->rooms[i]->name, room_name) == 0){
+      return i;
     }
   }
-  return FALSE;
+  return -1;
 }
 
 /*
- * Function:  send_out_message()
+ * Function:  send_message_toall()
  * --------------------
- * helper method to send a user's message to every other user, this checks
- * that the user is in the queue, concatinates the message, and calls lqapply()
- * to send that message to all other users
+ * sends a framed message to every user in a snapshot of one shard of a room,
+ * unless it is the user sending the message, no lock is held while sending and
+ * every recipient shares the one message buffer, only called by the reactor
+ * that owns the shard, the time it takes is counted in the fan-out histogram
  *
  * paramaters:
- *   ChatUser *chat_user: the user to add into the queue
- *   Message *message: the user's message
+ *  snapshot_t *snap: the room members to send to
+ *  ChatUser *sender: the user who sent the message
+ *  msgbuf_t *mb: the framed message
  *
  *  returns: NULL
  */
-void send_out_message(Message *message, ChatUser *chat_user){
-  ChatUser *returned_user = (ChatUser *)malloc(sizeof(ChatUser));
-  returned_user = (ChatUser *)lqsearch(myqueue, find_user, chat_user);
+void send_message_toall(snapshot_t *snap, ChatUser *sender, msgbuf_t *mb){
+  unsigned long start = stats_now_ns();
+  ChatUser *curr_user;
+  int i;
 
-  if(returned_user != NULL){
-    strcpy(public_message_tosend, combine_return_message(message));
-    strcpy(curr_sender, message->user_id);
-    lqapply(myqueue, send_message_toall);
+  for(i = 0; i < snap->count; i++){
+    curr_user = (ChatUser *)snap->items[i];
+    if(curr_user != sender){
+      conn_send(curr_user->conn, mb);
+    }
   }
+  stats_record(HIST_FANOUT_NS, stats_now_ns() - start);
+}
+
+/*
+ * Function:  send_user_in_room()
+ * --------------------
+ * sends one page of the names of the users in a room back to the user who
+ * requested it using the '/who' request, packed into a single frame behind
+ * a line saying how many users and pages there are, users who have had
+ * messages dropped for falling behind are listed with the count, the lists
+ * are read from the room's snapshots so no lock is held
+ *
+ * paramaters:
+ *  ChatUser *requester: the user who asked
+ *  Room *room: the room to list
+ *  int page: the page wanted, counting from 1
+ *
+ *  returns: NULL
+ */
+void send_user_in_room(ChatUser *requester, Room *room, int page){
+  snapshot_t *snaps[MAXSHARDS];
+  ChatUser *curr_user;
+  unsigned long dropped;
+  char *page_tosend;
+  msgbuf_t *mb;
+  int total = 0, pages, skip, listed = 0;
+  size_t len;
+  int i, j;
 
+  for(i = 0; i < room->nshards; i++){
+    snaps[i] = snapset_acquire(room->members[i]);
+    total += snaps[i]->count;
+  }
+  pages = total > 0 ? (total + WHOPAGE - 1) / WHOPAGE : 1;
+  if(page > pages){
+    page = pages;
+  }
+  page_tosend = (char *)arena_alloc(requester->conn->reactor->scratch,
+                                    WHOPAGE * (NAMELENGTH + 32) + 128);
+  if(page_tosend){
+    len = sprintf(page_tosend, "SERVER: %d users in %s, page %d of %d\n",
+                  total, room->name, page, pages);
+    skip = (page - 1) * WHOPAGE;
+    for(i = 0; i < room->nshards && listed < WHOPAGE; i++){
+      if(skip >= snaps[i]->count){
+        skip -= snaps[i]->count;
+        continue;
+      }
+      for(j = skip; j < snaps[i]->count && listed < WHOPAGE; j++){
+        curr_user = (ChatUser *)snaps[i]->items[j];
+        dropped = __atomic_load_n(&curr_user->dropped, __ATOMIC_RELAXED);
+        if(dropped > 0){
+          len += sprintf(page_tosend + len, "%s (%lu dropped)\n",
+                         curr_user->name, dropped);
+        }else{
+          len += sprintf(page_tosend + len, "%s\n", curr_user->name);
+        }
+        listed++;
+      }
+      skip = 0;
+    }
+    if((mb = msgbuf_frame(OP_TEXT, 0, NULL, 0, page_tosend, len))){
+      conn_send(requester->conn, mb);
+      msgbuf_release(mb);
+    }
+  }
+  for(i = 0; i < room->nshards; i++){
+    snapshot_release(snaps[i]);
+  }
 }
 
 /*
- * Function:  new_connection()
+ * Function:  send_room_list()
  * --------------------
- * A method to be called by a new thread to run asynchronously for every client
- * that requests a connection with the server, it continuously takes in and responds
- * to that client's messages
+ * sends the name and size of every room back to the user who requested it
+ * using the '/rooms' request
  *
  * paramaters:
- *   void *newsocket: a Connection struct, which provides the socket have messages sent ot
+ *  ChatUser *requester: the user who asked
  *
- *  returns: 0 when the thread is finished
+ *  returns: NULL
  */
-void *new_connection(void *newsocket){
-  Connection *currsocket = (Connection *)newsocket;
-  Message *message;
-  int reclen;
-  ChatUser *chat_user = (ChatUser *)malloc(sizeof(ChatUser));
+void send_room_list(ChatUser *requester){
+  arena_t *scratch = requester->conn->reactor->scratch;
+  char *room_tosend;
+  snapshot_t *snap = roomdir_rooms(rooms);
+  Room *room;
+  int i;
 
-  message = (Message *)malloc(sizeof(Message));
-  while(1){
-    while ( (reclen = recv(currsocket->csocket, (struct Message *)message, sizeof(Message),0)) > 0)  {
-        printf("recieved message from %s: %s", message->user_id, message->buffer);
+  for(i = 0; i < snap->count; i++){
+    room = (Room *)snap->items[i];
+    room_tosend = arena_printf(scratch, NULL, "%s (%d)\n", room->name,
+                               __atomic_load_n(&room->count, __ATOMIC_RELAXED));
+    if(room_tosend){
+      send_text(requester->conn, room_tosend);
+    }
+  }
+  snapshot_release(snap);
+}
 
-        strcpy(chat_user->name, message->user_id);
-        chat_user->usocket = currsocket->csocket;
+/*
+ * Function:  send_stats()
+ * --------------------
+ * sends a snapshot of the server's counters back to the user who requested
+ * it using the '/stats' request, followed by how many messages were dropped
+ * for that user
+ *
+ * paramaters:
+ *  ChatUser *requester: the user who asked
+ *
+ *  returns: NULL
+ */
+void send_stats(ChatUser *requester){
+  char *stats_tosend = (char *)arena_alloc(requester->conn->reactor->scratch,
+                                           STATSSIZE);
+  int len;
 
+  if(!stats_tosend){
+    return;
+  }
+  len = stats_format(stats_tosend, STATSSIZE - 32, STATS_TEXT);
+  snprintf(stats_tosend + len, STATSSIZE - len, "you_dropped %lu\n",
+           requester->dropped);
+  send_text(requester->conn, stats_tosend);
+}
 
-        if(check_switches(message, chat_user) == FALSE){
-          send_out_message(message, chat_user);
-        }
+/*
+ * Function:  send_history()
+ * --------------------
+ * sends the newest lines said in a room back to a user, one frame per line
+ * that the outbound queue gathers into a single write, used when a user
+ * joins a room and for the '/history' request, a room with nothing in
+ * memory, such as one made again after the server restarted, is served from
+ * the durable log instead
+ *
+ * paramaters:
+ *  ChatUser *requester: the user to send to
+ *  Room *room: the room
+ *  size_t n: the most lines to send
+ *
+ *  returns: int, TRUE if there was any history to send
+ */
+int send_history(ChatUser *requester, Room *room, size_t n){
+  msgbuf_t *frames[ROOMHISTORY];
+  int found, i;
 
-        if (reclen < 0) {
-             perror("Read error");
-             exit(1);
-        }
-   }
- }
- close(currsocket->csocket);
- return 0;
+  found = room_history(room, n, frames, requester->conn->reactor->scratch);
+  if(found == 0){
+    if(!chat_log){
+      return FALSE;
+    }
+    /* the frames point into the log's mapped segments, the outbound queue
+    gathers them into one write without copying them */
+    found = chatlog_history(chat_log, room->name,
+                            n < ROOMHISTORY ? (int)n : ROOMHISTORY, frames);
+  }
+  for(i = 0; i < found; i++){
+    conn_send(requester->conn, frames[i]);
+    msgbuf_release(frames[i]);
+  }
+  return found > 0;
 }
 
+/*
+ * Function:  combine_return_message()
+ * --------------------
+ * helper method to synthesize the user's message with their user name, the
+ * result is framed once into a shared buffer for every recipient, lines sent
+ * to a room other than the default one are tagged with the room's name
+ *
+ * paramaters:
+ *  Message *message: message struct containing the user name and the message
+ *  Room *room: the room the message is sent to
+ *
+ *  returns: msgbuf_t *, the framed message with the username concatenated to
+ *          the front, NULL if out of memory
+ */
+msgbuf_t *combine_return_message(Message *message, Room *room){
+  char *prefix;
+  size_t prefixlen;
+
+  if(strcmp(room->name, DEFAULTROOM) != 0){
+    prefix = arena_printf(message->scratch, &prefixlen, "[%s] %s: ",
+                          room->name, message->user_id);
+  }else{
+    prefix = arena_printf(message->scratch, &prefixlen, "%s: ",
+                          message->user_id);
+  }
+  if(!prefix){
+    return NULL;
+  }
 
-int main(int argc, char* argv[]){
-  int SERV_PORT = 0;
-  struct sockaddr_in servaddr;
-  struct sockaddr_in clientaddr;
-  socklen_t addrlen = sizeof(servaddr);
+  return msgbuf_frame(OP_TEXT, 0, prefix, prefixlen,
+                      message->buffer, message->length);
+}
 
-  int newsocket, i, err;
-  Connection *n_connection;
+/*
+ * Function:  command_arg()
+ * --------------------
+ * helper method to copy out the word following a command, such as the room
+ * in "/join games"
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   char *arg: where to copy the word to
+ *   size_t argsize: the size of arg
+ *
+ *  returns: int, the length of the word, 0 if there is none, -1 if it does
+ *          not fit in arg
+ */
+int command_arg(Message *message, char *arg, size_t argsize){
+  char *p = message->buffer;
+  size_t len;
 
-  /* user threads */
-  pthread_t tid[MAXPEOPLE];
-  /* current thread number */
-  int curr_conn_num = 0;
-  myqueue = lqopen();
+  p += strcspn(p, " \t\r\n");
+  p += strspn(p, " \t\r\n");
+  len = strcspn(p, " \t\r\n");
+  if(len >= argsize){
+    return -1;
+  }
+  memcpy(arg, p, len);
+  arg[len] = '\0';
+  return (int)len;
+}
 
+/*
+ * Function:  post_mail()
+ * --------------------
+ * hands a broadcast to another reactor, which sends it to the members of the
+ * snapshot it serves, or a direct message, which it sends to the named user
+ * if they are still there, the reactor is only woken if it has not been
+ * already
+ *
+ * paramaters:
+ *   Reactor *to: the reactor that owns the members
+ *   snapshot_t *snap: the members to send to, the reference passes to the
+ *         mail, NULL for a direct message
+ *   const char *name: the user a direct message is for, NULL for a broadcast
+ *   msgbuf_t *mb: the framed message, the caller keeps its reference
+ *
+ *  returns: 0 if successful, -1 if not successful
+ */
+int post_mail(Reactor *to, snapshot_t *snap, const char *name, msgbuf_t *mb){
+  Mail *mail = (Mail *)pool_get(mail_pool);
+  uint64_t one = 1;
 
-  if(argc != 2){
-    printf("incorrect number of arguments.");
-    return(0);
+  if(!mail){
+    if(snap){
+      snapshot_release(snap);
+    }
+    return -1;
+  }
+  mail->snap = snap;
+  mail->mb = mb;
+  mail->to[0] = '\0';
+  if(name){
+    strcpy(mail->to, name);
+  }
+  msgbuf_hold(mb);
+  if(lqput(to->mailbox, mail) != 0){
+    if(snap){
+      snapshot_release(snap);
+    }
+    msgbuf_release(mb);
+    pool_put(mail_pool, mail);
+    return -1;
   }
-  SERV_PORT = atoi(argv[1]);
+  if(!__atomic_exchange_n(&to->wake_pending, TRUE, __ATOMIC_SEQ_CST)){
+    if(write(to->wakefd, &one, sizeof(one)) < 0){
+      perror("could not wake reactor");
+    }
+  }
+  return 0;
+}
 
-  if ((sockfd = socket (AF_INET, SOCK_STREAM, 0)) <0) {
-       perror("Problem in creating the socket");
-       exit(2);
+/*
+ * Function:  deliver_mail()
+ * --------------------
+ * called by a reactor when its wakeup eventfd is readable, sends every
+ * broadcast posted to its mailbox to the members it serves, and every direct
+ * message to its user
+ *
+ * paramaters:
+ *   Reactor *self: the woken reactor
+ *
+ *  returns: NULL
+ */
+void deliver_mail(Reactor *self){
+  ChatUser *recipient;
+  uint64_t count;
+  Mail *mail;
+
+  if(read(self->wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN){
+    perror("could not read wakeup");
   }
+  /* cleared before draining, so mail posted from here on wakes us again */
+  __atomic_store_n(&self->wake_pending, FALSE, __ATOMIC_SEQ_CST);
+  while((mail = (Mail *)lqget(self->mailbox)) != NULL){
+    if(mail->snap){
+      send_message_toall(mail->snap, NULL, mail->mb);
+      snapshot_release(mail->snap);
+    }else if((recipient = (ChatUser *)lhsearch(users, find_user, mail->to,
+                                               strlen(mail->to))) &&
+             recipient->conn->reactor == self){
+      conn_send(recipient->conn, mail->mb);
+    }
+    msgbuf_release(mail->mb);
+    pool_put(mail_pool, mail);
+  }
+}
 
-  /* create the socket */
-  memset((char *) &servaddr, 0, sizeof(servaddr));
-  servaddr.sin_family = AF_INET;
-  servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-  servaddr.sin_port = htons(SERV_PORT);
+/*
+ * Function:  send_to_room()
+ * --------------------
+ * sends a framed message to every member of a room on this server but one,
+ * the members this reactor serves are sent it straight away and those served
+ * by other reactors have it handed to their reactors' mailboxes
+ *
+ * paramaters:
+ *   Room *room: the room
+ *   ChatUser *sender: the member not to send it to, NULL for none
+ *   msgbuf_t *mb: the framed message, the caller keeps its reference
+ *   Reactor *self: the calling reactor
+ *
+ *  returns: NULL
+ */
+void send_to_room(Room *room, ChatUser *sender, msgbuf_t *mb, Reactor *self){
+  snapshot_t *snap;
+  int i;
 
-  /* bind the socket to the address */
-  if (bind(sockfd, (struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
-    printf("bind failed");
-  	perror("bind failed");
-  	return 0;
+  for(i = 0; i < room->nshards; i++){
+    snap = snapset_acquire(room->members[i]);
+    if(snap->count == 0){
+      snapshot_release(snap);
+    }else if(i == self->id){
+      send_message_toall(snap, sender, mb);
+      snapshot_release(snap);
+    }else{
+      post_mail(&reactors[i], snap, NULL, mb);
+    }
   }
+}
 
-  /* listen for incoming connections */
-  if(listen (sockfd, LISTENQ) == 0){
-    printf("server listening for clients...\n");
-  }else{
-    perror("listening failed...\n");
+/*
+ * Function:  send_presence()
+ * --------------------
+ * tells the other members of a room that a user joined or left it, one
+ * small frame for each of them, so a client keeps its list of members
+ * current from these instead of asking for the whole list again
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user who joined or left
+ *   Room *room: the room
+ *   int opcode: OP_JOINED or OP_LEFT
+ *
+ *  returns: NULL
+ */
+void send_presence(ChatUser *chat_user, Room *room, int opcode){
+  msgbuf_t *mb = msgbuf_frame(opcode, 0, room->name, strlen(room->name) + 1,
+                              chat_user->name, strlen(chat_user->name));
+
+  if(!mb){
+    return;
   }
+  send_to_room(room, chat_user, mb, chat_user->conn->reactor);
+  stats_add(STAT_PRESENCE, 1);
+  msgbuf_release(mb);
+}
 
-  /* accept all new connections from different clients, send them to a seperate thread */
-  while(1){
-    newsocket = accept(sockfd, (struct sockaddr *) &clientaddr, &addrlen);
-    printf("Received new connection request, number %d...\n", curr_conn_num);
+/*
+ * Function:  leave_room()
+ * --------------------
+ * helper method to take a user out of one of their rooms, if it was the
+ * active room the most recently joined room left becomes active, the rest
+ * of the room and linked servers are told the user left
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user to remove
+ *   int i: the room's index in the user's rooms
+ *
+ *  returns: NULL
+ */
+void leave_room(ChatUser *chat_user, int i){
+  Room *room = chat_user->rooms[i];
 
-    n_connection = (Connection *)malloc(sizeof(Connection));
-    n_connection->csocket = newsocket;
+  if(federation){
+    fed_member(federation, room->name, chat_user->name, FALSE);
+  }
+  /* while the room is sure to still be there */
+  send_presence(chat_user, room, OP_LEFT);
 
-    err = pthread_create(&tid[curr_conn_num], NULL, new_connection, n_connection);
-    if (err != 0){
-        printf("\ncan't create thread");
-        return(1);
+  chat_user->rooms[i] = chat_user->rooms[--chat_user->nrooms];
+  if(chat_user->active == room){
+    chat_user->active = NULL;
+    if(chat_user->nrooms > 0){
+      chat_user->active = chat_user->rooms[chat_user->nrooms - 1];
     }
-    curr_conn_num++;
   }
+  room_leave(rooms, room, chat_user, chat_user->conn->reactor->id);
+  stats_add(STAT_LEAVES, 1);
+}
 
-  for(i = 0; i <= curr_conn_num; i++){
-    pthread_join(tid[i], NULL);
+/*
+ * Function:  remove_user()
+ * --------------------
+ * helper method to take a user out of every room they are in
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user to remove
+ *
+ *  returns: NULL
+ */
+void remove_user(ChatUser *chat_user){
+  while(chat_user->nrooms > 0){
+    leave_room(chat_user, chat_user->nrooms - 1);
+  }
+}
+
+/*
+ * Function:  add_user()
+ * --------------------
+ * helper method to add a user to a room if they are not already in it, the
+ * room becomes the one the user's lines are sent to, and the rest of the room
+ * is told the user joined
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user to add into the room
+ *   const char *room_name: the room to join
+ *
+ *  returns: const char *, the message to return to the user about whether
+ *          they were successfully added or not, a constant string
+ */
+const char *add_user(ChatUser *chat_user, const char *room_name){
+  const char *add_status_message;
+  int i;
+  Room *room;
+
+  if((i = find_joined(chat_user, room_name)) >= 0){
+    chat_user->active = chat_user->rooms[i];
+    return "SERVER: you are already in that room, now talking in it\n";
+  }
+  if(chat_user->nrooms == MAXUSERROOMS){
+    return "SERVER ERROR: you are in too many rooms\n";
+  }
+  room = room_join(rooms, room_name, chat_user, chat_user->conn->reactor->id);
+
+  if(room){
+     chat_user->rooms[chat_user->nrooms++] = room;
+     chat_user->active = room;
+     stats_add(STAT_JOINS, 1);
+     if(federation){
+       fed_member(federation, room->name, chat_user->name, TRUE);
+     }
+     send_presence(chat_user, room, OP_JOINED);
+     add_status_message = "SERVER: successfully joined the chatroom, start typing!\n";
+  }else{
+    add_status_message = "SERVER ERROR: could not join the chatroom\n";
+  }
+  return add_status_message;
+}
+
+/*
+ * Function:  send_out_message()
+ * --------------------
+ * helper method to send a user's message to every other user in their active
+ * room, this checks that the user is in a room, concatinates the message, and
+ * sends it to all other users in the current snapshot of that room, members
+ * served by other reactors are handed to those reactors' mailboxes, and
+ * linked servers with members in the room are sent it once each
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user to add into the queue
+ *   Message *message: the user's message
+ *
+ *  returns: NULL
+ */
+void send_out_message(Message *message, ChatUser *chat_user){
+  ChatUser *returned_user = (ChatUser *)lhsearch(users, find_user,
+                                                 chat_user->name,
+                                                 strlen(chat_user->name));
+
+  if(returned_user == chat_user && chat_user->active){
+    msgbuf_t *mb = combine_return_message(message, chat_user->active);
+    Reactor *self = chat_user->conn->reactor;
+
+    if(!mb){
+      return;
+    }
+    room_record(chat_user->active, self->id, mb);
+    if(chat_log && chatlog_append(chat_log, chat_user->active->name, mb) < 0){
+      stats_add(STAT_LOG_DROPS, 1);
+    }
+    send_to_room(chat_user->active, chat_user, mb, self);
+    if(federation){
+      fed_forward(federation, chat_user->active->name, mb);
+    }
+    msgbuf_release(mb);
+  }
+
+}
+
+/*
+ * Function:  send_direct()
+ * --------------------
+ * sends a framed message to one user, found through the user name index, a
+ * user served by another reactor has it handed to that reactor's mailbox,
+ * either way it costs one send and no room is walked
+ *
+ * paramaters:
+ *   ChatUser *sender: the user who sent the message
+ *   const char *name: the name of the user to send to
+ *   msgbuf_t *mb: the framed message, the caller keeps its reference
+ *
+ *  returns: 0 if successful, -1 if there is no user with that name
+ */
+int send_direct(ChatUser *sender, const char *name, msgbuf_t *mb){
+  ChatUser *recipient;
+
+  /* the user cannot be freed before this reactor's next quiescent state,
+  since it is only freed after it is taken out of the index */
+  recipient = (ChatUser *)lhsearch(users, find_user, name, strlen(name));
+  if(!recipient || recipient->conn->closing){
+    return -1;
+  }
+  stats_add(STAT_MSGS_DIRECT, 1);
+  if(recipient->conn->reactor == sender->conn->reactor){
+    conn_send(recipient->conn, mb);
+    return 0;
+  }
+  /* the other reactor looks the name up again, by then the user may have
+  gone */
+  return post_mail(recipient->conn->reactor, NULL, name, mb) < 0 ? -1 : 0;
+}
+
+/*
+ * Function:  command_ping()
+ * --------------------
+ * '/ping', tells the user that the server is running
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_ping(Message *message, ChatUser *chat_user, char *sendback){
+  strcpy(sendback,"SERVER: server is currently running...\n");
+}
+
+/*
+ * Function:  command_join()
+ * --------------------
+ * '/join [room]', adds the user to a chat room and replays its history if
+ * they were not in it already
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_join(Message *message, ChatUser *chat_user, char *sendback){
+  char room_name[ROOMNAMELENGTH];
+  int nrooms = chat_user->nrooms;
+  int j;
+
+  j = command_arg(message, room_name, sizeof(room_name));
+  if(j < 0){
+    strcpy(sendback, "SERVER ERROR: invalid room name\n");
+    return;
+  }
+  send_text(chat_user->conn, add_user(chat_user, j ? room_name : DEFAULTROOM));
+  /* only a room the user was not already in is replayed */
+  if(chat_user->nrooms > nrooms){
+    send_history(chat_user, chat_user->active, JOINHISTORY);
+  }
+  sendback[0] = '\0';
+}
+
+/*
+ * Function:  command_leave()
+ * --------------------
+ * '/leave [room]', removes the user from a chat room, the active one by
+ * default
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_leave(Message *message, ChatUser *chat_user, char *sendback){
+  char room_name[ROOMNAMELENGTH];
+  int j;
+
+  j = command_arg(message, room_name, sizeof(room_name));
+  if(j == 0 && chat_user->active){
+    strcpy(room_name, chat_user->active->name);
+  }
+  if(j < 0 || (j = find_joined(chat_user, room_name)) < 0){
+    strcpy(sendback,"SERVER ERROR: you are not in that room\n");
+  }else{
+    leave_room(chat_user, j);
+    strcpy(sendback,"SERVER: leaving the chat room..\n");
+  }
+}
+
+/*
+ * Function:  command_who()
+ * --------------------
+ * '/who [page]', lists the users in the active room, a page at a time
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_who(Message *message, ChatUser *chat_user, char *sendback){
+  char page[16];
+  int j;
+
+  j = command_arg(message, page, sizeof(page));
+  if(!chat_user->active){
+    strcpy(sendback, "SERVER ERROR: you are not in a room\n");
+  }else{
+    send_user_in_room(chat_user, chat_user->active,
+                      j > 0 && atoi(page) > 1 ? atoi(page) : 1);
+    sendback[0] = '\0';
+  }
+}
+
+/*
+ * Function:  command_rooms()
+ * --------------------
+ * '/rooms', lists every room and how many users are in it
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_rooms(Message *message, ChatUser *chat_user, char *sendback){
+  send_room_list(chat_user);
+  sendback[0] = '\0';
+}
+
+/*
+ * Function:  command_stats()
+ * --------------------
+ * '/stats', the server's live counters
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_stats(Message *message, ChatUser *chat_user, char *sendback){
+  send_stats(chat_user);
+  sendback[0] = '\0';
+}
+
+/*
+ * Function:  command_history()
+ * --------------------
+ * '/history [n]', the last n lines said in the active room
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_history(Message *message, ChatUser *chat_user, char *sendback){
+  char count[16];
+  char *end;
+  long n = ROOMHISTORY;
+  int j;
+
+  j = command_arg(message, count, sizeof(count));
+  if(j != 0){
+    errno = 0;
+    n = j > 0 ? strtol(count, &end, 10) : 0;
+    if(j < 0 || *end != '\0' || errno != 0 || n <= 0){
+      strcpy(sendback, "SERVER ERROR: usage /history [n], n at least 1\n");
+      return;
+    }
+  }
+  if(!chat_user->active){
+    strcpy(sendback, "SERVER ERROR: you are not in a room\n");
+  }else if(!send_history(chat_user, chat_user->active, (size_t)n)){
+    strcpy(sendback, "SERVER: nothing has been said in this room\n");
+  }else{
+    sendback[0] = '\0';
+  }
+}
+
+/*
+ * Function:  command_msg()
+ * --------------------
+ * '/msg user text', sends a line to one user only, wherever they are,
+ * framed with the sender's name like a room line, nothing is sent back
+ * unless the user cannot be found
+ *
+ * paramaters:
+ *   Message *message: the user's message
+ *   ChatUser *chat_user: the user who sent it
+ *   char *sendback: where to write the reply, BUFFERSIZE bytes
+ *
+ *  returns: NULL
+ */
+void command_msg(Message *message, ChatUser *chat_user, char *sendback){
+  char name[NAMELENGTH];
+  char *prefix;
+  size_t prefixlen;
+  char *text = message->buffer;
+  msgbuf_t *mb;
+
+  if(command_arg(message, name, sizeof(name)) <= 0){
+    strcpy(sendback, "SERVER ERROR: usage /msg <user> <text>\n");
+    return;
+  }
+  /* the text is whatever follows the name, newline and all */
+  text += strcspn(text, " \t\r\n");
+  text += strspn(text, " \t");
+  text += strcspn(text, " \t\r\n");
+  text += strspn(text, " \t");
+  if(*text == '\0' || *text == '\r' || *text == '\n'){
+    strcpy(sendback, "SERVER ERROR: usage /msg <user> <text>\n");
+    return;
+  }
+  prefix = arena_printf(message->scratch, &prefixlen, "[private] %s: ",
+                        chat_user->name);
+  mb = prefix ? msgbuf_frame(OP_TEXT, 0, prefix, prefixlen, text,
+                             message->length - (text - message->buffer))
+              : NULL;
+  if(!mb){
+    strcpy(sendback, "SERVER ERROR: out of memory\n");
+    return;
+  }
+  if(send_direct(chat_user, name, mb) < 0){
+    sprintf(sendback, "SERVER ERROR: no user named %s\n", name);
+  }else{
+    sendback[0] = '\0';
+  }
+  msgbuf_release(mb);
+}
+
+/*
+ * Function:  find_command()
+ * --------------------
+ * comparator method to be passed into hsearch() to tell apart commands
+ * whose names hash to the same slot
+ *
+ * paramaters:
+ *  void* elementp: the command to check
+ *  const void* id: the name to find
+ *
+ *  returns: 0 if command not found, 1 if command found
+ */
+int find_command(void* elementp, const void* id){
+  return strcmp(((Command *)elementp)->name, (const char *)id) == 0;
+}
+
+/*
+ * Function:  register_command()
+ * --------------------
+ * adds a command users can type, only called before the reactors start
+ *
+ * paramaters:
+ *   const char *name: what the user types, such as "/ping"
+ *   void (*fn)(Message*, ChatUser*, char*): its handler
+ *
+ *  returns: 0 if successful, -1 if not successful
+ */
+int register_command(const char *name,
+                     void (*fn)(Message *message, ChatUser *chat_user,
+                                char *sendback)){
+  Command *cmd;
+
+  if(strlen(name) >= COMMANDLENGTH ||
+     hsearch(commands, find_command, name, strlen(name)) != NULL ||
+     !(cmd = (Command *)malloc(sizeof(Command)))){
+    return -1;
+  }
+  strcpy(cmd->name, name);
+  cmd->fn = fn;
+  if(hput(commands, cmd, name, strlen(name)) != 0){
+    free(cmd);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Function:  register_commands()
+ * --------------------
+ * builds the command table, new commands are added here
+ *
+ * paramaters:
+ *   NULL
+ *
+ *  returns: 0 if successful, -1 if not successful
+ */
+int register_commands(void){
+  if(!(commands = hopen(COMMANDSLOTS))){
+    return -1;
+  }
+  if(register_command("/ping", command_ping) < 0 ||
+     register_command("/join", command_join) < 0 ||
+     register_command("/leave", command_leave) < 0 ||
+     register_command("/who", command_who) < 0 ||
+     register_command("/rooms", command_rooms) < 0 ||
+     register_command("/stats", command_stats) < 0 ||
+     register_command("/history", command_history) < 0 ||
+     register_command("/msg", command_msg) < 0){
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Function:  check_switches()
+ * --------------------
+ * helper method to check whether a user's message is one of the installed messages
+ * for the server client, the first word is looked up in the command table
+ * and its handler responds accordingly:
+ |          /ping – tells the user that the server is running
+ |           /join [room] – adds user to a chat room, messages not displayed otherwise
+ |           /leave [room] – removes user from a chat room, the active one by default
+ |          /who [page] – obtains a page of the current list of ID’s in the active room
+ |          /rooms – lists every room and how many users are in it
+ |          /stats – the server's live counters
+ |          /history [n] – the last n lines said in the active room
+ |          /msg user text – sends a line to one user only
+ *
+ * paramaters:
+ *   ChatUser *chat_user: the user to add into the queue
+ *   Message *message: the user's message
+ *
+ *  returns: int, 1 if the user's message was a switch case, 0 if it was not
+ */
+int check_switches(Message *message, ChatUser *chat_user){
+  char name[COMMANDLENGTH];
+  char *sendback;
+  size_t len;
+  Command *cmd;
+
+  if(message->buffer[0] != '/'){
+    return FALSE;
+  }
+  len = strcspn(message->buffer, " \t\r\n");
+  if(len >= COMMANDLENGTH){
+    return FALSE;
+  }
+  memcpy(name, message->buffer, len);
+  name[len] = '\0';
+  if(!(cmd = (Command *)hsearch(commands, find_command, name, len))){
+    return FALSE;
+  }
+  if(!(sendback = (char *)arena_alloc(message->scratch, BUFFERSIZE))){
+    send_text(chat_user->conn, "SERVER ERROR: out of memory\n");
+    return TRUE;
+  }
+  strcpy(sendback,"\n");
+  cmd->fn(message, chat_user, sendback);
+
+  /* send message back */
+  if(sendback[0] != '\0'){
+    send_text(chat_user->conn, sendback);
+  }
+  return TRUE;
+}
+
+/*
+ * Function:  arm_timeout()
+ * --------------------
+ * arms a connection's timer for the first of its deadlines, saying its
+ * name if it has not, answering a ping if one is outstanding, being pinged
+ * once it has been silent for a keepalive interval, and chatting before
+ * the idle timeout
+ *
+ * paramaters:
+ *   Connection *conn: the connection
+ *
+ *  returns: NULL
+ */
+void arm_timeout(Connection *conn){
+  unsigned long when = 0;
+
+  if(!conn->chat_user->registered){
+    if(handshake_ms > 0){
+      when = conn->accepted_ms + handshake_ms;
+    }
+  }else{
+    if(keepalive_ms > 0){
+      when = conn->heard_ms + (conn->pinged ? 2 : 1) * keepalive_ms;
+    }
+    if(idle_ms > 0 && (when == 0 || conn->chat_ms + idle_ms < when)){
+      when = conn->chat_ms + idle_ms;
+    }
+  }
+  if(when == 0){
+    wheel_cancel(conn->reactor->timers, &conn->timer);
+  }else{
+    wheel_arm(conn->reactor->timers, &conn->timer, when);
+  }
+}
+
+/*
+ * Function:  connection_timeout()
+ * --------------------
+ * called by the timer wheel when a connection's timer fires, the timer is
+ * not moved as bytes arrive, so it first checks which deadline, if any,
+ * has really passed, then pings or closes the connection, or arms the timer
+ * again for the next deadline
+ *
+ * paramaters:
+ *   wheel_timer_t *t: the timer
+ *   void *arg: the Connection it belongs to
+ *
+ *  returns: NULL
+ */
+void connection_timeout(wheel_timer_t *t, void *arg){
+  Connection *conn = (Connection *)arg;
+  unsigned long now = conn->reactor->now_ms;
+  char reason[BUFFERSIZE];
+
+  if(conn->closing){
+    return;
+  }
+  reason[0] = '\0';
+  if(!conn->chat_user->registered){
+    if(handshake_ms > 0 && now - conn->accepted_ms >= handshake_ms){
+      strcpy(reason, "SERVER ERROR: no screen name was given in time\n");
+    }
+  }else if(idle_ms > 0 && now - conn->chat_ms >= idle_ms){
+    sprintf(reason, "SERVER: disconnected after %lu seconds idle\n",
+            idle_ms / 1000);
+  }else if(keepalive_ms > 0 && conn->pinged &&
+           now - conn->heard_ms >= 2 * keepalive_ms){
+    /* a peer that cannot answer a ping will not read a reason either */
+    stats_add(STAT_TIMEOUTS, 1);
+    shutdown_connection(conn);
+    return;
+  }else if(keepalive_ms > 0 && !conn->pinged &&
+           now - conn->heard_ms >= keepalive_ms){
+    conn->pinged = TRUE;
+    stats_add(STAT_PINGS, 1);
+    conn_send(conn, ping_frame);
+  }
+  if(reason[0] != '\0'){
+    stats_add(STAT_TIMEOUTS, 1);
+    send_last_text(conn, reason);
+    shutdown_connection(conn);
+    return;
+  }
+  if(!conn->closing){
+    arm_timeout(conn);
+  }
+}
+
+/*
+ * Function:  deliver_remote()
+ * --------------------
+ * called on the link thread for a line said in a room on a linked server,
+ * remembers it in the room's history and hands it to every reactor serving
+ * members of the room, it is never forwarded to another server
+ *
+ * paramaters:
+ *   const char *room_name: the room the line was said in
+ *   msgbuf_t *mb: the framed line, the caller keeps its reference
+ *   void *arg: unused
+ *
+ *  returns: NULL
+ */
+void deliver_remote(const char *room_name, msgbuf_t *mb, void *arg){
+  Room *room = room_find(rooms, room_name);
+  snapshot_t *snap;
+  int i;
+
+  if(!room){
+    return;
+  }
+  room_record(room, link_shard, mb);
+  if(chat_log && chatlog_append(chat_log, room->name, mb) < 0){
+    stats_add(STAT_LOG_DROPS, 1);
+  }
+  for(i = 0; i < nreactors; i++){
+    snap = snapset_acquire(room->members[i]);
+    if(snap->count == 0){
+      snapshot_release(snap);
+    }else{
+      post_mail(&reactors[i], snap, NULL, mb);
+    }
+  }
+}
+
+/*
+ * Function:  free_connection()
+ * --------------------
+ * frees a closed connection, run through snap_defer() once no snapshot of a
+ * room can still point at it
+ *
+ * paramaters:
+ *   void *arg: the Connection to free
+ *
+ *  returns: NULL
+ */
+void free_connection(void *arg){
+  Connection *conn = (Connection *)arg;
+
+  pool_put(user_pool, conn->chat_user);
+  pool_put(conn_pool, conn);
+}
+
+/*
+ * Function:  release_connection()
+ * --------------------
+ * closes a closed connection's socket and frees everything it owns, once
+ * no io_uring operation can still point at it
+ *
+ * paramaters:
+ *   Connection *conn: the connection to release
+ *
+ *  returns: NULL
+ */
+void release_connection(Connection *conn){
+  close(conn->csocket);
+  proto_decoder_free(&conn->decoder);
+  outbuf_free(&conn->outbuf);
+  /* readers of an older snapshot may still see the struct, conn->closing
+  keeps them from touching the socket until it is freed */
+  if(snap_defer(free_connection, conn) < 0){
+    stats_add(STAT_CONNS_LEAKED, 1);
+  }
+}
+
+/*
+ * Function:  close_connection()
+ * --------------------
+ * removes a client from its rooms and the event loop and frees everything
+ * the connection owns, only called by the event loop between batches of
+ * events, on io_uring the socket is shut down and the connection released
+ * when its last operation completes
+ *
+ * paramaters:
+ *   Connection *conn: the connection to close
+ *
+ *  returns: NULL
+ */
+void close_connection(Connection *conn){
+  stats_add(STAT_CLOSES, 1);
+  remove_user(conn->chat_user);
+  if(conn->chat_user->registered){
+    lhremove(users, find_user, conn->chat_user->name,
+             strlen(conn->chat_user->name));
+  }
+  conn->closed = TRUE;
+  wheel_cancel(conn->reactor->timers, &conn->timer);
+  if(!conn->reactor->ring){
+    epoll_ctl(conn->reactor->epollfd, EPOLL_CTL_DEL, conn->csocket, NULL);
+  }else if(conn->inflight > 0){
+    /* ends the receive and any send, their completions release it */
+    shutdown(conn->csocket, SHUT_RDWR);
+    uring_cancel(conn->reactor->ring, (unsigned long)conn | UD_RECV);
+    return;
+  }
+  release_connection(conn);
+}
+
+/*
+ * Function:  valid_name()
+ * --------------------
+ * checks a screen name sent in a hello, the user index and every lookup in
+ * it key on the name up to its first NUL, so a name with a NUL inside it
+ * would be indexed under a different name than the one it is found by, and
+ * names with spaces or control bytes would break /msg and /who
+ *
+ * paramaters:
+ *   const char *name: the hello's payload, NUL terminated
+ *   size_t length: the payload's length
+ *
+ *  returns: int, TRUE if the name may be used, FALSE if not
+ */
+int valid_name(const char *name, size_t length){
+  size_t i;
+
+  if(length == 0 || length >= NAMELENGTH || strlen(name) != length){
+    return FALSE;
+  }
+  for(i = 0; i < length; i++){
+    if((unsigned char)name[i] <= ' ' || (unsigned char)name[i] == 0x7f){
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/*
+ * Function:  take_tokens()
+ * --------------------
+ * refills a connection's token buckets for the time since they were last
+ * refilled and takes what a line costs out of them, a line is only let
+ * through if both buckets can pay for it, so a client flooding the server
+ * can make it send no more than the rate allows times the size of the room
+ *
+ * paramaters:
+ *   Connection *conn: the connection the line arrived on
+ *   size_t bytes: the length of the line
+ *
+ *  returns: int, TRUE if the line may be handled, FALSE if it is over the
+ *          limit
+ */
+int take_tokens(Connection *conn, size_t bytes){
+  double elapsed = (double)(conn->reactor->now_ms - conn->refill_ms) / 1000;
+
+  conn->refill_ms = conn->reactor->now_ms;
+  if(rate_msgs > 0){
+    conn->msg_tokens += elapsed * rate_msgs;
+    if(conn->msg_tokens > burst_msgs){
+      conn->msg_tokens = burst_msgs;
+    }
+  }
+  if(rate_bytes > 0){
+    conn->byte_tokens += elapsed * rate_bytes;
+    if(conn->byte_tokens > burst_bytes){
+      conn->byte_tokens = burst_bytes;
+    }
+  }
+  if((rate_msgs > 0 && conn->msg_tokens < 1) ||
+     (rate_bytes > 0 && conn->byte_tokens < bytes)){
+    return FALSE;
+  }
+  conn->msg_tokens -= 1;
+  conn->byte_tokens -= bytes;
+  return TRUE;
+}
+
+/*
+ * Function:  handle_frame()
+ * --------------------
+ * responds to one complete frame from a client, a hello names the connection
+ * with a name no other user has,
+ * a chat line is either a switch case or a line to send to the rest of the room,
+ * unless the client is over its rate limit, when it is dropped,
+ * anything else, such as the answer to a ping, only shows the client is alive
+ *
+ * paramaters:
+ *   proto_frame_t *frame: the decoded frame
+ *   void *arg: the Connection the frame arrived on
+ *
+ *  returns: 0 to keep decoding, -1 if the client broke the protocol
+ */
+int handle_frame(proto_frame_t *frame, void *arg){
+  Connection *conn = (Connection *)arg;
+  Message message;
+
+  if(conn->closing){
+    return -1;
+  }
+  if(frame->opcode == OP_HELLO){
+    if(!valid_name(frame->payload, frame->length) ||
+       conn->chat_user->name[0] != '\0'){
+      send_last_text(conn, "SERVER ERROR: invalid screen name\n");
+      return -1;
+    }
+    strcpy(conn->chat_user->name, frame->payload);
+    if(lhinsert(users, conn->chat_user, find_user, conn->chat_user->name,
+                strlen(conn->chat_user->name)) != 0){
+      send_last_text(conn, "SERVER ERROR: A user with this username already exists!\n");
+      return -1;
+    }
+    conn->chat_user->registered = TRUE;
+    /* from here on the keepalive and idle deadlines apply */
+    arm_timeout(conn);
+    return 0;
+  }
+  if(frame->opcode != OP_CHAT){
+    return 0;
+  }
+  conn->chat_ms = conn->reactor->now_ms;
+  if(conn->chat_user->name[0] == '\0'){
+    send_last_text(conn, "SERVER ERROR: no screen name was given\n");
+    return -1;
+  }
+  if(frame->length > MAXLINE){
+    send_text(conn, "SERVER ERROR: message too long\n");
+    return 0;
+  }
+  /* commands are limited too, a /who costs as much as a line to the room */
+  if(!take_tokens(conn, frame->length)){
+    stats_add(STAT_THROTTLED_MSGS, 1);
+    /* told once per spell, so the notices cannot flood the client back */
+    if(!conn->throttled){
+      conn->throttled = TRUE;
+      stats_add(STAT_THROTTLES, 1);
+      send_text(conn, "SERVER: you are sending too fast, lines are being dropped\n");
+    }
+    return 0;
+  }
+  conn->throttled = FALSE;
+
+  message.buffer = frame->payload;
+  message.length = frame->length;
+  message.user_id = conn->chat_user->name;
+  message.scratch = conn->reactor->scratch;
+  stats_add(STAT_MSGS_IN, 1);
+
+  if(check_switches(&message, conn->chat_user) == FALSE){
+    send_out_message(&message, conn->chat_user);
+  }
+  /* everything the message needed is framed or sent by now */
+  arena_reset(message.scratch);
+  return 0;
+}
+
+/*
+ * Function:  consume_input()
+ * --------------------
+ * feeds bytes read from a client to the connection's frame decoder, which
+ * handles every frame they complete, partial frames are kept in the decoder
+ * until the rest of their bytes arrive
+ *
+ * paramaters:
+ *   Connection *conn: the connection the bytes arrived on
+ *   const char *buf: the bytes
+ *   size_t n: how many
+ *
+ *  returns: NULL
+ */
+void consume_input(Connection *conn, const char *buf, size_t n){
+  stats_add(STAT_BYTES_IN, n);
+  /* any bytes at all show the peer is alive, the timer notices later */
+  conn->heard_ms = conn->reactor->now_ms;
+  conn->pinged = FALSE;
+  if(proto_decode(&conn->decoder, buf, n, handle_frame, conn) != 0){
+    shutdown_connection(conn);
+  }
+}
+
+/*
+ * Function:  read_connection()
+ * --------------------
+ * called by the event loop whenever a client socket is readable, since the
+ * socket is edge triggered it reads until the kernel has nothing left and feeds
+ * the bytes to consume_input()
+ *
+ * paramaters:
+ *   Connection *conn: the readable connection
+ *
+ *  returns: 0 if the connection is still open, -1 if it is being closed
+ */
+int read_connection(Connection *conn){
+  char buf[READSIZE];
+  ssize_t reclen;
+
+  while(!conn->closing){
+    reclen = recv(conn->csocket, buf, sizeof(buf), 0);
+    if(reclen > 0){
+      consume_input(conn, buf, reclen);
+    }else if(reclen == 0){
+      shutdown_connection(conn);
+    }else if(errno == EINTR){
+      continue;
+    }else if(errno == EAGAIN || errno == EWOULDBLOCK){
+      return 0;
+    }else{
+      /* a peer that reset the connection just went away */
+      if(errno != ECONNRESET){
+        stats_add(STAT_READ_ERRORS, 1);
+      }
+      shutdown_connection(conn);
+    }
+  }
+  return -1;
+}
+
+/*
+ * Function:  write_connection()
+ * --------------------
+ * called by the event loop whenever a client socket is writable, writes as
+ * much of the connection's pending output as the socket will take if it had
+ * filled up, output that is only being held back to be coalesced is left for
+ * flush_dirty()
+ *
+ * paramaters:
+ *   Connection *conn: the writable connection
+ *
+ *  returns: NULL
+ */
+void write_connection(Connection *conn){
+  if(conn->blocked){
+    conn->blocked = FALSE;
+    flush_connection(conn);
+  }
+}
+
+/*
+ * Function:  flush_dirty()
+ * --------------------
+ * writes out every connection on the reactor's dirty list whose replies have
+ * waited coalesce_delay_ns, so a client gets one sendmsg() per pass however
+ * many lines were queued for it, connections being closed are dropped from
+ * the list
+ *
+ * paramaters:
+ *   Reactor *self: the reactor that handled the events
+ *
+ *  returns: int, milliseconds until the next connection is due, -1 if the
+ *        list is empty
+ */
+int flush_dirty(Reactor *self){
+  Connection *conn, **link = &self->dirty_list;
+  unsigned long now = 0, next = 0;
+
+  if(coalesce_delay_ns > 0 && self->dirty_list){
+    now = stats_now_ns();
+  }
+  while((conn = *link) != NULL){
+    if(!conn->closing && now - conn->dirty_since < coalesce_delay_ns){
+      if(next == 0 || conn->dirty_since + coalesce_delay_ns - now < next){
+        next = conn->dirty_since + coalesce_delay_ns - now;
+      }
+      link = &conn->next_dirty;
+      continue;
+    }
+    *link = conn->next_dirty;
+    conn->dirty = FALSE;
+    if(!conn->blocked){
+      flush_connection(conn);
+    }
+  }
+  if(!self->dirty_list){
+    return -1;
+  }
+  /* epoll_wait() counts in milliseconds, so round up rather than spin */
+  return (int)((next + 999999) / 1000000);
+}
+
+/*
+ * Function:  run_timers()
+ * --------------------
+ * fires every connection timer due by the start of the event loop pass,
+ * once its events are handled, so bytes that arrived in the pass count,
+ * connections the timers close are reaped with the rest of the pass's
+ *
+ * paramaters:
+ *   Reactor *self: the reactor
+ *
+ *  returns: NULL
+ */
+void run_timers(Reactor *self){
+  wheel_advance(self->timers, self->now_ms);
+}
+
+/*
+ * Function:  wait_timeout()
+ * --------------------
+ * how long the event loop may sleep, until the first of the next dirty
+ * connection and the next timer is due
+ *
+ * paramaters:
+ *   Reactor *self: the reactor
+ *   int flush_ms: milliseconds until the next dirty connection is due, -1
+ *        if there is none
+ *
+ *  returns: int, milliseconds, -1 to sleep until something happens
+ */
+int wait_timeout(Reactor *self, int flush_ms){
+  int timer_ms = wheel_timeout(self->timers, stats_now_ns() / 1000000);
+
+  if(timer_ms < 0 || (flush_ms >= 0 && flush_ms < timer_ms)){
+    return flush_ms;
+  }
+  return timer_ms;
+}
+
+/*
+ * Function:  reap_connections()
+ * --------------------
+ * closes every connection that was marked for closing while the last batch
+ * of events was handled
+ *
+ * paramaters:
+ *   Reactor *self: the reactor that handled the events
+ *
+ *  returns: NULL
+ */
+void reap_connections(Reactor *self){
+  Connection *conn;
+
+  while(self->closing_list){
+    conn = self->closing_list;
+    self->closing_list = conn->next_closing;
+    close_connection(conn);
+  }
+}
+
+/*
+ * Function:  new_connection()
+ * --------------------
+ * sets up the state of a client a reactor has just accepted
+ *
+ * paramaters:
+ *   Reactor *self: the reactor that accepted it
+ *   int newsocket: the client's socket, closed if not successful
+ *
+ *  returns: Connection*, the connection, NULL if out of memory
+ */
+Connection *new_connection(Reactor *self, int newsocket){
+  Connection *conn;
+  int one = 1;
+
+  /* replies are already gathered into one write per pass, so Nagle would
+  only add a round trip of delay to them */
+  setsockopt(newsocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  conn = (Connection *)pool_get(conn_pool);
+  if(!conn || !(conn->chat_user = (ChatUser *)pool_get(user_pool))){
+    perror("out of memory");
+    close(newsocket);
+    pool_put(conn_pool, conn);
+    return NULL;
+  }
+  conn->csocket = newsocket;
+  conn->reactor = self;
+  proto_decoder_init(&conn->decoder, BUFFERSIZE);
+  outbuf_init(&conn->outbuf, highwater_bytes, highwater_msgs);
+  conn->closing = FALSE;
+  conn->next_closing = NULL;
+  conn->dirty = FALSE;
+  conn->next_dirty = NULL;
+  conn->blocked = FALSE;
+  conn->send_op = NULL;
+  conn->inflight = 0;
+  conn->closed = FALSE;
+  conn->accepted_ms = self->now_ms;
+  conn->heard_ms = self->now_ms;
+  conn->chat_ms = self->now_ms;
+  conn->pinged = FALSE;
+  conn->msg_tokens = burst_msgs;
+  conn->byte_tokens = burst_bytes;
+  conn->refill_ms = self->now_ms;
+  conn->throttled = FALSE;
+  wheel_timer_init(&conn->timer, connection_timeout, conn);
+  conn->chat_user->name[0] = '\0';
+  conn->chat_user->usocket = newsocket;
+  conn->chat_user->conn = conn;
+  conn->chat_user->registered = FALSE;
+  conn->chat_user->nrooms = 0;
+  conn->chat_user->active = NULL;
+  conn->chat_user->dropped = 0;
+  arm_timeout(conn);
+  return conn;
+}
+
+/*
+ * Function:  accept_connections()
+ * --------------------
+ * called by the event loop when its listening socket is readable, accepts
+ * every pending client and registers it with the event loop
+ *
+ * paramaters:
+ *   Reactor *self: the reactor whose listening socket is readable
+ *
+ *  returns: NULL
+ */
+void accept_connections(Reactor *self){
+  struct sockaddr_in clientaddr;
+  socklen_t addrlen;
+  struct epoll_event ev;
+  Connection *conn;
+  int newsocket;
+
+  while(1){
+    addrlen = sizeof(clientaddr);
+    newsocket = accept4(self->listenfd, (struct sockaddr *) &clientaddr, &addrlen,
+                        SOCK_NONBLOCK);
+    if(newsocket < 0){
+      if(errno == EINTR || errno == ECONNABORTED){
+        continue;
+      }
+      if(errno != EAGAIN && errno != EWOULDBLOCK){
+        perror("accept failed");
+      }
+      return;
+    }
+    if(!(conn = new_connection(self, newsocket))){
+      continue;
+    }
+
+    /* edge triggered EPOLLOUT only fires when a full socket drains, so it
+    can stay registered for the life of the connection */
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if(epoll_ctl(self->epollfd, EPOLL_CTL_ADD, newsocket, &ev) < 0){
+      perror("epoll_ctl failed");
+      close(newsocket);
+      pool_put(user_pool, conn->chat_user);
+      pool_put(conn_pool, conn);
+    }else{
+      stats_add(STAT_ACCEPTS, 1);
+    }
+  }
+}
+
+/*
+ * Function:  uring_accepted()
+ * --------------------
+ * called by the event loop for each completion of its multishot accept,
+ * sets up the client and starts a multishot receive on its socket
+ *
+ * paramaters:
+ *   Reactor *self: the reactor whose accept completed
+ *   int res: the client's socket, or minus the error
+ *   unsigned flags: the completion's flags
+ *
+ *  returns: NULL
+ */
+void uring_accepted(Reactor *self, int res, unsigned flags){
+  Connection *conn;
+
+  if(!(flags & IORING_CQE_F_MORE) &&
+     uring_accept(self->ring, self->listenfd, UD_ACCEPT) < 0){
+    printf("could not accept on reactor %d\n", self->id);
+  }
+  if(res < 0){
+    if(res != -ECONNABORTED && res != -EINTR){
+      errno = -res;
+      perror("accept failed");
+    }
+    return;
+  }
+  if(!(conn = new_connection(self, res))){
+    return;
+  }
+  if(uring_recv(self->ring, res, (unsigned long)conn | UD_RECV) < 0){
+    stats_add(STAT_READ_ERRORS, 1);
+    close(res);
+    pool_put(user_pool, conn->chat_user);
+    pool_put(conn_pool, conn);
+    return;
+  }
+  conn->inflight = 1;
+  stats_add(STAT_ACCEPTS, 1);
+}
+
+/*
+ * Function:  uring_received()
+ * --------------------
+ * called by the event loop for each completion of a connection's multishot
+ * receive, feeds the bytes to consume_input() and hands the buffer they
+ * were in back, the receive is started again if the kernel ended it
+ * without the client having gone
+ *
+ * paramaters:
+ *   Connection *conn: the connection the bytes arrived on
+ *   int res: the number of bytes, 0 at end of file, or minus the error
+ *   unsigned flags: the completion's flags
+ *
+ *  returns: NULL
+ */
+void uring_received(Connection *conn, int res, unsigned flags){
+  uring_t *ring = conn->reactor->ring;
+  char *buf = uring_buffer(ring, flags);
+
+  if(res > 0 && buf && !conn->closing){
+    consume_input(conn, buf, res);
+  }
+  uring_buffer_return(ring, flags);
+  if(flags & IORING_CQE_F_MORE){
+    return;
+  }
+  conn->inflight--;
+  if(conn->closed){
+    if(conn->inflight == 0){
+      release_connection(conn);
+    }
+    return;
+  }
+  if(conn->closing){
+    return;
+  }
+  /* running out of buffers ends the receive, they are back by now */
+  if(res == 0 || (res < 0 && res != -ENOBUFS) ||
+     uring_recv(ring, conn->csocket, (unsigned long)conn | UD_RECV) < 0){
+    if(res < 0 && res != -ENOBUFS && res != -ECONNRESET){
+      stats_add(STAT_READ_ERRORS, 1);
+    }
+    shutdown_connection(conn);
+    return;
+  }
+  conn->inflight++;
+}
+
+/*
+ * Function:  uring_sent()
+ * --------------------
+ * called by the event loop when a connection's send completes, drops the
+ * replies written in full and starts a send of whatever is left or was
+ * queued in the meantime
+ *
+ * paramaters:
+ *   Connection *conn: the connection written to
+ *   int res: the number of bytes written, or minus the error
+ *
+ *  returns: NULL
+ */
+void uring_sent(Connection *conn, int res){
+  outbuf_consume(&conn->outbuf, res > 0 ? (size_t)res : 0);
+  pool_put(send_pool, conn->send_op);
+  conn->send_op = NULL;
+  conn->blocked = FALSE;
+  conn->inflight--;
+  if(conn->closed){
+    if(conn->inflight == 0){
+      release_connection(conn);
+    }
+    return;
+  }
+  if(res < 0){
+    stats_add(STAT_SEND_ERRORS, 1);
+    shutdown_connection(conn);
+    return;
+  }
+  flush_connection(conn);
+}
+
+/*
+ * Function:  uring_harvest()
+ * --------------------
+ * takes every completion off a reactor's ring, sends are handled at once,
+ * so a connection's queue drains as soon as the kernel has written it, the
+ * rest wait in the backlog to be handled in order by the event loop
+ *
+ * paramaters:
+ *   Reactor *self: the reactor
+ *
+ *  returns: NULL
+ */
+void uring_harvest(Reactor *self){
+  struct io_uring_cqe *cqe;
+  Completion c;
+
+  while(self->backlog_count < URINGBACKLOG &&
+        (cqe = uring_peek(self->ring)) != NULL){
+    c.data = (unsigned long)cqe->user_data;
+    c.res = cqe->res;
+    c.flags = cqe->flags;
+    /* the slot is given back before handling, which may queue more */
+    uring_seen(self->ring);
+    if(c.data > UD_TAGS && (c.data & UD_TAGS) == UD_SEND){
+      uring_sent((Connection *)(c.data & ~(unsigned long)UD_TAGS), c.res);
+    }else{
+      self->backlog[(self->backlog_first + self->backlog_count++) %
+                    URINGBACKLOG] = c;
+    }
+  }
+}
+
+/*
+ * Function:  uring_push()
+ * --------------------
+ * called by conn_send() when a connection on io_uring is about to pass a
+ * high-water mark, starts its send if it is only waiting for the end of
+ * the pass, submits it and whatever else is queued, and harvests the
+ * completions, a send the socket had room for has completed by then
+ *
+ * paramaters:
+ *   Connection *conn: the connection
+ *
+ *  returns: 1 if some of its queue was written, 0 if not
+ */
+int uring_push(Connection *conn){
+  size_t pending = outbuf_pending(&conn->outbuf);
+
+  if(!conn->blocked){
+    flush_connection(conn);
+  }
+  if(uring_wait(conn->reactor->ring, 0) < 0){
+    return 0;
+  }
+  uring_harvest(conn->reactor);
+  return !conn->closing && outbuf_pending(&conn->outbuf) < pending;
+}
+
+/*
+ * Function:  uring_completed()
+ * --------------------
+ * hands a completion other than a send's, which uring_harvest() handles,
+ * to what it completes, its data says what that is
+ *
+ * paramaters:
+ *   Reactor *self: the reactor whose ring it came from
+ *   Completion *c: the completion
+ *
+ *  returns: NULL
+ */
+void uring_completed(Reactor *self, Completion *c){
+  unsigned long data = c->data;
+  Connection *conn = (Connection *)(data & ~(unsigned long)UD_TAGS);
+
+  if(data == 0){
+    /* a cancel, whatever it cancelled completes on its own */
+    return;
+  }
+  if(data == UD_ACCEPT){
+    uring_accepted(self, c->res, c->flags);
+  }else if(data == UD_WAKE){
+    deliver_mail(self);
+    if(!(c->flags & IORING_CQE_F_MORE) &&
+       uring_poll(self->ring, self->wakefd, UD_WAKE) < 0){
+      printf("could not wait for mail on reactor %d\n", self->id);
+    }
+  }else{
+    uring_received(conn, c->res, c->flags);
+  }
+}
+
+/*
+ * Function:  request_report()
+ * --------------------
+ * SIGUSR1 handler, asks the event loop to print the allocator counters
+ *
+ * paramaters:
+ *   int sig: the signal number
+ *
+ *  returns: NULL
+ */
+void request_report(int sig){
+  report_requested = 1;
+}
+
+/*
+ * Function:  raise_file_limit()
+ * --------------------
+ * raises the soft open file limit to the hard limit so the server can hold
+ * as many idle clients as the system allows
+ *
+ * paramaters: null
+ *
+ *  returns: NULL
+ */
+void raise_file_limit(void){
+  struct rlimit rl;
+
+  if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max){
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+
+/*
+ * Function:  open_listener()
+ * --------------------
+ * creates a non-blocking listening socket on the port, every reactor binds
+ * its own with SO_REUSEPORT so the kernel spreads new clients between them
+ * instead of every reactor waking for each one
+ *
+ * paramaters:
+ *   int port: the port to listen on
+ *   int backlog: the listen backlog
+ *
+ *  returns: int, the socket, -1 if not successful
+ */
+int open_listener(int port, int backlog){
+  struct sockaddr_in servaddr;
+  int listenfd, one = 1;
+
+  if ((listenfd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) <0) {
+       perror("Problem in creating the socket");
+       return -1;
+  }
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+  /* create the socket */
+  memset((char *) &servaddr, 0, sizeof(servaddr));
+  servaddr.sin_family = AF_INET;
+  servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  servaddr.sin_port = htons(port);
+
+  /* bind the socket to the address */
+  if (bind(listenfd, (struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+  	perror("bind failed");
+  	close(listenfd);
+  	return -1;
+  }
+
+  /* listen for incoming connections */
+  if(listen (listenfd, backlog) < 0){
+    perror("listening failed...\n");
+    close(listenfd);
+    return -1;
+  }
+  return listenfd;
+}
+
+/*
+ * Function:  open_reactor()
+ * --------------------
+ * sets up a reactor's listening socket, epoll instance, mailbox, wakeup
+ * eventfd, timers and scratch arena, the listening socket is the only epoll entry whose data is NULL
+ * and the wakeup is the only one whose data is the reactor itself, with
+ * use_uring an io_uring takes the place of the epoll instance, with a
+ * multishot accept and a multishot poll of the wakeup queued on it
+ *
+ * paramaters:
+ *   Reactor *r: the reactor to set up
+ *   int id: its index in reactors
+ *   int port: the port to listen on
+ *   int backlog: the listen backlog
+ *
+ *  returns: 0 if successful, -1 if not successful
+ */
+int open_reactor(Reactor *r, int id, int port, int backlog){
+  struct epoll_event ev;
+
+  r->id = id;
+  r->closing_list = NULL;
+  r->dirty_list = NULL;
+  r->wake_pending = FALSE;
+  r->mailbox = lqopen();
+  r->now_ms = stats_now_ns() / 1000000;
+  if(!(r->timers = wheel_open(TIMERTICKMS, r->now_ms))){
+    perror("could not create the timer wheel");
+    return -1;
+  }
+  if(!(r->scratch = arena_open(SCRATCHSIZE))){
+    perror("could not create the scratch arena");
+    return -1;
+  }
+  if((r->listenfd = open_listener(port, backlog)) < 0){
+    return -1;
+  }
+  if((r->epollfd = epoll_create1(0)) < 0 ||
+     (r->wakefd = eventfd(0, EFD_NONBLOCK)) < 0){
+    perror("could not create the event loop");
+    return -1;
+  }
+  if(use_uring){
+    r->backlog = (Completion *)malloc(URINGBACKLOG * sizeof(Completion));
+    r->backlog_first = 0;
+    r->backlog_count = 0;
+    if(!r->backlog ||
+       !(r->ring = uring_open(URINGENTRIES, URINGBUFS, URINGBUFSIZE)) ||
+       uring_accept(r->ring, r->listenfd, UD_ACCEPT) < 0 ||
+       uring_poll(r->ring, r->wakefd, UD_WAKE) < 0){
+      printf("io_uring with multishot receives and buffer rings is not "
+             "available\n");
+      return -1;
+    }
+    return 0;
+  }
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = NULL;
+  epoll_ctl(r->epollfd, EPOLL_CTL_ADD, r->listenfd, &ev);
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = r;
+  epoll_ctl(r->epollfd, EPOLL_CTL_ADD, r->wakefd, &ev);
+  return 0;
+}
+
+/*
+ * Function:  run_uring()
+ * --------------------
+ * the event loop of a reactor on io_uring, each pass submits every
+ * operation the last one queued, the sends of all its replies among them,
+ * in one io_uring_enter() that also waits for completions, and then
+ * handles the completions it harvested, completions harvested while they
+ * are handled wait for the next pass
+ *
+ * paramaters:
+ *   Reactor *self: the reactor to run
+ *
+ *  returns: NULL if the event loop fails
+ */
+void *run_uring(Reactor *self){
+  Completion c;
+  int n, res, timeout = -1;
+
+  while(1){
+    snap_offline(self->reader);
+    res = uring_wait(self->ring, self->backlog_count > 0 ? 0 : timeout);
+    snap_online(self->reader);
+    if(__atomic_exchange_n(&report_requested, 0, __ATOMIC_SEQ_CST)){
+      pool_report(stdout);
+      fflush(stdout);
+    }
+    if(res < 0){
+      perror("io_uring_enter failed");
+      return NULL;
+    }
+    self->now_ms = stats_now_ns() / 1000000;
+    uring_harvest(self);
+    for(n = self->backlog_count; n > 0; n--){
+      c = self->backlog[self->backlog_first];
+      self->backlog_first = (self->backlog_first + 1) % URINGBACKLOG;
+      self->backlog_count--;
+      uring_completed(self, &c);
+    }
+    run_timers(self);
+    do{
+      reap_connections(self);
+      timeout = flush_dirty(self);
+    }while(self->closing_list);
+    timeout = wait_timeout(self, timeout);
+    snap_quiescent(self->reader);
+    snap_reclaim();
+  }
+}
+
+/*
+ * Function:  run_reactor()
+ * --------------------
+ * the body of a reactor thread, pins itself to a core and then accepts and
+ * services its own clients until the server is stopped
+ *
+ * paramaters:
+ *   void *arg: the Reactor to run
+ *
+ *  returns: NULL if the event loop fails
+ */
+void *run_reactor(void *arg){
+  Reactor *self = (Reactor *)arg;
+  struct epoll_event events[MAXEVENTS];
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  cpu_set_t cpus;
+  int i, nready, timeout = -1;
+
+  if(ncpus > 0){
+    CPU_ZERO(&cpus);
+    CPU_SET(self->id % ncpus, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+  self->reader = snap_register();
+  if(self->ring){
+    return run_uring(self);
+  }
+
+  while(1){
+    /* sleeping in epoll_wait() must not hold up freeing old snapshots */
+    snap_offline(self->reader);
+    nready = epoll_wait(self->epollfd, events, MAXEVENTS, timeout);
+    snap_online(self->reader);
+    if(__atomic_exchange_n(&report_requested, 0, __ATOMIC_SEQ_CST)){
+      pool_report(stdout);
+      fflush(stdout);
+    }
+    if(nready < 0){
+      if(errno == EINTR){
+        continue;
+      }
+      perror("epoll_wait failed");
+      return NULL;
+    }
+    self->now_ms = stats_now_ns() / 1000000;
+    for(i = 0; i < nready; i++){
+      if(events[i].data.ptr == NULL){
+        accept_connections(self);
+      }else if(events[i].data.ptr == self){
+        deliver_mail(self);
+      }else{
+        if(events[i].events & EPOLLOUT){
+          write_connection((Connection *)events[i].data.ptr);
+        }
+        if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)){
+          read_connection((Connection *)events[i].data.ptr);
+        }
+      }
+    }
+    run_timers(self);
+    /* closing a connection can queue replies for others, and writing them
+    can find more connections to close */
+    do{
+      reap_connections(self);
+      timeout = flush_dirty(self);
+    }while(self->closing_list);
+    timeout = wait_timeout(self, timeout);
+    snap_quiescent(self->reader);
+    snap_reclaim();
+  }
+}
+
+
+/*
+ * Function:  parse_rate()
+ * --------------------
+ * reads a rate limit given as RATE or RATE,BURST, the burst is one second
+ * of the rate if it is not given
+ *
+ * paramaters:
+ *   const char *arg: the option's argument
+ *   double *rate: set to the rate per second
+ *   double *burst: set to the burst
+ *
+ *  returns: 0 if successful, -1 if the argument is not a rate
+ */
+int parse_rate(const char *arg, double *rate, double *burst){
+  double r, b;
+  int n = sscanf(arg, "%lf,%lf", &r, &b);
+
+  if(n < 1 || r < 0 || (n == 2 && b < 1)){
+    return -1;
+  }
+  *rate = r;
+  *burst = n == 2 ? b : r;
+  if(*burst < 1){
+    *burst = 1;
+  }
+  return 0;
+}
+
+/*
+ * Function:  read_secret()
+ * --------------------
+ * reads the secret linked servers share from the first line of a file, so it
+ * is not on the command line for everyone to see
+ *
+ * paramaters:
+ *   const char *path: the file
+ *   char *secret: filled in with the secret
+ *   int size: bytes secret has room for
+ *
+ *  returns: 0 if successful, -1 if the file could not be read or the secret
+ *          is empty
+ */
+int read_secret(const char *path, char *secret, int size){
+  FILE *f = fopen(path, "r");
+
+  if(!f){
+    return -1;
+  }
+  if(!fgets(secret, size, f)){
+    secret[0] = '\0';
+  }
+  fclose(f);
+  secret[strcspn(secret, "\r\n")] = '\0';
+  return secret[0] ? 0 : -1;
+}
+
+int main(int argc, char* argv[]){
+  int SERV_PORT = 0;
+  int backlog = LISTENQ;
+  char admin_path[ADDRLENGTH];
+  const char *admin = NULL;
+  const char *log_dir = NULL;
+  long sync_ms = LOGSYNCMS;
+  int i, opt;
+  long delay_us;
+  int node = 0, link_port = 0, npeers = 0, ntrusted = 0;
+  const char *peers[MAXREACTORS];
+  const char *trusted[MAXREACTORS];
+  const char *link_addr = "127.0.0.1";
+  const char *secret_file = NULL;
+  char secret[SECRETLENGTH] = "";
+
+  nreactors = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  while((opt = getopt(argc, argv, "r:b:a:d:c:q:n:p:l:f:i:w:k:t:m:B:N:P:L:A:S:T:")) != -1){
+    if(opt == 'r'){
+      nreactors = atoi(optarg);
+    }else if(opt == 'b'){
+      backlog = atoi(optarg);
+    }else if(opt == 'a'){
+      admin = optarg;
+    }else if(opt == 'd'){
+      delay_us = atol(optarg);
+      coalesce_delay_ns = delay_us > 0 ? (unsigned long)delay_us * 1000 : 0;
+    }else if(opt == 'c'){
+      coalesce_bytes = (size_t)atol(optarg);
+    }else if(opt == 'q' && atol(optarg) > 0){
+      highwater_bytes = (size_t)atol(optarg);
+    }else if(opt == 'n' && atol(optarg) > 0){
+      highwater_msgs = (size_t)atol(optarg);
+    }else if(opt == 'p' && strcmp(optarg, "disconnect") == 0){
+      slow_policy = POLICY_DISCONNECT;
+    }else if(opt == 'p' && strcmp(optarg, "oldest") == 0){
+      slow_policy = POLICY_DROP_OLDEST;
+    }else if(opt == 'p' && strcmp(optarg, "newest") == 0){
+      slow_policy = POLICY_DROP_NEWEST;
+    }else if(opt == 'l'){
+      log_dir = optarg;
+    }else if(opt == 'f'){
+      sync_ms = atol(optarg);
+    }else if(opt == 'i' && strcmp(optarg, "epoll") == 0){
+      use_uring = FALSE;
+    }else if(opt == 'i' && strcmp(optarg, "uring") == 0){
+      use_uring = TRUE;
+    }else if(opt == 'w' && atol(optarg) >= 0){
+      handshake_ms = (unsigned long)atol(optarg) * 1000;
+    }else if(opt == 'k' && atol(optarg) >= 0){
+      keepalive_ms = (unsigned long)atol(optarg) * 1000;
+    }else if(opt == 't' && atol(optarg) >= 0){
+      idle_ms = (unsigned long)atol(optarg) * 1000;
+    }else if(opt == 'm' && parse_rate(optarg, &rate_msgs, &burst_msgs) == 0){
+      /* the line limit is set */
+    }else if(opt == 'B' && parse_rate(optarg, &rate_bytes, &burst_bytes) == 0){
+      /* the byte limit is set */
+    }else if(opt == 'N'){
+      node = atoi(optarg);
+    }else if(opt == 'P'){
+      link_port = atoi(optarg);
+    }else if(opt == 'L' && npeers < MAXREACTORS){
+      peers[npeers++] = optarg;
+    }else if(opt == 'A'){
+      link_addr = optarg;
+    }else if(opt == 'S'){
+      secret_file = optarg;
+    }else if(opt == 'T' && ntrusted < MAXREACTORS){
+      trusted[ntrusted++] = optarg;
+    }else{
+      printf("usage: ./server [-r REACTORS] [-b BACKLOG] [-a ADMIN_SOCKET] "
+             "[-d DELAY_US] [-c COALESCE_BYTES] [-q HIGH_BYTES] "
+             "[-n HIGH_MSGS] [-p disconnect|oldest|newest] [-l LOG_DIR] "
+             "[-f SYNC_MS] [-i epoll|uring] [-w HELLO_S] [-k KEEPALIVE_S] "
+             "[-t IDLE_S] [-m MSGS_S[,BURST]] [-B BYTES_S[,BURST]] "
+             "[-N NODE_ID] [-P LINK_PORT] [-A LINK_ADDR] [-S SECRET_FILE] "
+             "[-T PEER_IP]... [-L IP:LINK_PORT]... PORT_NUM\n");
+      return(0);
+    }
+  }
+  if(argc - optind != 1){
+    printf("incorrect number of arguments.");
+    return(0);
+  }
+  SERV_PORT = atoi(argv[optind]);
+  if(!admin){
+    sprintf(admin_path, "/tmp/chatserver-%d.sock", SERV_PORT);
+    admin = admin_path;
+  }
+  if(nreactors < 1){
+    nreactors = 1;
+  }
+  if(nreactors > MAXREACTORS){
+    nreactors = MAXREACTORS;
+  }
+  /* the longest line must always fit in the byte bucket */
+  if(rate_bytes > 0 && burst_bytes < MAXLINE){
+    burst_bytes = MAXLINE;
+  }
+
+  users = lhopen(USERSLOTS);
+  if(register_commands() < 0){
+    printf("could not build the command table\n");
+    return(0);
+  }
+  /* lines from linked servers are recorded in a shard after the reactors' */
+  link_shard = nreactors;
+  rooms = roomdir_open(ROOMSLOTS, link_port ? nreactors + 1 : nreactors);
+  conn_pool = pool_open("connection", sizeof(Connection));
+  user_pool = pool_open("chatuser", sizeof(ChatUser));
+  mail_pool = pool_open("mail", sizeof(Mail));
+  send_pool = pool_open("send", sizeof(SendOp));
+  if(!(ping_frame = msgbuf_frame(OP_PING, 0, NULL, 0, NULL, 0))){
+    perror("out of memory");
+    return(0);
+  }
+  if(log_dir){
+    if(!(chat_log = chatlog_open(log_dir, sync_ms))){
+      return(0);
+    }
+    printf("logging chat lines to %s\n", log_dir);
+  }
+
+  /* clients that hang up mid-send should not kill the server */
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGUSR1, request_report);
+  raise_file_limit();
+
+  for(i = 0; i < nreactors; i++){
+    if(open_reactor(&reactors[i], i, SERV_PORT, backlog) < 0){
+      return 0;
+    }
+  }
+  printf("server listening for clients on %d %s reactors...\n", nreactors,
+         use_uring ? "io_uring" : "epoll");
+  if(stats_listen(admin) == 0){
+    printf("serving counters on %s\n", admin);
+  }
+  if(link_port){
+    if(secret_file && read_secret(secret_file, secret, sizeof(secret)) < 0){
+      printf("could not read a secret from %s\n", secret_file);
+      return(0);
+    }
+    if(!(federation = fed_open(node ? node : link_port, link_addr, link_port,
+                               secret, deliver_remote, NULL))){
+      printf("could not open the link port on %s, node ids are 1 to 65535\n",
+             link_addr);
+      return(0);
+    }
+    for(i = 0; i < ntrusted; i++){
+      if(fed_trust(federation, trusted[i]) < 0){
+        printf("invalid trusted peer %s, expected an IP address\n",
+               trusted[i]);
+        return(0);
+      }
+    }
+    for(i = 0; i < npeers; i++){
+      if(fed_peer(federation, peers[i]) < 0){
+        printf("invalid peer %s, expected IP:LINK_PORT\n", peers[i]);
+        return(0);
+      }
+    }
+    if(fed_start(federation) < 0){
+      return(0);
+    }
+    printf("node %d taking links on %s:%d\n", node ? node : link_port,
+           link_addr, link_port);
+  }
+
+  /* the main thread runs the first reactor itself */
+  for(i = 1; i < nreactors; i++){
+    if(pthread_create(&reactors[i].thread, NULL, run_reactor, &reactors[i]) != 0){
+      perror("could not start reactor");
+      exit(2);
+    }
   }
+  run_reactor(&reactors[0]);
 
   return(1);
 
@@ -0,0 +1,302 @@
+/*=============================================================================
+|   Title: snapshot.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements read-mostly sets published as immutable snapshots,
+|  see snapshot.h
+|
+|  replaced snapshots and deferred work wait on one FIFO retire list, each
+|  entry stamped with the global epoch it was retired at, an entry can go
+|  once every online reader has seen a later epoch and, for a snapshot, its
+|  last reference is gone, entries are reclaimed strictly in order so work
+|  deferred after a snapshot was replaced never runs before that snapshot
+|  is freed
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "snapshot.h"
+
+/* most threads that may read snapshots */
+#define MAXREADERS 64
+/* the epoch an offline reader reports, it holds up nothing */
+#define OFFLINE (~0UL)
+
+struct snap_reader_t{
+  unsigned long seen;
+  int used;
+  /* keep each reader's epoch on its own cache line */
+  char pad[64 - sizeof(unsigned long) - sizeof(int)];
+};
+
+struct snapset_t{
+  snapshot_t *current;
+  pthread_mutex_t write_lock;
+};
+
+/* a replaced snapshot, or a piece of deferred work */
+typedef struct retired_t{
+  unsigned long epoch;
+  snapshot_t *snap;
+  void (*fn)(void *arg);
+  void *arg;
+  struct retired_t *next;
+} retired_t;
+
+static snap_reader_t readers[MAXREADERS];
+static unsigned long global_epoch = 1;
+/* guards reader registration and the retire list */
+static pthread_mutex_t domain_lock = PTHREAD_MUTEX_INITIALIZER;
+static retired_t *retired_head;
+static retired_t *retired_tail;
+static int retired_count;
+
+/* register the calling thread as a reader */
+snap_reader_t *snap_register(void){
+  snap_reader_t *rp = NULL;
+  int i;
+
+  pthread_mutex_lock(&domain_lock);
+  for(i = 0; i < MAXREADERS; i++){
+    if(!readers[i].used){
+      rp = &readers[i];
+      rp->used = 1;
+      __atomic_store_n(&rp->seen, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST),
+                       __ATOMIC_SEQ_CST);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&domain_lock);
+  return rp;
+}
+
+/* report a quiescent state */
+void snap_quiescent(snap_reader_t *rp){
+  __atomic_store_n(&rp->seen, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST),
+                   __ATOMIC_SEQ_CST);
+}
+
+/* stop holding up reclamation while not reading */
+void snap_offline(snap_reader_t *rp){
+  __atomic_store_n(&rp->seen, OFFLINE, __ATOMIC_SEQ_CST);
+}
+
+/* start reading again */
+void snap_online(snap_reader_t *rp){
+  snap_quiescent(rp);
+}
+
+/* true once every online reader has seen epoch or a later one */
+static int grace_over(unsigned long epoch){
+  unsigned long seen;
+  int i;
+
+  for(i = 0; i < MAXREADERS; i++){
+    if(!__atomic_load_n(&readers[i].used, __ATOMIC_SEQ_CST)){
+      continue;
+    }
+    seen = __atomic_load_n(&readers[i].seen, __ATOMIC_SEQ_CST);
+    if(seen != OFFLINE && seen < epoch){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* put a snapshot or deferred work on the end of the retire list */
+static int retire(snapshot_t *snap, void (*fn)(void *arg), void *arg){
+  retired_t *r = (retired_t *)malloc(sizeof(retired_t));
+
+  if(!r){
+    return -1;
+  }
+  r->snap = snap;
+  r->fn = fn;
+  r->arg = arg;
+  r->next = NULL;
+
+  pthread_mutex_lock(&domain_lock);
+  r->epoch = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+  if(retired_tail){
+    retired_tail->next = r;
+  }else{
+    retired_head = r;
+  }
+  retired_tail = r;
+  __atomic_add_fetch(&retired_count, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&domain_lock);
+  return 0;
+}
+
+/* run fn(arg) after every snapshot replaced so far is gone */
+int snap_defer(void (*fn)(void *arg), void *arg){
+  return retire(NULL, fn, arg);
+}
+
+/* free what can be freed from the front of the retire list */
+void snap_reclaim(void){
+  retired_t *done = NULL, *done_tail = NULL, *r;
+
+  if(__atomic_load_n(&retired_count, __ATOMIC_SEQ_CST) == 0){
+    return;
+  }
+  pthread_mutex_lock(&domain_lock);
+  while(retired_head){
+    r = retired_head;
+    if(!grace_over(r->epoch) ||
+       (r->snap && __atomic_load_n(&r->snap->refs, __ATOMIC_SEQ_CST) > 0)){
+      break;
+    }
+    retired_head = r->next;
+    if(!retired_head){
+      retired_tail = NULL;
+    }
+    __atomic_sub_fetch(&retired_count, 1, __ATOMIC_SEQ_CST);
+    r->next = NULL;
+    if(done_tail){
+      done_tail->next = r;
+    }else{
+      done = r;
+    }
+    done_tail = r;
+  }
+  pthread_mutex_unlock(&domain_lock);
+
+  /* deferred work may defer more work, so run it without the lock */
+  while(done){
+    r = done;
+    done = r->next;
+    if(r->snap){
+      free(r->snap);
+    }else{
+      r->fn(r->arg);
+    }
+    free(r);
+  }
+}
+
+/* allocate a snapshot with room for count items, holding one reference */
+static snapshot_t *snapshot_alloc(int count){
+  snapshot_t *snap = (snapshot_t *)malloc(sizeof(snapshot_t) +
+                                          sizeof(void *) * (count ? count : 1));
+
+  if(!snap){
+    return NULL;
+  }
+  snap->refs = 1;
+  snap->count = count;
+  snap->items = (void **)(snap + 1);
+  return snap;
+}
+
+/* create a set whose current snapshot is empty */
+snapset_t *snapset_open(void){
+  snapset_t *sp = (snapset_t *)malloc(sizeof(snapset_t));
+
+  if(!sp){
+    return NULL;
+  }
+  sp->current = snapshot_alloc(0);
+  if(!sp->current){
+    free(sp);
+    return NULL;
+  }
+  pthread_mutex_init(&sp->write_lock, NULL);
+  return sp;
+}
+
+/* deallocate a set */
+void snapset_close(snapset_t *sp){
+  free(sp->current);
+  pthread_mutex_destroy(&sp->write_lock);
+  free(sp);
+}
+
+/*
+ * take a reference to the current snapshot, the snapshot cannot be freed
+ * between the load and the increment because the caller has not passed a
+ * quiescent state since the load
+ */
+snapshot_t *snapset_acquire(snapset_t *sp){
+  snapshot_t *snap = __atomic_load_n(&sp->current, __ATOMIC_SEQ_CST);
+
+  __atomic_add_fetch(&snap->refs, 1, __ATOMIC_SEQ_CST);
+  return snap;
+}
+
+/* drop a reference, the snapshot itself is freed by snap_reclaim() */
+void snapshot_release(snapshot_t *snap){
+  __atomic_sub_fetch(&snap->refs, 1, __ATOMIC_SEQ_CST);
+}
+
+/* swap in a new snapshot and retire the old one, write_lock is held */
+static void publish(snapset_t *sp, snapshot_t *next){
+  snapshot_t *old = __atomic_exchange_n(&sp->current, next, __ATOMIC_SEQ_CST);
+
+  /* if the old snapshot cannot be tracked, leaking it is the only safe
+  choice, otherwise drop the reference the set held */
+  if(retire(old, NULL, NULL) == 0){
+    snapshot_release(old);
+  }
+}
+
+/* publish a copy of the current snapshot with item appended */
+int snapset_add(snapset_t *sp, void *item){
+  snapshot_t *cur, *next;
+
+  pthread_mutex_lock(&sp->write_lock);
+  cur = sp->current;
+  next = snapshot_alloc(cur->count + 1);
+  if(!next){
+    pthread_mutex_unlock(&sp->write_lock);
+    return -1;
+  }
+  memcpy(next->items, cur->items, sizeof(void *) * cur->count);
+  next->items[cur->count] = item;
+  publish(sp, next);
+  pthread_mutex_unlock(&sp->write_lock);
+
+  snap_reclaim();
+  return 0;
+}
+
+/* publish a copy of the current snapshot without item */
+int snapset_remove(snapset_t *sp, void *item){
+  snapshot_t *cur, *next;
+  int i, j;
+
+  pthread_mutex_lock(&sp->write_lock);
+  cur = sp->current;
+  for(i = 0; i < cur->count && cur->items[i] != item; i++){
+  }
+  if(i == cur->count){
+    pthread_mutex_unlock(&sp->write_lock);
+    return 1;
+  }
+  next = snapshot_alloc(cur->count - 1);
+  if(!next){
+    pthread_mutex_unlock(&sp->write_lock);
+    return -1;
+  }
+  for(i = 0, j = 0; i < cur->count; i++){
+    if(cur->items[i] != item){
+      next->items[j++] = cur->items[i];
+    }
+  }
+  publish(sp, next);
+  pthread_mutex_unlock(&sp->write_lock);
+
+  snap_reclaim();
+  return 0;
+}
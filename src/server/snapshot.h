@@ -0,0 +1,197 @@
+/*=============================================================================
+|   Title: snapshot.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements read-mostly sets published as immutable,
+|  reference counted snapshots, in the style of RCU
+|
+|  readers grab the current snapshot of a set without taking any lock and
+|  walk it for as long as they like, writers copy the current snapshot,
+|  change the copy and publish it with one atomic swap, so a reader never
+|  waits on a writer and a writer never waits on a reader's I/O
+|
+|  an old snapshot is freed once it has no holders and every registered
+|  reader thread has passed a quiescent state since it was replaced, work
+|  handed to snap_defer() is run under the same rules, in order, which is how
+|  the server frees connections that an older snapshot may still point to
+|
+|  a thread must be registered with snap_register() before it acquires a
+|  snapshot, and must report quiescent states (points where it holds no
+|  pointer it got from a set without a reference) with snap_quiescent()
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* snapshot.h -- public interface to the snapshot module
+*/
+
+/* an immutable array of items, only read after it has been published */
+typedef struct snapshot_t{
+  int refs;
+  int count;
+  void **items;
+} snapshot_t;
+
+/* the set representation is hidden from users of the module */
+typedef struct snapset_t snapset_t;
+
+/* a registered reader thread, the representation is hidden */
+typedef struct snap_reader_t snap_reader_t;
+
+/*
+* Function:  snap_register()
+* --------------------
+* registers the calling thread as a reader, it starts out online
+*
+* paramaters: null
+*
+*  returns: snap_reader_t*, the thread's reader record, NULL if too many
+*           readers are registered
+*/
+snap_reader_t *snap_register(void);
+
+/*
+* Function:  snap_quiescent()
+* --------------------
+* reports that the reader holds no unreferenced pointers into any snapshot
+*
+* paramaters:
+*  snap_reader_t *rp: the calling thread's reader record
+*
+*  returns: NULL
+*/
+void snap_quiescent(snap_reader_t *rp);
+
+/*
+* Function:  snap_offline()
+* --------------------
+* marks a reader as not reading at all, for example while it sleeps in
+* epoll_wait(), so it does not hold up reclamation
+*
+* paramaters:
+*  snap_reader_t *rp: the calling thread's reader record
+*
+*  returns: NULL
+*/
+void snap_offline(snap_reader_t *rp);
+
+/*
+* Function:  snap_online()
+* --------------------
+* brings an offline reader back, this is also a quiescent state
+*
+* paramaters:
+*  snap_reader_t *rp: the calling thread's reader record
+*
+*  returns: NULL
+*/
+void snap_online(snap_reader_t *rp);
+
+/*
+* Function:  snap_defer()
+* --------------------
+* runs fn(arg) once every snapshot replaced before this call has been freed,
+* so nothing reachable from an old snapshot is freed too early
+*
+* paramaters:
+*  void (*fn)(void *arg): the work to run later
+*  void *arg: passed through to fn
+*
+*  returns: 0 if successful, -1 if out of memory (fn is not run)
+*/
+int snap_defer(void (*fn)(void *arg), void *arg);
+
+/*
+* Function:  snap_reclaim()
+* --------------------
+* frees replaced snapshots and runs deferred work whose grace period is over,
+* cheap when there is nothing to do
+*
+* paramaters: null
+*
+*  returns: NULL
+*/
+void snap_reclaim(void);
+
+/*
+* Function:  snapset_open()
+* --------------------
+* create a set whose current snapshot is empty
+*
+* paramaters: null
+*
+*  returns: snapset_t*, an open set, NULL if out of memory
+*/
+snapset_t *snapset_open(void);
+
+/*
+* Function:  snapset_close()
+* --------------------
+* deallocate a set, the caller makes sure no reader is still using it
+*
+* paramaters:
+*  snapset_t *sp: the set to close
+*
+*  returns: NULL
+*/
+void snapset_close(snapset_t *sp);
+
+/*
+* Function:  snapset_acquire()
+* --------------------
+* takes a reference to the set's current snapshot, never blocks
+*
+* paramaters:
+*  snapset_t *sp: the set to read
+*
+*  returns: snapshot_t*, the snapshot, give it back with snapshot_release()
+*/
+snapshot_t *snapset_acquire(snapset_t *sp);
+
+/*
+* Function:  snapshot_release()
+* --------------------
+* drops a reference taken by snapset_acquire()
+*
+* paramaters:
+*  snapshot_t *snap: the snapshot to give back
+*
+*  returns: NULL
+*/
+void snapshot_release(snapshot_t *snap);
+
+/*
+* Function:  snapset_add()
+* --------------------
+* publishes a new snapshot with item appended, writers are serialized with
+* each other but never wait for readers
+*
+* paramaters:
+*  snapset_t *sp: the set to change
+*  void *item: the item to add
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int snapset_add(snapset_t *sp, void *item);
+
+/*
+* Function:  snapset_remove()
+* --------------------
+* publishes a new snapshot without item
+*
+* paramaters:
+*  snapset_t *sp: the set to change
+*  void *item: the item to remove
+*
+*  returns: 0 if removed, 1 if item was not in the set, -1 if not successful
+*/
+int snapset_remove(snapset_t *sp, void *item);
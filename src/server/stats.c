@@ -0,0 +1,355 @@
+/*=============================================================================
+|   Title: stats.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the server's live counters and latency
+|  histograms, see stats.h
+|
+|  each of the first STATS_MAXTHREADS - 1 threads to count owns a slot and
+|  updates it with a plain load and store, threads past those share the last
+|  slot and update it with atomic adds, histograms keep 3 bits of precision
+|  in each power of two, so a percentile is within an eighth of the truth
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "pool.h"
+#include "stats.h"
+
+/* threads with a slot of their own */
+#define STATS_MAXTHREADS 64
+#define SUBBITS 3
+#define SUBBUCKETS (1 << SUBBITS)
+#define HISTBUCKETS (64 * SUBBUCKETS)
+/* most pools listed in a snapshot */
+#define STATS_MAXPOOLS 32
+/* bytes of snapshot the admin socket serves */
+#define SNAPSHOTSIZE 65536
+
+typedef struct stats_slot_t{
+  unsigned long counters[STAT_NCOUNTERS];
+  unsigned long buckets[STAT_NHISTS][HISTBUCKETS];
+  unsigned long max[STAT_NHISTS];
+  /* keep each thread's counters off its neighbours' cache lines */
+  char pad[64];
+} stats_slot_t;
+
+/* a histogram added up over every slot */
+typedef struct stats_hist_t{
+  unsigned long buckets[HISTBUCKETS];
+  unsigned long count;
+  unsigned long max;
+} stats_hist_t;
+
+static const char *counter_names[STAT_NCOUNTERS] = {
+  "accepts", "closes", "joins", "leaves", "msgs_in", "msgs_out", "bytes_in",
+  "bytes_out", "send_errors", "slow_drops", "flushes",
+  "msgs_dropped", "log_records", "log_writes", "log_syncs", "log_drops",
+  "msgs_direct", "pings", "timeouts", "link_msgs_out", "link_msgs_in",
+  "heap_allocs", "msgs_throttled", "throttles",
+  "presence", "read_errors", "conns_leaked",
+  "links_refused"
+};
+static const char *hist_names[STAT_NHISTS] = {"fanout_ns", "outq_bytes"};
+
+static stats_slot_t slots[STATS_MAXTHREADS];
+static __thread int my_slot = -1;
+static int next_slot;
+static char snapshot[SNAPSHOTSIZE];
+
+/* the calling thread's slot */
+static int thread_slot(void){
+  if(my_slot == -1){
+    my_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+    if(my_slot >= STATS_MAXTHREADS - 1){
+      my_slot = STATS_MAXTHREADS - 1;
+    }
+  }
+  return my_slot;
+}
+
+/* add to a slot's value, only the shared slot needs an atomic add */
+static void bump(int slot, unsigned long *p, unsigned long n){
+  if(slot == STATS_MAXTHREADS - 1){
+    __atomic_add_fetch(p, n, __ATOMIC_RELAXED);
+  }else{
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+  }
+}
+
+/* the bucket a value falls in */
+static int bucket_of(unsigned long v){
+  int msb;
+
+  if(v < SUBBUCKETS){
+    return (int)v;
+  }
+  msb = 63 - __builtin_clzl(v);
+  return (msb - SUBBITS + 1) * SUBBUCKETS +
+         (int)((v >> (msb - SUBBITS)) & (SUBBUCKETS - 1));
+}
+
+/* the smallest value in a bucket */
+static unsigned long bucket_value(int bucket){
+  if(bucket < SUBBUCKETS){
+    return bucket;
+  }
+  return (unsigned long)(SUBBUCKETS + bucket % SUBBUCKETS) <<
+         (bucket / SUBBUCKETS - 1);
+}
+
+/* add to one of the calling thread's counters */
+void stats_add(int counter, unsigned long n){
+  int slot = thread_slot();
+
+  bump(slot, &slots[slot].counters[counter], n);
+}
+
+/* count a value in one of the calling thread's histograms */
+void stats_record(int hist, unsigned long value){
+  int slot = thread_slot();
+  unsigned long *max = &slots[slot].max[hist];
+
+  bump(slot, &slots[slot].buckets[hist][bucket_of(value)], 1);
+  if(value > __atomic_load_n(max, __ATOMIC_RELAXED)){
+    __atomic_store_n(max, value, __ATOMIC_RELAXED);
+  }
+}
+
+/* nanoseconds on the monotonic clock */
+unsigned long stats_now_ns(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* add up one histogram over every slot */
+static void sum_hist(int hist, stats_hist_t *h){
+  unsigned long n, max;
+  int i, b;
+
+  memset(h, 0, sizeof(stats_hist_t));
+  for(i = 0; i < STATS_MAXTHREADS; i++){
+    for(b = 0; b < HISTBUCKETS; b++){
+      n = __atomic_load_n(&slots[i].buckets[hist][b], __ATOMIC_RELAXED);
+      h->buckets[b] += n;
+      h->count += n;
+    }
+    max = __atomic_load_n(&slots[i].max[hist], __ATOMIC_RELAXED);
+    if(max > h->max){
+      h->max = max;
+    }
+  }
+}
+
+/* the value below which a fraction p of the counted values fall */
+static unsigned long percentile(stats_hist_t *h, double p){
+  unsigned long target = (unsigned long)(p * h->count + 0.5), seen = 0;
+  int b;
+
+  if(h->count == 0){
+    return 0;
+  }
+  if(target == 0){
+    target = 1;
+  }
+  for(b = 0; b < HISTBUCKETS; b++){
+    seen += h->buckets[b];
+    if(seen >= target){
+      return bucket_value(b);
+    }
+  }
+  return h->max;
+}
+
+/* append to a snapshot, quietly stopping once it is full */
+static void put(char *buf, size_t size, size_t *len, const char *fmt, ...){
+  va_list ap;
+  int n;
+
+  if(*len + 1 >= size){
+    return;
+  }
+  va_start(ap, fmt);
+  n = vsnprintf(buf + *len, size - *len, fmt, ap);
+  va_end(ap);
+  if(n > 0){
+    *len += (size_t)n < size - *len ? (size_t)n : size - *len - 1;
+  }
+}
+
+/* add up every thread's counters and format them with the pool counters */
+int stats_format(char *buf, size_t size, int format){
+  unsigned long counters[STAT_NCOUNTERS];
+  pool_stats_t pools[STATS_MAXPOOLS];
+  stats_hist_t h;
+  size_t len = 0;
+  int json = format == STATS_JSON;
+  int i, c, npools;
+
+  if(size == 0){
+    return 0;
+  }
+  buf[0] = '\0';
+  for(c = 0; c < STAT_NCOUNTERS; c++){
+    counters[c] = 0;
+    for(i = 0; i < STATS_MAXTHREADS; i++){
+      counters[c] += __atomic_load_n(&slots[i].counters[c], __ATOMIC_RELAXED);
+    }
+  }
+
+  put(buf, size, &len, json ? "{\"time\":%ld,\"connections\":%ld,\"counters\":{"
+                            : "time %ld\nconnections %ld\n",
+      (long)time(NULL), (long)(counters[STAT_ACCEPTS] - counters[STAT_CLOSES]));
+  for(c = 0; c < STAT_NCOUNTERS; c++){
+    put(buf, size, &len, json ? "%s\"%s\":%lu" : "%s%s %lu\n",
+        json && c > 0 ? "," : "", counter_names[c], counters[c]);
+  }
+
+  if(json){
+    put(buf, size, &len, "},\"histograms\":{");
+  }
+  for(c = 0; c < STAT_NHISTS; c++){
+    sum_hist(c, &h);
+    put(buf, size, &len, json ? "%s\"%s\":{\"count\":%lu,\"p50\":%lu,"
+                                "\"p99\":%lu,\"p999\":%lu,\"max\":%lu}"
+                              : "%s%s count %lu p50 %lu p99 %lu p999 %lu max %lu\n",
+        json && c > 0 ? "," : "", hist_names[c], h.count,
+        percentile(&h, 0.50), percentile(&h, 0.99), percentile(&h, 0.999),
+        h.max);
+  }
+
+  npools = pool_stats_all(pools, STATS_MAXPOOLS);
+  if(json){
+    put(buf, size, &len, "},\"pools\":[");
+  }
+  for(i = 0; i < npools; i++){
+    put(buf, size, &len, json ? "%s{\"name\":\"%s\",\"objsize\":%lu,"
+                                "\"in_use\":%ld,\"hits\":%lu,\"refills\":%lu,"
+                                "\"misses\":%lu,\"resident_bytes\":%lu}"
+                              : "%spool %s objsize %lu in_use %ld hits %lu "
+                                "refills %lu misses %lu resident_bytes %lu\n",
+        json && i > 0 ? "," : "", pools[i].name,
+        (unsigned long)pools[i].objsize, pools[i].in_use, pools[i].hits,
+        pools[i].refills, pools[i].misses,
+        (unsigned long)pools[i].resident_bytes);
+  }
+  if(json){
+    put(buf, size, &len, "]}\n");
+  }
+  return (int)len;
+}
+
+/* body of the admin thread, serves one snapshot per connection */
+static void *serve(void *arg){
+  int listenfd = *(int *)arg;
+  struct timeval timeout;
+  char request[64];
+  ssize_t n, got, sent;
+  int fd, len;
+
+  free(arg);
+  timeout.tv_sec = 1;
+  timeout.tv_usec = 0;
+  while(1){
+    fd = accept(listenfd, NULL, NULL);
+    if(fd < 0){
+      if(errno != EINTR){
+        perror("admin accept failed");
+      }
+      continue;
+    }
+    /* a client that says nothing gets text after the timeout, and one that
+    never reads is given up on after it, so no client holds the thread */
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    got = 0;
+    while(got < (ssize_t)sizeof(request) - 1 &&
+          (n = recv(fd, request + got, sizeof(request) - 1 - got, 0)) > 0){
+      got += n;
+      if(memchr(request, '\n', got)){
+        break;
+      }
+    }
+    request[got > 0 ? got : 0] = '\0';
+    len = stats_format(snapshot, sizeof(snapshot),
+                       strncmp(request, "json", 4) == 0 ? STATS_JSON : STATS_TEXT);
+    for(sent = 0; sent < len; sent += n){
+      if((n = send(fd, snapshot + sent, len - sent, MSG_NOSIGNAL)) <= 0){
+        break;
+      }
+    }
+    close(fd);
+  }
+  return NULL;
+}
+
+/* start the admin thread on a unix socket only its owner can connect to */
+int stats_listen(const char *path){
+  struct sockaddr_un addr;
+  struct stat st;
+  pthread_t thread;
+  mode_t mask;
+  int *listenfd, bound = -1;
+
+  if(strlen(path) >= sizeof(addr.sun_path)){
+    return -1;
+  }
+  listenfd = (int *)malloc(sizeof(int));
+  if(!listenfd){
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  /* only an old socket is replaced, never a file someone put there */
+  if(lstat(path, &st) == 0 && (!S_ISSOCK(st.st_mode) || unlink(path) < 0)){
+    fprintf(stderr, "could not open the admin socket, %s is in the way\n",
+            path);
+    free(listenfd);
+    return -1;
+  }
+  if((*listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0){
+    /* connecting needs write permission, so the owner alone can read the
+    counters, the socket is made that way rather than changed after */
+    mask = umask(0177);
+    bound = bind(*listenfd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+  }
+  if(*listenfd < 0 || bound < 0 ||
+     listen(*listenfd, 16) < 0 ||
+     pthread_create(&thread, NULL, serve, listenfd) != 0){
+    perror("could not open the admin socket");
+    if(*listenfd >= 0){
+      close(*listenfd);
+    }
+    free(listenfd);
+    return -1;
+  }
+  pthread_detach(thread);
+  return 0;
+}
@@ -0,0 +1,145 @@
+/*=============================================================================
+|   Title: stats.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the server's live counters and latency
+|  histograms, every thread counts into its own slot with plain stores, so
+|  counting costs no lock and no shared cache line, the slots are only added
+|  up when somebody asks for a snapshot
+|
+|  a snapshot can be formatted as text or JSON, and stats_listen() serves one
+|  to anybody who connects to a local unix socket, from its own thread so
+|  scraping never runs on an event loop
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* stats.h -- public interface to the stats module
+*/
+
+#include <stddef.h>
+
+/* counters */
+#define STAT_ACCEPTS 0
+#define STAT_CLOSES 1
+#define STAT_JOINS 2
+#define STAT_LEAVES 3
+#define STAT_MSGS_IN 4
+#define STAT_MSGS_OUT 5
+#define STAT_BYTES_IN 6
+#define STAT_BYTES_OUT 7
+#define STAT_SEND_ERRORS 8
+#define STAT_SLOW_DROPS 9
+#define STAT_FLUSHES 10
+#define STAT_MSGS_DROPPED 11
+#define STAT_LOG_RECORDS 12
+#define STAT_LOG_WRITES 13
+#define STAT_LOG_SYNCS 14
+#define STAT_LOG_DROPS 15
+#define STAT_MSGS_DIRECT 16
+#define STAT_PINGS 17
+#define STAT_TIMEOUTS 18
+#define STAT_LINK_OUT 19
+#define STAT_LINK_IN 20
+/* malloc(), calloc() and realloc() calls made by the server's own code */
+#define STAT_HEAP_ALLOCS 21
+/* lines dropped for being over a client's rate limit, and the spells of
+them, each of which the client is told about once */
+#define STAT_THROTTLED_MSGS 22
+#define STAT_THROTTLES 23
+/* joins and leaves the rest of a room was told about */
+#define STAT_PRESENCE 24
+/* reads that failed with anything but a reset, and connections whose
+memory could not be handed to the snapshot reclaimer and was leaked */
+#define STAT_READ_ERRORS 25
+#define STAT_CONNS_LEAKED 26
+/* links dropped for a hello without the secret or from an untrusted address */
+#define STAT_LINKS_REFUSED 27
+#define STAT_NCOUNTERS 28
+
+/* histograms */
+#define HIST_FANOUT_NS 0
+#define HIST_OUTQ_BYTES 1
+#define STAT_NHISTS 2
+
+/* output formats */
+#define STATS_TEXT 0
+#define STATS_JSON 1
+
+/*
+* Function:  stats_add()
+* --------------------
+* adds to one of the calling thread's counters
+*
+* paramaters:
+*  int counter: one of the STAT_ counters
+*  unsigned long n: the amount to add
+*
+*  returns: NULL
+*/
+void stats_add(int counter, unsigned long n);
+
+/*
+* Function:  stats_record()
+* --------------------
+* counts a value in one of the calling thread's histograms
+*
+* paramaters:
+*  int hist: one of the HIST_ histograms
+*  unsigned long value: the value to count
+*
+*  returns: NULL
+*/
+void stats_record(int hist, unsigned long value);
+
+/*
+* Function:  stats_now_ns()
+* --------------------
+* reads the monotonic clock, for timing what goes into a histogram
+*
+* paramaters: null
+*
+*  returns: unsigned long, nanoseconds since an arbitrary point
+*/
+unsigned long stats_now_ns(void);
+
+/*
+* Function:  stats_format()
+* --------------------
+* adds up every thread's counters and histograms and formats them, with the
+* object pool counters, the numbers may be slightly stale while other
+* threads are busy
+*
+* paramaters:
+*  char *buf: where to write the snapshot
+*  size_t size: the size of buf, the snapshot is cut short to fit
+*  int format: STATS_TEXT or STATS_JSON
+*
+*  returns: int, the length of the snapshot written
+*/
+int stats_format(char *buf, size_t size, int format);
+
+/*
+* Function:  stats_listen()
+* --------------------
+* starts a thread that serves snapshots on a unix socket, a client connects,
+* optionally writes "json" or "text" and a newline, and gets a snapshot back
+* before the socket is closed
+*
+* paramaters:
+*  const char *path: where to create the socket, only the server's user may
+*        connect to it, an old socket there is replaced, anything else
+*        there is left alone and the call fails
+*
+*  returns: 0 if successful, -1 if not successful
+*/
+int stats_listen(const char *path);
@@ -0,0 +1,353 @@
+/*=============================================================================
+|   Title: uring.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements the io_uring wrapper, see uring.h
+|
+|  the submission and completion rings are shared with the kernel, entries
+|  are written before the tail that publishes them is stored with release
+|  ordering, and a tail the kernel published is loaded with acquire
+|  ordering before the entries behind it are read, the submission array is
+|  filled in once so slot i always holds entry i
+|
+*===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/time_types.h>
+
+#include "uring.h"
+
+/* the buffer group receives pick from */
+#define URING_BGID 0
+
+struct uring_t{
+  int fd;
+  /* the mapping both rings live in */
+  void *rings;
+  size_t rings_size;
+  /* the submission ring, tail counts entries queued but maybe not
+  published, which uring_wait() does */
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned tail;
+  struct io_uring_sqe *sqes;
+  /* the completion ring */
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe *cqes;
+  /* the receive buffers and the ring that hands them to the kernel */
+  struct io_uring_buf_ring *br;
+  size_t br_size;
+  unsigned short br_tail;
+  unsigned nbufs;
+  char *bufs;
+  size_t bufsize;
+};
+
+/* hand a buffer to the kernel, published by storing the tail */
+static void add_buffer(uring_t *ring, unsigned short bid){
+  struct io_uring_buf *buf = &ring->br->bufs[ring->br_tail & (ring->nbufs - 1)];
+
+  buf->addr = (unsigned long)(ring->bufs + bid * ring->bufsize);
+  buf->len = ring->bufsize;
+  buf->bid = bid;
+  ring->br_tail++;
+  __atomic_store_n(&ring->br->tail, ring->br_tail, __ATOMIC_RELEASE);
+}
+
+/* map the receive buffers and register them as buffer group URING_BGID */
+static int register_buffers(uring_t *ring, unsigned nbufs, size_t bufsize){
+  struct io_uring_buf_reg reg;
+  unsigned i;
+
+  ring->nbufs = nbufs;
+  ring->bufsize = bufsize;
+  ring->br_size = nbufs * sizeof(struct io_uring_buf);
+  ring->br = (struct io_uring_buf_ring *)mmap(NULL, ring->br_size,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS,
+                                              -1, 0);
+  if(ring->br == MAP_FAILED){
+    ring->br = NULL;
+    return -1;
+  }
+  if(!(ring->bufs = (char *)malloc(nbufs * bufsize))){
+    return -1;
+  }
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (unsigned long)ring->br;
+  reg.ring_entries = nbufs;
+  reg.bgid = URING_BGID;
+  if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING,
+             &reg, 1) < 0){
+    return -1;
+  }
+  for(i = 0; i < nbufs; i++){
+    add_buffer(ring, (unsigned short)i);
+  }
+  return 0;
+}
+
+/* create the ring and map what it shares with the kernel */
+uring_t *uring_open(unsigned entries, unsigned nbufs, size_t bufsize){
+  struct io_uring_params p;
+  uring_t *ring = (uring_t *)calloc(1, sizeof(uring_t));
+  size_t sq_size, cq_size;
+  unsigned *array, i;
+  char *base;
+
+  if(!ring){
+    return NULL;
+  }
+  ring->fd = -1;
+  /* room for completions to pile up while a batch is handled, task work
+  only needs to run when the loop enters the kernel anyway */
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+  p.cq_entries = entries * 4;
+  if((ring->fd = syscall(__NR_io_uring_setup, entries, &p)) < 0 &&
+     errno == EINVAL){
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+  }
+  if(ring->fd < 0 || !(p.features & IORING_FEAT_SINGLE_MMAP) ||
+     !(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)){
+    uring_close(ring);
+    return NULL;
+  }
+
+  sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->rings_size = sq_size > cq_size ? sq_size : cq_size;
+  ring->rings = mmap(NULL, ring->rings_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if(ring->rings == MAP_FAILED){
+    ring->rings = NULL;
+    uring_close(ring);
+    return NULL;
+  }
+  ring->sqes = (struct io_uring_sqe *)mmap(NULL,
+                   p.sq_entries * sizeof(struct io_uring_sqe),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring->fd, IORING_OFF_SQES);
+  if(ring->sqes == MAP_FAILED){
+    ring->sqes = NULL;
+    uring_close(ring);
+    return NULL;
+  }
+  ring->sq_entries = p.sq_entries;
+  base = (char *)ring->rings;
+  ring->sq_head = (unsigned *)(base + p.sq_off.head);
+  ring->sq_tail = (unsigned *)(base + p.sq_off.tail);
+  ring->sq_mask = *(unsigned *)(base + p.sq_off.ring_mask);
+  ring->tail = *ring->sq_tail;
+  array = (unsigned *)(base + p.sq_off.array);
+  for(i = 0; i < p.sq_entries; i++){
+    array[i] = i;
+  }
+  ring->cq_head = (unsigned *)(base + p.cq_off.head);
+  ring->cq_tail = (unsigned *)(base + p.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(base + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(base + p.cq_off.cqes);
+
+  if(register_buffers(ring, nbufs, bufsize) < 0){
+    uring_close(ring);
+    return NULL;
+  }
+  return ring;
+}
+
+/* unmap everything, closing the descriptor cancels what is outstanding */
+void uring_close(uring_t *ring){
+  if(ring->fd >= 0){
+    close(ring->fd);
+  }
+  if(ring->rings){
+    munmap(ring->rings, ring->rings_size);
+  }
+  if(ring->sqes){
+    munmap(ring->sqes, ring->sq_entries * sizeof(struct io_uring_sqe));
+  }
+  if(ring->br){
+    munmap(ring->br, ring->br_size);
+  }
+  free(ring->bufs);
+  free(ring);
+}
+
+/* pass everything queued to the kernel, waiting for wait_nr completions */
+static int enter(uring_t *ring, unsigned wait_nr, int timeout_ms){
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  unsigned flags = IORING_ENTER_EXT_ARG, submit;
+  long ret;
+
+  __atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+  submit = ring->tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  memset(&arg, 0, sizeof(arg));
+  if(wait_nr > 0){
+    flags |= IORING_ENTER_GETEVENTS;
+    if(timeout_ms >= 0){
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+      arg.ts = (unsigned long)&ts;
+    }
+  }
+  ret = syscall(__NR_io_uring_enter, ring->fd, submit, wait_nr, flags, &arg,
+                sizeof(arg));
+  if(ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY &&
+     errno != EAGAIN){
+    return -1;
+  }
+  return 0;
+}
+
+/* claim a zeroed submission entry, submitting to make room if need be */
+static struct io_uring_sqe *get_sqe(uring_t *ring){
+  struct io_uring_sqe *sqe;
+
+  if(ring->tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+     ring->sq_entries){
+    enter(ring, 0, -1);
+    if(ring->tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+       ring->sq_entries){
+      return NULL;
+    }
+  }
+  sqe = &ring->sqes[ring->tail & ring->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  ring->tail++;
+  return sqe;
+}
+
+/* queue a multishot accept */
+int uring_accept(uring_t *ring, int fd, unsigned long data){
+  struct io_uring_sqe *sqe = get_sqe(ring);
+
+  if(!sqe){
+    return -1;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->user_data = data;
+  return 0;
+}
+
+/* queue a multishot receive into the registered buffers */
+int uring_recv(uring_t *ring, int fd, unsigned long data){
+  struct io_uring_sqe *sqe = get_sqe(ring);
+
+  if(!sqe){
+    return -1;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BGID;
+  sqe->user_data = data;
+  return 0;
+}
+
+/* queue a sendmsg() */
+int uring_sendmsg(uring_t *ring, int fd, struct msghdr *msg,
+                  unsigned long data){
+  struct io_uring_sqe *sqe = get_sqe(ring);
+
+  if(!sqe){
+    return -1;
+  }
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = data;
+  return 0;
+}
+
+/* queue a multishot poll for input */
+int uring_poll(uring_t *ring, int fd, unsigned long data){
+  struct io_uring_sqe *sqe = get_sqe(ring);
+
+  if(!sqe){
+    return -1;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = data;
+  return 0;
+}
+
+/* queue the cancelling of an operation */
+int uring_cancel(uring_t *ring, unsigned long data){
+  struct io_uring_sqe *sqe = get_sqe(ring);
+
+  if(!sqe){
+    return -1;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = data;
+  sqe->user_data = 0;
+  return 0;
+}
+
+/* submit and sleep until there is something to handle */
+int uring_wait(uring_t *ring, int timeout_ms){
+  return enter(ring, uring_peek(ring) ? 0 : 1, timeout_ms);
+}
+
+/* find the oldest unseen completion */
+struct io_uring_cqe *uring_peek(uring_t *ring){
+  unsigned head = *ring->cq_head;
+
+  if(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)){
+    return NULL;
+  }
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+/* hand the oldest completion's slot back */
+void uring_seen(uring_t *ring){
+  __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* find the buffer a receive completed into */
+char *uring_buffer(uring_t *ring, unsigned flags){
+  if(!(flags & IORING_CQE_F_BUFFER)){
+    return NULL;
+  }
+  return ring->bufs + (flags >> IORING_CQE_BUFFER_SHIFT) * ring->bufsize;
+}
+
+/* give a receive buffer back to the kernel */
+void uring_buffer_return(uring_t *ring, unsigned flags){
+  if(flags & IORING_CQE_F_BUFFER){
+    add_buffer(ring, (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT));
+  }
+}
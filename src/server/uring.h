@@ -0,0 +1,202 @@
+/*=============================================================================
+|   Title: uring.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a thin wrapper over the io_uring system calls,
+|  so an event loop can queue its socket operations in shared memory and
+|  hand them all to the kernel with one io_uring_enter(), which also waits
+|  for their completions
+|
+|  accepts, receives and polls are multishot, one request keeps completing
+|  until it is cancelled or fails, receives pick their buffer from a ring of
+|  buffers registered with the kernel, so no memory is tied up in sockets
+|  that have nothing to say
+|
+|  a ring is only ever used by one thread
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* uring.h -- public interface to the io_uring module
+*/
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+/* the ring representation is hidden from users of the module */
+typedef struct uring_t uring_t;
+
+/*
+* Function:  uring_open()
+* --------------------
+* creates a ring and registers a ring of receive buffers with it
+*
+* paramaters:
+*  unsigned entries: the most operations queued at once, a power of two
+*  unsigned nbufs: the number of receive buffers, a power of two
+*  size_t bufsize: the size of each
+*
+*  returns: uring_t*, the ring, NULL if the kernel lacks what it needs
+*/
+uring_t *uring_open(unsigned entries, unsigned nbufs, size_t bufsize);
+
+/*
+* Function:  uring_close()
+* --------------------
+* frees a ring, outstanding operations are cancelled
+*
+* paramaters:
+*  uring_t *ring: the ring
+*
+*  returns: NULL
+*/
+void uring_close(uring_t *ring);
+
+/*
+* Function:  uring_accept()
+* --------------------
+* queues a multishot accept, each new client completes with its socket
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  int fd: the listening socket
+*  unsigned long data: handed back with every completion
+*
+*  returns: 0 if successful, -1 if the ring is full
+*/
+int uring_accept(uring_t *ring, int fd, unsigned long data);
+
+/*
+* Function:  uring_recv()
+* --------------------
+* queues a multishot receive, each completion holds the bytes in one of the
+* ring's buffers, see uring_buffer()
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  int fd: the socket
+*  unsigned long data: handed back with every completion
+*
+*  returns: 0 if successful, -1 if the ring is full
+*/
+int uring_recv(uring_t *ring, int fd, unsigned long data);
+
+/*
+* Function:  uring_sendmsg()
+* --------------------
+* queues a sendmsg(), the message and what it points at must stay put until
+* it completes
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  int fd: the socket
+*  struct msghdr *msg: what to send
+*  unsigned long data: handed back with the completion
+*
+*  returns: 0 if successful, -1 if the ring is full
+*/
+int uring_sendmsg(uring_t *ring, int fd, struct msghdr *msg,
+                  unsigned long data);
+
+/*
+* Function:  uring_poll()
+* --------------------
+* queues a multishot poll for a descriptor becoming readable
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  int fd: the descriptor
+*  unsigned long data: handed back with every completion
+*
+*  returns: 0 if successful, -1 if the ring is full
+*/
+int uring_poll(uring_t *ring, int fd, unsigned long data);
+
+/*
+* Function:  uring_cancel()
+* --------------------
+* queues the cancelling of an outstanding operation, which then completes
+* with -ECANCELED, the cancel's own completion has data 0
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  unsigned long data: what the operation was queued with
+*
+*  returns: 0 if successful, -1 if the ring is full
+*/
+int uring_cancel(uring_t *ring, unsigned long data);
+
+/*
+* Function:  uring_wait()
+* --------------------
+* hands every queued operation to the kernel and, unless completions are
+* already waiting, sleeps until one arrives
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  int timeout_ms: the longest to sleep, -1 for no limit
+*
+*  returns: 0 if successful, even after a timeout or a signal, -1 if not
+*        successful
+*/
+int uring_wait(uring_t *ring, int timeout_ms);
+
+/*
+* Function:  uring_peek()
+* --------------------
+* finds the oldest completion not yet seen
+*
+* paramaters:
+*  uring_t *ring: the ring
+*
+*  returns: struct io_uring_cqe*, the completion, NULL if there is none
+*/
+struct io_uring_cqe *uring_peek(uring_t *ring);
+
+/*
+* Function:  uring_seen()
+* --------------------
+* gives the completion uring_peek() found back to the kernel
+*
+* paramaters:
+*  uring_t *ring: the ring
+*
+*  returns: NULL
+*/
+void uring_seen(uring_t *ring);
+
+/*
+* Function:  uring_buffer()
+* --------------------
+* finds the receive buffer a completion's bytes are in
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  unsigned flags: the completion's flags
+*
+*  returns: char*, the buffer, NULL if the completion has none
+*/
+char *uring_buffer(uring_t *ring, unsigned flags);
+
+/*
+* Function:  uring_buffer_return()
+* --------------------
+* hands a receive buffer back to the kernel once its bytes are used
+*
+* paramaters:
+*  uring_t *ring: the ring
+*  unsigned flags: the flags of the completion the buffer came with
+*
+*  returns: NULL
+*/
+void uring_buffer_return(uring_t *ring, unsigned flags);
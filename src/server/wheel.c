@@ -0,0 +1,197 @@
+/*=============================================================================
+|   Title: wheel.c
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a hierarchical timer wheel, see wheel.h
+|
+*===========================================================================*/
+
+#include <stdlib.h>
+
+#include "wheel.h"
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+/* the furthest ahead a timer can be, later ones fire this far ahead */
+#define WHEEL_SPAN (1UL << (WHEEL_LEVELS * WHEEL_BITS))
+
+struct wheel_t{
+  unsigned long tick_ms;
+  /* the next tick to be handled, every earlier one has fired */
+  unsigned long current;
+  unsigned long count;
+  wheel_timer_t *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+/* link a timer in at the head of a list */
+static void link_timer(wheel_timer_t **head, wheel_timer_t *t){
+  t->next = *head;
+  if(t->next){
+    t->next->pprev = &t->next;
+  }
+  t->pprev = head;
+  *head = t;
+}
+
+/* take a timer out of whatever list it is in */
+static void unlink_timer(wheel_timer_t *t){
+  *t->pprev = t->next;
+  if(t->next){
+    t->next->pprev = t->pprev;
+  }
+  t->next = NULL;
+  t->pprev = NULL;
+}
+
+/* move a whole list to a new head, so it can be walked while timers are
+cancelled out of it */
+static void move_list(wheel_timer_t **from, wheel_timer_t **to){
+  *to = *from;
+  *from = NULL;
+  if(*to){
+    (*to)->pprev = to;
+  }
+}
+
+/* put a timer in the slot its expiry falls in, the further off it is the
+coarser the level */
+static void insert_timer(wheel_t *w, wheel_timer_t *t){
+  unsigned long delta;
+  int level;
+
+  if(t->expires < w->current){
+    t->expires = w->current;
+  }
+  delta = t->expires - w->current;
+  if(delta >= WHEEL_SPAN){
+    t->expires = w->current + WHEEL_SPAN - 1;
+    delta = WHEEL_SPAN - 1;
+  }
+  for(level = 0; level < WHEEL_LEVELS - 1; level++){
+    if(delta < (1UL << ((level + 1) * WHEEL_BITS))){
+      break;
+    }
+  }
+  link_timer(&w->slots[level][(t->expires >> (level * WHEEL_BITS)) &
+                              WHEEL_MASK], t);
+}
+
+/* move the timers of a level's current slot down to the levels below,
+returns the slot's index */
+static int cascade(wheel_t *w, int level){
+  int index = (w->current >> (level * WHEEL_BITS)) & WHEEL_MASK;
+  wheel_timer_t *list, *t;
+
+  move_list(&w->slots[level][index], &list);
+  while((t = list) != NULL){
+    unlink_timer(t);
+    insert_timer(w, t);
+  }
+  return index;
+}
+
+/* create a wheel with no timers */
+wheel_t *wheel_open(unsigned long tick_ms, unsigned long now_ms){
+  wheel_t *w = (wheel_t *)calloc(1, sizeof(wheel_t));
+
+  if(!w){
+    return NULL;
+  }
+  w->tick_ms = tick_ms > 0 ? tick_ms : 1;
+  w->current = now_ms / w->tick_ms;
+  return w;
+}
+
+/* free a wheel */
+void wheel_close(wheel_t *w){
+  free(w);
+}
+
+/* set up a timer that is not armed */
+void wheel_timer_init(wheel_timer_t *t,
+                      void (*fn)(wheel_timer_t *t, void *arg), void *arg){
+  t->next = NULL;
+  t->pprev = NULL;
+  t->expires = 0;
+  t->fn = fn;
+  t->arg = arg;
+}
+
+/* arm or move a timer, rounding up so it never fires early */
+void wheel_arm(wheel_t *w, wheel_timer_t *t, unsigned long when_ms){
+  if(t->pprev){
+    unlink_timer(t);
+  }else{
+    w->count++;
+  }
+  t->expires = (when_ms + w->tick_ms - 1) / w->tick_ms;
+  insert_timer(w, t);
+}
+
+/* disarm a timer */
+void wheel_cancel(wheel_t *w, wheel_timer_t *t){
+  if(t->pprev){
+    unlink_timer(t);
+    w->count--;
+  }
+}
+
+/* handle every tick up to now, cascading timers down a level at the start
+of each lap and firing the timers of each tick's slot */
+int wheel_advance(wheel_t *w, unsigned long now_ms){
+  unsigned long now = now_ms / w->tick_ms;
+  wheel_timer_t *list, *t;
+  int index, level, fired = 0;
+
+  while(w->current <= now){
+    /* an empty wheel has nothing to catch up on */
+    if(w->count == 0){
+      w->current = now + 1;
+      break;
+    }
+    index = w->current & WHEEL_MASK;
+    if(index == 0){
+      for(level = 1; level < WHEEL_LEVELS && cascade(w, level) == 0;
+          level++){
+      }
+    }
+    move_list(&w->slots[0][index], &list);
+    /* a timer armed for now by a callback fires on the next tick */
+    w->current++;
+    while((t = list) != NULL){
+      unlink_timer(t);
+      w->count--;
+      fired++;
+      t->fn(t, t->arg);
+    }
+  }
+  return fired;
+}
+
+/* the time until the next slot with timers in it, or until the next lap of
+the first level, when timers from further out may come due */
+int wheel_timeout(wheel_t *w, unsigned long now_ms){
+  unsigned long tick = w->current, due;
+  int i;
+
+  if(w->count == 0){
+    return -1;
+  }
+  for(i = 0; i < WHEEL_SLOTS; i++, tick++){
+    if(w->slots[0][tick & WHEEL_MASK] || (tick & WHEEL_MASK) == 0){
+      break;
+    }
+  }
+  due = tick * w->tick_ms;
+  return due > now_ms ? (int)(due - now_ms) : 0;
+}
@@ -0,0 +1,139 @@
+/*=============================================================================
+|   Title: wheel.h
+|
+|       Author:  Grace Miller
+|     Language:  C
+|   To Compile:  Run the Makefile
+|
+|    Class:  CS 63 Programming Parallel Systems
+|    Date:  10/17/2026
+|
++-----------------------------------------------------------------------------
+|
+|  Description:  implements a hierarchical timer wheel, timers are kept in
+|  four levels of 64 slots, the first a slot per tick and each further one a
+|  slot per lap of the level below, so arming and cancelling a timer cost the
+|  same however many are armed, and a timer far in the future is only moved
+|  down a level a few times before it fires
+|
+|  timers live inside the structs they time, such as a connection, so
+|  arming one never allocates, a wheel is only ever used by one thread
+|
+*===========================================================================*/
+
+#pragma once
+/*
+* wheel.h -- public interface to the timer wheel module
+*/
+
+#include <stddef.h>
+
+/* a timer, embedded in whatever it times */
+typedef struct wheel_timer_t{
+  struct wheel_timer_t *next;
+  /* the link pointing at the timer, NULL while it is not armed */
+  struct wheel_timer_t **pprev;
+  /* the tick it fires on */
+  unsigned long expires;
+  void (*fn)(struct wheel_timer_t *t, void *arg);
+  void *arg;
+} wheel_timer_t;
+
+/* the wheel representation is hidden from users of the module */
+typedef struct wheel_t wheel_t;
+
+/*
+* Function:  wheel_open()
+* --------------------
+* creates a wheel with no timers
+*
+* paramaters:
+*  unsigned long tick_ms: milliseconds per tick, timers fire at most this
+*        late
+*  unsigned long now_ms: the current time in milliseconds
+*
+*  returns: wheel_t*, the wheel, NULL if out of memory
+*/
+wheel_t *wheel_open(unsigned long tick_ms, unsigned long now_ms);
+
+/*
+* Function:  wheel_close()
+* --------------------
+* frees a wheel, timers still armed are forgotten without firing
+*
+* paramaters:
+*  wheel_t *w: the wheel
+*
+*  returns: NULL
+*/
+void wheel_close(wheel_t *w);
+
+/*
+* Function:  wheel_timer_init()
+* --------------------
+* sets up a timer that is not armed
+*
+* paramaters:
+*  wheel_timer_t *t: the timer
+*  void (*fn)(wheel_timer_t *t, void *arg): called when it fires, it may
+*        arm or cancel any timer, itself included
+*  void *arg: passed through to fn
+*
+*  returns: NULL
+*/
+void wheel_timer_init(wheel_timer_t *t,
+                      void (*fn)(wheel_timer_t *t, void *arg), void *arg);
+
+/*
+* Function:  wheel_arm()
+* --------------------
+* arms a timer to fire once the time passes when_ms, a timer already armed
+* is moved
+*
+* paramaters:
+*  wheel_t *w: the wheel
+*  wheel_timer_t *t: the timer
+*  unsigned long when_ms: the time to fire at, in milliseconds
+*
+*  returns: NULL
+*/
+void wheel_arm(wheel_t *w, wheel_timer_t *t, unsigned long when_ms);
+
+/*
+* Function:  wheel_cancel()
+* --------------------
+* disarms a timer, nothing happens if it is not armed
+*
+* paramaters:
+*  wheel_t *w: the wheel
+*  wheel_timer_t *t: the timer
+*
+*  returns: NULL
+*/
+void wheel_cancel(wheel_t *w, wheel_timer_t *t);
+
+/*
+* Function:  wheel_advance()
+* --------------------
+* moves the wheel on to the current time, firing every timer due by then
+*
+* paramaters:
+*  wheel_t *w: the wheel
+*  unsigned long now_ms: the current time in milliseconds
+*
+*  returns: int, the number of timers fired
+*/
+int wheel_advance(wheel_t *w, unsigned long now_ms);
+
+/*
+* Function:  wheel_timeout()
+* --------------------
+* how long the wheel can be left before it needs advancing again
+*
+* paramaters:
+*  wheel_t *w: the wheel
+*  unsigned long now_ms: the current time in milliseconds
+*
+*  returns: int, milliseconds, -1 if no timer is armed
+*/
+int wheel_timeout(wheel_t *w, unsigned long now_ms);